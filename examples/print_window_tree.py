@@ -1,5 +1,6 @@
 #!/usr/bin/python3
 
+import json
 import os
 import sys
 
@@ -13,30 +14,35 @@ children = {
 
 }
 
+names = {
+
+}
+
 root = None
 
-windows_dir = os.path.join(mount, "windows")
+# obtain all windows in a single consistent read
+snapshot = os.path.join(mount, "snapshot", "id,parent,name.json")
+
+with open(snapshot) as fd:
+    windows = json.load(fd)
 
-for window in os.listdir(windows_dir):
+for window in windows:
 
-    parent = os.path.join(windows_dir, window, "parent")
-    parent = open(parent).read().strip()
+    node = window["id"]
+    parent = window["parent"]
+    names[node] = window["name"]
 
     if parent == "0":
-        root = window
+        root = node
         continue
 
     child_list = children.setdefault(parent, [])
-    child_list.append(window)
+    child_list.append(node)
 
 
 def print_tree(node, level):
 
-    try:
-        name = os.path.join(windows_dir, node, "name")
-        name = open(name).read().strip()
-    except Exception:
-        name = "<unnamed>"
+    name = names.get(node) or "<unnamed>"
 
     print(level * '\t', node, ": ", name, sep='')
 
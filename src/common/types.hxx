@@ -1,5 +1,8 @@
 #pragma once
 
+// C++
+#include <functional>
+
 // libcosmos
 #include <cosmos/utils.hxx>
 
@@ -8,4 +11,15 @@ namespace xwmfs {
 
 using Writable = cosmos::NamedBool<struct writable_t, false>;
 
+/// A deferred file system modification prepared while processing an X event.
+/**
+ * X event processing is split into a fetch phase that performs any
+ * necessary X requests without holding any directory locks and a commit
+ * phase that only applies the prepared results to the file system. Functions
+ * of this type implement the commit phase. They are invoked from the event
+ * thread without holding the event lock and acquire the locks of the
+ * directories they modify themselves.
+ **/
+using CommitFunction = std::function<void ()>;
+
 } // end ns
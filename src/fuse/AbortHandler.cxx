@@ -5,29 +5,20 @@
 namespace xwmfs {
 
 AbortHandler::AbortHandler(cosmos::Condition &cond) :
-		m_cond{cond} {
+		AbortHandler{cond.mutex(), [&cond]() { cond.broadcast(); }} {
 }
 
-void AbortHandler::abort(const cosmos::pthread::ID thread) {
-	{
-		cosmos::MutexGuard g{m_cond.mutex()};
-		m_abort_set.insert(thread);
-	}
+AbortHandler::AbortHandler(cosmos::Mutex &lock, WakeupFunc wakeup) :
+		m_lock{lock}, m_wakeup{wakeup} {
+}
 
-	m_cond.broadcast();
+void AbortHandler::abort() {
+	cosmos::MutexGuard g{m_lock};
+	m_wakeup();
 }
 
 bool AbortHandler::wasAborted() {
-	const auto self = cosmos::pthread::get_id();
-	auto it = m_abort_set.find(self);
-
-	if (it == m_abort_set.end()) {
-		return false;
-	}
-
-	m_abort_set.erase(it);
-
-	return true;
+	return xwmfs::Xwmfs::getInstance().isCallAborted();
 }
 
 bool AbortHandler::prepareBlockingCall(Entry *file) {
@@ -1,11 +1,10 @@
 #pragma once
 
 // C++
-#include <set>
+#include <functional>
 
 // cosmos
 #include <cosmos/thread/Condition.hxx>
-#include <cosmos/thread/pthread.hxx>
 
 namespace xwmfs {
 
@@ -20,22 +19,43 @@ class Entry;
  * this mixin.
  **/
 class AbortHandler {
+public: // types
+
+	/// Wakes up all threads blocking on the associated entry.
+	/**
+	 * This is called with the associated mutex held.
+	 **/
+	using WakeupFunc = std::function<void ()>;
+
 public: // functions
 
-	AbortHandler(cosmos::Condition &cond);
+	/// Creates a handler for threads blocking on `cond`.
+	explicit AbortHandler(cosmos::Condition &cond);
+
+	/// Creates a handler for threads blocking on conditions associated with `lock`.
+	/**
+	 * This variant is used by entries that use multiple condition
+	 * variables, `wakeup` needs to wake all of them.
+	 **/
+	AbortHandler(cosmos::Mutex &lock, WakeupFunc wakeup);
 
 	/// Returns whether the calling thread should abort its operation.
 	/**
-	 * The information will be deleted after calling this function, so a
-	 * subsequent call will return `false`.
+	 * This is the case if the FUSE request processed by the calling
+	 * thread has been interrupted or if the file system is shutting
+	 * down, see Xwmfs::isCallAborted(). The state is kept until the
+	 * request is finished, thus subsequent calls return the same.
 	 *
-	 * This function needs to be called with the mutex associated
-	 * with m_cond held!
+	 * This function needs to be called with m_lock held!
 	 **/
 	bool wasAborted();
 
-	/// Records an abort request for the given thread and wakes up associated threads.
-	void abort(const cosmos::pthread::ID thread);
+	/// Wakes up all threads blocking on the associated entry.
+	/**
+	 * The woken threads check wasAborted() to find out whether they are
+	 * affected.
+	 **/
+	void abort();
 
 	/// Call this before a blocking call is about to be executed.
 	/**
@@ -48,15 +68,11 @@ public: // functions
 	/// Call this after a blocking call has finished.
 	void finishedBlockingCall();
 
-protected: // types
-
-	using AbortSet = std::set<cosmos::pthread::ID>;
-
 protected: // data
 
-	cosmos::Condition &m_cond;
-	/// Records threads for which blocking calls shall be aborted.
-	AbortSet m_abort_set;
+	/// The mutex protecting the blocking calls.
+	cosmos::Mutex &m_lock;
+	WakeupFunc m_wakeup;
 };
 
 } // end ns
@@ -1,80 +1,184 @@
 // C++
 #include <cassert>
-#include <vector>
+
+// POSIX
+#include <sys/stat.h>
 
 // cosmos
 #include <cosmos/formatting.hxx>
+#include <cosmos/time/Clock.hxx>
 
 // xwmfs
 #include "fuse/DirEntry.hxx"
+#include "fuse/EpochReclaimer.hxx"
+#include "fuse/KernelCache.hxx"
 
 namespace xwmfs {
 
 Entry* DirEntry::addEntry(Entry * const e, const InheritTime inherit_time) {
-	assert(e);
-
-	/*
-	 * We optimize here by not allocating a copy of the entry's
-	 * name but instead use a flat copy of that entry's name as a
-	 * key. We need to be very careful about that, however, when
-	 * it comes to deleting entries again.
-	 */
-	auto insert_res = m_objs.insert(std::make_pair(e->name().c_str(), e));
-
-	if (!insert_res.second) {
-		throw DoubleAddError{e->name()};
+	addEntries({e}, inherit_time);
+	return e;
+}
+
+void DirEntry::addEntries(const std::vector<Entry*> &entries, const InheritTime inherit_time) {
+	bool published = false;
+
+	{
+		cosmos::MutexGuard g{m_structure_lock};
+		auto &objs = const_cast<NameEntryMap&>(getEntries());
+		// as long as we're not part of the file system no reader can
+		// see our content, thus it can be modified in place. This
+		// avoids copying the index for each entry while a directory
+		// is populated.
+		published = parent() != nullptr;
+		auto new_objs = published ? new NameEntryMap{objs} : &objs;
+
+		for (auto it = entries.begin(); it != entries.end(); it++) {
+			assert(*it);
+
+			if (new_objs->insert(*it)) {
+				continue;
+			}
+
+			if (published) {
+				delete new_objs;
+			} else {
+				for (auto added = entries.begin(); added != it; added++) {
+					new_objs->erase((*added)->name());
+				}
+			}
+
+			throw DoubleAddError{(*it)->name()};
+		}
+
+		for (auto e: entries) {
+			// we inherit our own time info to the new entry, if
+			// none has been specified
+			if (inherit_time) {
+				e->setModifyTime(m_modify_time);
+				e->setStatusTime(m_status_time);
+			}
+
+			e->setParent(this);
+		}
+
+		if (published) {
+			publish(new_objs);
+		}
 	}
 
-	// we inherit our own time info to the new entry, if none has been
-	// specified
-	if (inherit_time) {
-		e->setModifyTime(m_modify_time);
-		e->setStatusTime(m_status_time);
+	if (published) {
+		contentChanged();
 	}
+}
 
-	e->setParent(this);
+void DirEntry::contentChanged() {
+	// like on other file systems adding or removing entries changes our
+	// modification time. This also drops our attributes from the kernel
+	// cache.
+	cosmos::MutexGuard g{m_lock};
+	setModifyTime(cosmos::RealTimeClock{}.now());
+}
 
-	return e;
+void DirEntry::publish(const NameEntryMap *objs) {
+	auto old_objs = m_objs.exchange(objs, std::memory_order_acq_rel);
+	// readers may still be iterating over the old version
+	EpochReclaimer::getInstance().retire(old_objs);
 }
 
 void DirEntry::removeEntry(const char* s) {
-	auto it = m_objs.find(s);
+	Entry *entry = nullptr;
 
-	if(it == m_objs.end()) {
-		throw Exception{cosmos::sprintf("removeEntry: No such entry \"%s\"", s)};
-	}
+	{
+		cosmos::MutexGuard g{m_structure_lock};
+		auto new_objs = new NameEntryMap{getEntries()};
+		entry = new_objs->erase(s);
 
-	auto entry = it->second;
+		if(!entry) {
+			delete new_objs;
+			throw Exception{cosmos::sprintf("removeEntry: No such entry \"%s\"", s)};
+		}
+
+		publish(new_objs);
+	}
 
-	m_objs.erase(it);
+	// readers that still see the entry keep it alive until they leave
+	// their epoch, but they won't find it anymore from here on. The
+	// kernel may still have the name cached, though.
+	KernelCache::getInstance().invalidateName(*this, entry->name());
+	contentChanged();
 
 	if(entry->markDeleted()) {
-		// only delete the entry after erasing it from the map,
-		// because the string from the entry is used a key for the map
-		// (flat copy)
-		delete entry;
+		// the retired index still refers to the entry, but only
+		// readers that can also still see the entry itself can
+		// access it.
+		EpochReclaimer::getInstance().retire(entry);
 	}
 }
 
 void DirEntry::clear() {
-	std::vector<Entry*> to_delete;
+	const NameEntryMap *objs = nullptr;
+
+	{
+		// detach all entries first, marking them deleted may
+		// acquire further locks.
+		cosmos::MutexGuard g{m_structure_lock};
+		objs = &getEntries();
 
-	// we need to be careful here as our keys are kept in the
-	// mapped values. If we delete an entry then its key in the map
-	// becomes invalid.
+		if (objs->empty())
+			return;
+
+		m_objs.store(new NameEntryMap{});
+	}
+
+	// readers still iterating over the old index are in an older
+	// epoch, thus the entries won't be freed before they're done.
+
+	auto &cache = KernelCache::getInstance();
+
+	for (auto entry: *objs) {
+		cache.invalidateName(*this, entry->name());
 
-	for (auto it: m_objs) {
-		auto entry = it.second;
 		if (entry->markDeleted()) {
-			to_delete.push_back(entry);
+			EpochReclaimer::getInstance().retire(entry);
 		}
 	}
 
-	m_objs.clear();
+	EpochReclaimer::getInstance().retire(objs);
+}
+
+void DirEntry::getStat(struct stat *s) const {
+	cosmos::MutexGuard g{m_lock};
+	Entry::getStat(s);
+}
+
+OpenContext* DirEntry::createOpenContext() {
+	auto ret = new DirOpenContext{this};
 
-	for (auto &entry: to_delete) {
-		delete entry;
+	{
+		EpochGuard guard;
+		const auto &objs = getEntries();
+		ret->entries.reserve(objs.size());
+
+		for (auto entry: objs) {
+			// entries removed concurrently are simply skipped
+			if (entry->tryRef()) {
+				ret->entries.push_back(entry);
+			}
+		}
+	}
+
+	this->ref();
+
+	return ret;
+}
+
+void DirEntry::destroyOpenContext(OpenContext *ctx) {
+	for (auto entry: static_cast<DirOpenContext*>(ctx)->entries) {
+		entry->release();
 	}
+
+	Entry::destroyOpenContext(ctx);
 }
 
 DirEntry::Bytes DirEntry::read(OpenContext *ctx, char *buf, const size_t size, off_t offset) {
@@ -1,8 +1,9 @@
 #pragma once
 
 // C++
-#include <map>
+#include <atomic>
 #include <string_view>
+#include <vector>
 
 // cosmos
 #include <cosmos/thread/Mutex.hxx>
@@ -10,25 +11,51 @@
 
 // xwmfs
 #include "fuse/Entry.hxx"
+#include "fuse/NameIndex.hxx"
+#include "fuse/OpenContext.hxx"
 #include "main/Exception.hxx"
 
 namespace xwmfs {
 
+/// An OpenContext for directories containing a snapshot of the directory content.
+/**
+ * The snapshot is taken at opendir time, thus the offsets used in successive
+ * readdir calls stay consistent, even if entries are added or removed in the
+ * meantime. Each contained entry is referenced until the directory is closed
+ * again.
+ **/
+struct DirOpenContext :
+		public OpenContext {
+
+	using OpenContext::OpenContext;
+
+	std::vector<Entry*> entries;
+};
+
 /// This type represents directory entries in the file system.
 /**
  * The peculiarity of a directory is, of course, that it contains other file
- * system entries. For quick access a DirEntry thus contains a map container
+ * system entries. For quick access a DirEntry thus contains a hash index
  * that maps from its contained names to the corresponding Entry base type.
  *
  * For now DirEntry object are always read-only as we can't create new files
  * in the XWMFS (yet).
+ *
+ * Once the directory is part of the file system, the map of contained
+ * entries is never modified in place. Structural changes publish a modified
+ * copy of the map instead, the previous version is retired via the
+ * EpochReclaimer. This way FUSE threads can look up and
+ * list entries without taking any locks, as long as they hold an
+ * EpochGuard. Structural changes are mostly performed by the event
+ * thread, they are serialized via m_structure_lock. The content of the
+ * direct children is protected by a mutex, see m_lock.
  **/
 class DirEntry :
 		public Entry {
 public: // types
 
 	/// A map of file system names to their corresponding Entry objects.
-	using NameEntryMap = std::map<std::string_view, Entry*>;
+	using NameEntryMap = NameIndex;
 
 	/// The type enum associated with DirEntry. Can be used in templates.
 	static constexpr Entry::Type type = Entry::DIRECTORY;
@@ -54,7 +81,8 @@ public: // functions
 	 * modification times of the directory.
 	 **/
 	DirEntry(const std::string &n, const cosmos::RealTime &t = cosmos::RealTime{}) :
-		Entry{n, DIRECTORY, t} {
+		Entry{n, DIRECTORY, t},
+		m_objs{new NameEntryMap{}} {
 	}
 
 	/// When a DirEntry is destroyed it deletes all its contained objects.
@@ -63,7 +91,10 @@ public: // functions
 	 * itself. As our file system won't get very deep nesting levels we
 	 * don't need to fear a stack overflow.
 	 **/
-	~DirEntry() { this->clear(); }
+	~DirEntry() {
+		this->clear();
+		delete m_objs.load();
+	}
 
 	/// Removes all contained file system objects and marks them for deletion.
 	void clear();
@@ -90,19 +121,35 @@ public: // functions
 	 * current DirEntry object. If `inherit_time` is set then the
 	 * modification and status time of `e` will be set to the respective
 	 * values of the current DirEntry object.
+	 *
+	 * The entry should be fully populated before adding it, since it is
+	 * visible to readers right away.
 	 **/
 	Entry* addEntry(Entry * const e, const InheritTime inherit_time = InheritTime{true});
 
+	/// Adds all of `entries` to the current directory at once.
+	/**
+	 * This works like addEntry(Entry*, const InheritTime), but the
+	 * directory content is only published once for all entries. If one
+	 * of the names already exists then none of the entries is added.
+	 **/
+	void addEntries(const std::vector<Entry*> &entries,
+			const InheritTime inherit_time = InheritTime{true});
+
 	/// Retrieve the contained entry with the name `n`.
 	/**
+	 * No locking is performed by this function. From FUSE threads the
+	 * returned entry is only valid as long as an EpochGuard is held. The
+	 * event thread, which is the only one reclaiming memory, can call
+	 * this without a guard. This also holds for directories that FUSE
+	 * threads add entries to, like SnapshotDir::lookupEntry() does.
+	 *
 	 * \return
 	 * 	A pointer to the contained Entry or nullptr if there is no
 	 * 	entry with that name contained in the current DirEntry.
 	 **/
 	Entry* getEntry(const std::string_view n) const {
-		auto obj_it = m_objs.find(n);
-
-		return (obj_it == m_objs.end()) ? nullptr : obj_it->second;
+		return getEntries().find(n);
 	}
 
 	/// Retrieve an entry in the directory with name `n` and of type `t`.
@@ -110,7 +157,7 @@ public: // functions
 	 * If an entry of the given name exists, but has a different type,
 	 * then nullptr is returned.
 	 **/
-	Entry* getEntry(const std::string_view n, const Entry::Type t) {
+	Entry* getEntry(const std::string_view n, const Entry::Type t) const {
 		Entry *ret = this->getEntry(n);
 		if (ret && ret->type() != t)
 			return nullptr;
@@ -118,6 +165,16 @@ public: // functions
 		return ret;
 	}
 
+	/// Looks up the entry with the name `n` on behalf of the kernel.
+	/**
+	 * By default this is the same as getEntry(). Specialized directories
+	 * can override this to create entries on demand. The same rules as
+	 * for getEntry() apply.
+	 **/
+	virtual Entry* lookupEntry(const std::string_view n) {
+		return getEntry(n);
+	}
+
 	DirEntry* getDirEntry(const std::string_view n) {
 		return reinterpret_cast<DirEntry*>(getEntry(n, Entry::Type::DIRECTORY));
 	}
@@ -137,13 +194,18 @@ public: // functions
 
 	/// Removes the contained entry with the name `s`
 	/**
-	 * Throws an Exception if no such entry is existing.
+	 * Throws an Exception if no such entry is existing. The entry is
+	 * retired via the EpochReclaimer once it isn't referenced anymore.
 	 **/
 	void removeEntry(const char *s);
 
 	/// Retrieves the non-modifiable map of all contained entries.
+	/**
+	 * This returns a consistent snapshot of the directory, later changes
+	 * won't be reflected in it. The same rules as for getEntry() apply.
+	 **/
 	const NameEntryMap& getEntries() const {
-		return m_objs;
+		return *m_objs.load(std::memory_order_acquire);
 	}
 
 	bool markDeleted() override {
@@ -156,21 +218,42 @@ public: // functions
 	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
 	Bytes write(OpenContext *ctx, const char *buf, size_t size, off_t offset) override;
 
+	void getStat(struct stat *s) const override;
+
+	/// Creates a DirOpenContext containing a snapshot of the directory content.
+	OpenContext* createOpenContext() override;
+
+	void destroyOpenContext(OpenContext *ctx) override;
+
 	cosmos::Mutex& getLock() {
 		return m_lock;
 	}
 
+protected: // functions
+
+	/// Publishes `objs` as the new directory content and retires the old one.
+	/**
+	 * Must be called with m_structure_lock held.
+	 **/
+	void publish(const NameEntryMap *objs);
+
+	/// Updates our modification time after entries have been added or removed.
+	/**
+	 * Must be called without m_structure_lock and m_lock held.
+	 **/
+	void contentChanged();
+
 protected: // data
 
 	/// Contains all entries existing in the directory with their names as keys.
 	/**
-	 * Note that the keys are flat copies of the `m_name` member in the
-	 * Entry type. This uses std::string_view to support copy-less lookup
-	 * in RootEntry::findEntry(). The string_views inserted here must
-	 * always be null terminated, however, otherwise the interfacing to
-	 * FUSE won't work properly.
+	 * The keys are taken from the `m_name` member of the contained
+	 * entries. Lookups use std::string_view to support copy-less lookup
+	 * in RootEntry::findEntry().
+	 *
+	 * The pointed-to index is immutable, see publish().
 	 **/
-	NameEntryMap m_objs;
+	std::atomic<const NameEntryMap*> m_objs;
 
 	/// A lock for this directory and all its direct children.
 	/**
@@ -181,8 +264,18 @@ protected: // data
 	 * settled for one lock per directory and all its direct non-directory
 	 * children. A middle way of saving resources and still allowing
 	 * parallel operations in many situations.
+	 *
+	 * This protects the content and timestamps of the children and the
+	 * timestamps of the directory itself.
 	 **/
 	cosmos::Mutex m_lock;
+
+	/// Serializes writers of m_objs, readers don't need it.
+	/**
+	 * It must not be acquired while holding m_lock, the other way
+	 * around is fine.
+	 **/
+	cosmos::Mutex m_structure_lock;
 };
 
 } // end ns
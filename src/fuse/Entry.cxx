@@ -2,14 +2,20 @@
 #include <string>
 
 // POSIX
+#include <poll.h>
 #include <sys/stat.h>
 
+// FUSE
+#include <fuse_lowlevel.h>
+
 // cosmos
 #include <cosmos/thread/Condition.hxx>
 
 // xwmfs
 #include "fuse/AbortHandler.hxx"
 #include "fuse/Entry.hxx"
+#include "fuse/EpochReclaimer.hxx"
+#include "fuse/KernelCache.hxx"
 #include "fuse/OpenContext.hxx"
 #include "main/Xwmfs.hxx"
 
@@ -23,22 +29,35 @@ Entry::~Entry() {
 		// no distinct parent
 		return;
 
-	if (m_parent->unref()) {
-		delete m_parent,
-		m_parent = nullptr;
+	m_parent->release();
+	m_parent = nullptr;
+}
+
+void Entry::release(const size_t count) {
+	if (unref(count)) {
+		EpochReclaimer::getInstance().retire(this);
 	}
 }
 
+void Entry::setModifyTime(const cosmos::RealTime &t) {
+	m_modify_time = t;
+	KernelCache::getInstance().invalidate(*this);
+}
+
 void Entry::createAbortHandler(cosmos::Condition &cond) {
 	m_abort_handler = std::make_unique<AbortHandler>(cond);
 }
 
-void Entry::abortBlockingCall(const cosmos::pthread::ID thread) {
+void Entry::createAbortHandler(cosmos::Mutex &lock, AbortHandler::WakeupFunc wakeup) {
+	m_abort_handler = std::make_unique<AbortHandler>(lock, wakeup);
+}
+
+void Entry::abortBlockingCalls() {
 	if (!m_abort_handler) {
 		return;
 	}
 
-	return m_abort_handler->abort(thread);
+	return m_abort_handler->abort();
 }
 
 size_t Entry::parseInteger(const char *data, const size_t bytes, int &result) const {
@@ -56,9 +75,14 @@ size_t Entry::parseInteger(const char *data, const size_t bytes, int &result) co
 }
 
 void Entry::getStat(struct stat *s) const {
+	fillStat(s, getModifyTime());
+}
+
+void Entry::fillStat(struct stat *s, const cosmos::RealTime &modify_time) const {
+	s->st_ino = inode();
 	s->st_uid = m_uid;
 	s->st_gid = m_gid;
-	s->st_atim = s->st_mtim = getModifyTime();
+	s->st_atim = s->st_mtim = modify_time;
 	s->st_ctim = getStatusTime();
 
 	switch(m_type) {
@@ -84,6 +108,17 @@ void Entry::getStat(struct stat *s) const {
 	s->st_mode &= ~(cosmos::to_integral(Xwmfs::getUmask().raw()));
 }
 
+unsigned Entry::poll(OpenContext *ctx, struct fuse_pollhandle *ph) {
+	(void)ctx;
+
+	if (ph) {
+		// readiness never changes, no need to notify
+		fuse_pollhandle_destroy(ph);
+	}
+
+	return POLLIN | (isWritable() ? POLLOUT : 0);
+}
+
 int Entry::isOperationAllowed() const {
 	if (isDeleted()) {
 		// difficult to say what the correct errno for "file
@@ -97,6 +132,10 @@ int Entry::isOperationAllowed() const {
 	return 0;
 }
 
+bool Entry::isRoot() const {
+	return m_parent == this;
+}
+
 void Entry::setParent(DirEntry *dir) {
 	m_parent = dir;
 
@@ -131,12 +170,9 @@ OpenContext* Entry::createOpenContext() {
 void Entry::destroyOpenContext(OpenContext *ctx) {
 	delete ctx;
 
-	if (this->unref()) {
-		// deleting this entry should not require a write guard,
-		// because we're the last user of the file nobody else should
-		// know about it ...
-		delete this;
-	}
+	// if we're the last user then the entry has already been removed
+	// from the file system, but lock-free readers may still see it.
+	this->release();
 }
 
 } // end ns
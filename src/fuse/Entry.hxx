@@ -2,11 +2,11 @@
 
 // C++
 #include <atomic>
+#include <cstdint>
 #include <memory>
 
 // cosmos
 #include <cosmos/fwd.hxx>
-#include <cosmos/thread/pthread.hxx>
 #include <cosmos/time/types.hxx>
 
 // POSIX
@@ -18,6 +18,7 @@
 
 // forward declarations
 struct stat;
+struct fuse_pollhandle;
 
 namespace xwmfs {
 
@@ -48,6 +49,9 @@ public: // types
 	enum class Bytes : int {
 	};
 
+	/// The inode number of the file system root, as expected by FUSE.
+	static constexpr uint64_t ROOT_INODE = 1;
+
 public: // functions
 
 	// make sure entries are never flat-copied
@@ -101,7 +105,10 @@ public: // functions
 	bool isWritable() const { return m_writable; }
 
 	/// Sets the modification time of the file system entry to `t`.
-	void setModifyTime(const cosmos::RealTime &t) { m_modify_time = t; }
+	/**
+	 * This also invalidates the kernel's cached attributes of the entry.
+	 **/
+	virtual void setModifyTime(const cosmos::RealTime &t);
 
 	/// Sets the status time of the file system entry to `t`.
 	void setStatusTime(const cosmos::RealTime &t) { m_status_time = t; }
@@ -115,10 +122,46 @@ public: // functions
 	/// Fills in status information corresponding to this entry into `s`.
 	virtual void getStat(struct stat *s) const;
 
+	/// Returns the inode number representing this entry towards FUSE.
+	/**
+	 * The inode number is derived from the object's address, thus it is
+	 * unique and stable for the lifetime of the entry. The kernel holds
+	 * a reference for each lookup of the inode until it forgets about it
+	 * again, thus an address is never reused while the kernel still
+	 * knows the inode. The file system root is represented by
+	 * ROOT_INODE.
+	 **/
+	uint64_t inode() const {
+		return isRoot() ? ROOT_INODE : reinterpret_cast<uintptr_t>(this);
+	}
+
+	/// Returns whether this is the file system root entry, which is its own parent.
+	bool isRoot() const;
+
+	/// Returns the parent directory of this entry.
+	DirEntry* parent() const { return m_parent; }
+
 	/// Increases the node reference count
 	void ref() { m_refcount++; }
-	/// Decreases the node reference count and returns whether the entry must be deleted.
-	bool unref() { return --m_refcount == 0; }
+	/// Increases the node reference count unless it already dropped to zero.
+	/**
+	 * Entries found via lock-free lookups may already be on their way
+	 * to reclamation. This function only succeeds if the entry is still
+	 * alive.
+	 **/
+	bool tryRef() {
+		auto count = m_refcount.load();
+		do {
+			if (count == 0)
+				return false;
+		} while (!m_refcount.compare_exchange_weak(count, count + 1));
+
+		return true;
+	}
+	/// Decreases the node reference count by `count` and returns whether the entry must be deleted.
+	bool unref(const size_t count = 1) { return m_refcount.fetch_sub(count) == count; }
+	/// Decreases the node reference count by `count` and retires the entry if it was the last one.
+	void release(const size_t count = 1);
 	/// Marks the entry for deletion and unreferences it, returns unref().
 	virtual bool markDeleted() { m_deleted = true; return unref(); }
 	/// Returns whether this entry is pending for deletion.
@@ -167,6 +210,19 @@ public: // functions
 		throw cosmos::Errno::OP_NOT_SUPPORTED;
 	}
 
+	/// Returns the current I/O readiness of the open file `ctx`.
+	/**
+	 * This implements poll(2) and friends. The returned value is a mask
+	 * of POLL* flags. If `ph` is not nullptr then the caller wants to be
+	 * notified via fuse_lowlevel_notify_poll() once the readiness
+	 * changes. The callee takes ownership of `ph` and needs to destroy it
+	 * eventually.
+	 *
+	 * By default entries are always ready for reading and, if writable,
+	 * for writing.
+	 **/
+	virtual unsigned poll(OpenContext *ctx, struct fuse_pollhandle *ph);
+
 	/// Sets the parent directory for this entry.
 	void setParent(DirEntry *dir);
 
@@ -212,13 +268,29 @@ public: // functions
 	 **/
 	virtual bool enableDirectIO() const { return false; }
 
-	/// Abort an ongoing blocking read call, if any and if supported.
-	void abortBlockingCall(const cosmos::pthread::ID thread);
+	/// Returns whether read calls on this entry may block.
+	/**
+	 * This is the case for entries that created an AbortHandler. Only
+	 * the requests for such entries need to be tracked for interrupts.
+	 **/
+	bool mayBlock() const { return m_abort_handler != nullptr; }
+
+	/// Wakes up ongoing blocking read calls, if any and if supported.
+	/**
+	 * The woken calls abort if their request has been interrupted, see
+	 * AbortHandler::wasAborted().
+	 **/
+	void abortBlockingCalls();
 
 protected: // functions
 
 	void createAbortHandler(cosmos::Condition &cond);
 
+	void createAbortHandler(cosmos::Mutex &lock, AbortHandler::WakeupFunc wakeup);
+
+	/// Fills in status information using the given modification time.
+	void fillStat(struct stat *s, const cosmos::RealTime &modify_time) const;
+
 	/// Constructs a new file system entry.
 	/**
 	 * This constructor is protected, as a file system entry should only
@@ -265,18 +337,22 @@ protected: // data
 	static const gid_t m_gid;
 
 	/// Whether the file system entry was removed and is pending deletion.
-	bool m_deleted = false;
+	std::atomic_bool m_deleted = false;
 
 	/// Reference count of the file system entry.
 	/**
 	 * This counter is 1 upon construction and is increased for each open
 	 * file description on the FUSE side, decreased again for each closed
-	 * file description.
+	 * file description. Likewise each FUSE lookup of the entry's inode
+	 * takes a reference, which is dropped again when the kernel forgets
+	 * about the inode. Lookups within FUSE threads don't take a
+	 * reference but rely on an EpochGuard instead.
 	 *
 	 * Entries a typically not removed on FUSE request but from the X11
 	 * side, because a Window disappears or alike. In this case the
 	 * initial single reference is decremented. Whoever drops the count to
-	 * zero needs to delete the entry from memory.
+	 * zero needs to hand the entry over to the EpochReclaimer, which
+	 * deletes it once no lock-free reader can see it anymore.
 	 *
 	 * This complex handling is necessary, because multiple clients can
 	 * open a file at the same time and also, because the removals
@@ -0,0 +1,134 @@
+// C++
+#include <algorithm>
+#include <limits>
+
+// xwmfs
+#include "fuse/EpochReclaimer.hxx"
+
+namespace xwmfs {
+
+thread_local EpochReclaimer::ThreadReader EpochReclaimer::m_thread_reader;
+
+EpochReclaimer& EpochReclaimer::getInstance() {
+	static EpochReclaimer instance;
+	return instance;
+}
+
+EpochReclaimer::Reader& EpochReclaimer::threadReader() {
+	if (auto reader = m_thread_reader.reader; reader) {
+		return *reader;
+	}
+
+	// try to reuse the record of a thread that has exited
+	for (auto reader = m_readers.load(); reader; reader = reader->next) {
+		bool expected = false;
+		if (reader->used.compare_exchange_strong(expected, true)) {
+			m_thread_reader.reader = reader;
+			return *reader;
+		}
+	}
+
+	auto reader = new Reader{};
+	reader->epoch = IDLE;
+	reader->used = true;
+	reader->next = m_readers.load();
+
+	while (!m_readers.compare_exchange_weak(reader->next, reader)) {
+		// reader->next has been updated, try again
+	}
+
+	m_thread_reader.reader = reader;
+	return *reader;
+}
+
+void EpochReclaimer::enter() {
+	auto &reader = threadReader();
+
+	if (reader.nesting++ != 0) {
+		return;
+	}
+
+	reader.epoch.store(m_epoch.load());
+
+	/*
+	 * The announcement must be visible before we look at any shared
+	 * pointers. Otherwise reclaim() could miss us and free an object we
+	 * are about to load.
+	 */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void EpochReclaimer::leave() {
+	auto &reader = threadReader();
+
+	if (--reader.nesting != 0) {
+		return;
+	}
+
+	reader.epoch.store(IDLE);
+
+	/*
+	 * Pairs with reclaim(), which sets the flag before inspecting
+	 * readers: either it sees us idle or we see the flag.
+	 */
+	if (m_readers_pending.load() && m_readers_pending.exchange(false) && m_wakeup) {
+		m_wakeup();
+	}
+}
+
+void EpochReclaimer::retire(const void *obj, Deleter deleter) {
+	cosmos::MutexGuard g{m_retired_lock};
+	// readers entering from now on observe a newer epoch and can't
+	// reach the object anymore.
+	const auto epoch = m_epoch.fetch_add(1);
+
+	if (m_retired.empty() && m_wakeup) {
+		m_wakeup();
+	}
+
+	m_retired.push_back(Retired{epoch, obj, deleter});
+}
+
+EpochReclaimer::Epoch EpochReclaimer::oldestReader() const {
+	auto ret = std::numeric_limits<Epoch>::max();
+
+	for (auto reader = m_readers.load(); reader; reader = reader->next) {
+		if (const auto epoch = reader->epoch.load(); epoch != IDLE) {
+			ret = std::min(ret, epoch);
+		}
+	}
+
+	return ret;
+}
+
+size_t EpochReclaimer::reclaim() {
+	std::vector<Retired> ready;
+
+	{
+		cosmos::MutexGuard g{m_retired_lock};
+		m_readers_pending.store(true);
+		const auto oldest = oldestReader();
+
+		auto it = std::stable_partition(m_retired.begin(), m_retired.end(),
+			[oldest](const Retired &retired) {
+				return retired.epoch >= oldest;
+			});
+
+		ready.assign(it, m_retired.end());
+		m_retired.erase(it, m_retired.end());
+
+		if (m_retired.empty()) {
+			m_readers_pending.store(false);
+		}
+	}
+
+	// freeing objects may retire further objects (e.g. the parent of a
+	// deleted Entry), thus don't hold the lock while doing so.
+	for (auto &retired: ready) {
+		retired.deleter(retired.obj);
+	}
+
+	return ready.size();
+}
+
+} // end ns
@@ -0,0 +1,181 @@
+#pragma once
+
+// C++
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// cosmos
+#include <cosmos/thread/Mutex.hxx>
+
+namespace xwmfs {
+
+/// Epoch based reclamation of objects removed from the file system tree.
+/**
+ * FUSE threads look up entries in the file system without taking any locks.
+ * For this to be safe, objects that have been unlinked from the tree must
+ * not be freed while a reader might still be looking at them. Readers thus
+ * announce themselves by means of an EpochGuard for the duration of a file
+ * system operation. Writers hand unlinked objects over to retire() instead
+ * of deleting them. retire() records the current global epoch and advances
+ * it. reclaim() frees all retired objects whose epoch is older than the
+ * epoch observed by the oldest active reader.
+ *
+ * Entering and leaving a reader section is wait-free, apart from the first
+ * use in a thread, which registers a per-thread reader record. retire() and
+ * reclaim() serialize among each other via an internal mutex. reclaim() is
+ * called from the event thread. The wakeup function is invoked when objects
+ * are retired while none were pending, and when the last reader that kept
+ * objects from being reclaimed leaves, so that the event thread doesn't
+ * have to wait for the next X event.
+ *
+ * Readers must not block for an unbounded time within an EpochGuard, since
+ * this prevents any memory from being reclaimed.
+ **/
+class EpochReclaimer {
+	friend class EpochGuard;
+public: // types
+
+	using Epoch = uint64_t;
+	using WakeupFunc = std::function<void ()>;
+
+public: // functions
+
+	static EpochReclaimer& getInstance();
+
+	EpochReclaimer(const EpochReclaimer&) = delete;
+	EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+	/// Schedules `obj` for deletion once no reader can observe it anymore.
+	/**
+	 * The object must already be unreachable for readers that enter
+	 * after this call, i.e. it must have been unlinked from the file
+	 * system tree before.
+	 **/
+	template <typename T>
+	void retire(T *obj) {
+		retire(obj, [](const void *p) { delete static_cast<const T*>(p); });
+	}
+
+	/// Frees all retired objects that can no longer be observed by readers.
+	/**
+	 * \return
+	 * 	The number of objects that have been freed.
+	 **/
+	size_t reclaim();
+
+	/// Sets the function to call when reclaim() should be called again.
+	/**
+	 * The function may be called with internal locks held and from
+	 * within EpochGuards. It must not block. It must be set before
+	 * concurrent use begins.
+	 **/
+	void setWakeup(WakeupFunc wakeup) {
+		m_wakeup = wakeup;
+	}
+
+protected: // types
+
+	using Deleter = void (*)(const void*);
+
+	struct Retired {
+		/// The global epoch at the time the object was retired.
+		Epoch epoch;
+		const void *obj;
+		Deleter deleter;
+	};
+
+	/// Per-thread reader state.
+	struct Reader {
+		/// The epoch observed when entering, or IDLE.
+		std::atomic<Epoch> epoch;
+		/// Whether a thread currently owns this record.
+		std::atomic_bool used;
+		/// Nesting level of EpochGuards, only accessed by the owner.
+		size_t nesting = 0;
+		Reader *next = nullptr;
+	};
+
+	/// Releases a thread's reader record again when the thread exits.
+	struct ThreadReader {
+		~ThreadReader() {
+			if (reader) {
+				reader->used = false;
+			}
+		}
+
+		Reader *reader = nullptr;
+	};
+
+	/// Reader epoch value denoting an inactive reader.
+	static constexpr Epoch IDLE = 0;
+
+protected: // functions
+
+	EpochReclaimer() = default;
+
+	void retire(const void *obj, Deleter deleter);
+
+	/// Marks the calling thread as an active reader.
+	void enter();
+
+	/// Marks the calling thread as inactive again.
+	void leave();
+
+	/// Returns the reader record for the calling thread, registering one if necessary.
+	Reader& threadReader();
+
+	/// Returns the oldest epoch observed by any active reader.
+	Epoch oldestReader() const;
+
+protected: // data
+
+	/// The current global epoch, starting out at one to distinguish it from IDLE.
+	std::atomic<Epoch> m_epoch = 1;
+	/// Singly linked list of all reader records ever registered.
+	/**
+	 * Records are never freed, but reused once the owning thread exits.
+	 * Their number is thus bounded by the maximum number of concurrent
+	 * FUSE threads.
+	 **/
+	std::atomic<Reader*> m_readers = nullptr;
+	/// Protects m_retired.
+	cosmos::Mutex m_retired_lock;
+	/// Objects waiting for reclamation.
+	std::vector<Retired> m_retired;
+	/// Whether reclaim() had to keep objects due to active readers.
+	std::atomic_bool m_readers_pending = false;
+	/// Function to wake up the event thread for calling reclaim().
+	WakeupFunc m_wakeup;
+	/// The reader record of the calling thread.
+	static thread_local ThreadReader m_thread_reader;
+};
+
+/// Marks the current thread as an epoch reader for the lifetime of the object.
+/**
+ * Entries and directory contents looked up while this guard exists stay
+ * valid until it is destroyed, even if they are removed from the file
+ * system in the meantime. Guards can be nested.
+ **/
+class EpochGuard {
+public: // functions
+
+	EpochGuard() :
+			m_reclaimer{EpochReclaimer::getInstance()} {
+		m_reclaimer.enter();
+	}
+
+	~EpochGuard() {
+		m_reclaimer.leave();
+	}
+
+	EpochGuard(const EpochGuard&) = delete;
+	EpochGuard& operator=(const EpochGuard&) = delete;
+
+protected: // data
+
+	EpochReclaimer &m_reclaimer;
+};
+
+} // end ns
@@ -1,30 +1,59 @@
+// C++
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+// POSIX
+#include <endian.h>
+#include <poll.h>
+
+// FUSE
+#include <fuse_lowlevel.h>
+
 // cosmos
-#include <cosmos/error/RuntimeError.hxx>
+#include <cosmos/formatting.hxx>
+#include <cosmos/thread/Condition.hxx>
+#include <cosmos/time/Clock.hxx>
 
 // xwmfs
 #include "fuse/AbortHandler.hxx"
-#include "fuse/DirEntry.hxx"
 #include "fuse/EventFile.hxx"
 #include "fuse/OpenContext.hxx"
-#include "fuse/xwmfs_fuse.hxx"
 #include "main/Xwmfs.hxx"
 
 namespace xwmfs {
 
+namespace {
+
+const EventKind LOST_KIND = EventKind::intern(EventFile::LOST_EVENT);
+
+std::string lost_record(const size_t lost) {
+	return cosmos::sprintf("%s %zu\n", EventFile::LOST_EVENT, lost);
+}
+
+} // end anon ns
+
 struct EventOpenContext :
 		public OpenContext {
 
-	EventOpenContext(Entry *entry, const EventFile::Event::ID first_id) :
+	EventOpenContext(Entry *entry, cosmos::Mutex &lock, const uint64_t first_seq) :
 			OpenContext{entry},
-			cur_id{first_id} {
+			cond{lock},
+			cursor{first_seq} {
 	}
 
 	EventOpenContext(const EventOpenContext&) = delete;
 
+	~EventOpenContext() {
+		if (poll_handle) {
+			fuse_pollhandle_destroy(poll_handle);
+		}
+	}
+
 	/*
 	 * We don't offer to read partial events, but reduce our functionality
-	 * to providing complete events only. Thus we can switch to a
-	 * std::deque of a fixed maximum size.
+	 * to providing complete events only.
 	 *
 	 * The only question is about the kind of errno signaling. There's no
 	 * error to say "your buffer is too small". Because everything is
@@ -32,115 +61,344 @@ struct EventOpenContext :
 	 * silently truncates in such cases. That's what we do.
 	 */
 
-	/// The next event ID to present the reader.
-	EventFile::Event::ID cur_id = EventFile::Event::ID::INVALID;
+	/// Blocked readers of this context wait on this, bound to EventFile::m_lock.
+	cosmos::Condition cond;
+	/// The sequence number of the next event to present the reader.
+	uint64_t cursor = 0;
+	/// The number of threads currently blocking on `cond`.
+	size_t num_waiting = 0;
+	/// A pending poll notification request, if any.
+	struct fuse_pollhandle *poll_handle = nullptr;
+	/// The events this reader is interested in.
+	EventFile::Filter filter;
+	/// Whether EventFile::BinaryRecord structures are returned.
+	bool binary = false;
+	/// For an active filter, whether the events in EventFile::m_ring match, indexed the same way.
+	std::vector<bool> matched;
+	/// For an active filter, one past the sequence number of the newest matching event.
+	uint64_t match_end = 0;
+	/// For an active filter, the number of matching events that got lost.
+	size_t lost = 0;
 };
 
-EventFile::EventFile(DirEntry &parent, const std::string &name,
-			const cosmos::RealTime &time, const size_t max_backlog) :
-		Entry{name, REG_FILE, time},
-		m_max_backlog{max_backlog},
-		m_cond{parent.getLock()} {
-	this->createAbortHandler(m_cond);
+EventFile::Settings EventFile::Settings::parse(const std::string_view spec) {
+	Settings ret;
+	auto &filter = ret.filter;
+	constexpr std::string_view CLASS_PREFIX{"class="};
+	constexpr std::string_view FORMAT_PREFIX{"format="};
+	constexpr std::string_view SPACE{" \t\r\n"};
+	size_t pos = 0;
+
+	while ((pos = spec.find_first_not_of(SPACE, pos)) != spec.npos) {
+		auto end = spec.find_first_of(SPACE, pos);
+		const auto word = spec.substr(pos, end == spec.npos ? end : end - pos);
+		pos = end;
+
+		if (word.starts_with(CLASS_PREFIX)) {
+			filter.window_class = word.substr(CLASS_PREFIX.size());
+			continue;
+		} else if (word.starts_with(FORMAT_PREFIX)) {
+			const auto format = word.substr(FORMAT_PREFIX.size());
+
+			if (format == "binary") {
+				ret.binary = true;
+			} else if (format == "text") {
+				ret.binary = false;
+			} else {
+				throw cosmos::Errno::INVALID_ARG;
+			}
+
+			continue;
+		}
+
+		EventKind kind;
+
+		// all kinds that can occur are registered at startup, don't
+		// let readers grow the registry with arbitrary names
+		if (!EventKind::lookup(word, kind)) {
+			throw cosmos::Errno::INVALID_ARG;
+		}
+
+		const auto id = kind.id();
+
+		if (filter.kinds.size() <= id) {
+			filter.kinds.resize(id + 1);
+		}
+
+		filter.kinds[id] = true;
+	}
+
+	return ret;
+}
+
+bool EventFile::Filter::matches(const EventKind kind, std::string_view classes) const {
+	if (!kinds.empty() && (kind.id() >= kinds.size() || !kinds[kind.id()])) {
+		return false;
+	} else if (window_class.empty()) {
+		return true;
+	}
+
+	while (!classes.empty()) {
+		const auto end = classes.find('\n');
+
+		if (classes.substr(0, end) == window_class) {
+			return true;
+		} else if (end == classes.npos) {
+			break;
+		}
+
+		classes.remove_prefix(end + 1);
+	}
+
+	return false;
+}
+
+EventFile::EventFile(const std::string &name,
+			const cosmos::RealTime &time, const size_t max_backlog,
+			const WithValues with_values) :
+		Entry{name, REG_FILE, time, Writable{true}},
+		m_ring(std::max(max_backlog, size_t{1})),
+		m_with_values{with_values} {
+	this->createAbortHandler(m_lock, [this]() { wakeReaders(true); });
 }
 
 bool EventFile::markDeleted() {
-	bool ret;
+	PollHandles handles;
+	bool ret = false;
 
 	{
-		cosmos::MutexGuard g{m_parent->getLock()};
+		cosmos::MutexGuard g{m_lock};
 		ret = Entry::markDeleted();
+
+		// make sure any blocked readers notice we're gone
+		wakeReaders(true);
+		handles = takePollers(true);
 	}
 
-	// make sure any blocked readers notice we're gone
-	m_cond.broadcast();
+	notifyPollers(handles);
 
 	return ret;
 }
 
-EventFile::Event::ID EventFile::nextID() {
-	m_next_id = Event::ID{cosmos::to_integral(m_next_id) + 1};
-	return m_next_id;
-}
+void EventFile::addEvent(const EventKind kind, const EventInfo &info) {
+	PollHandles handles;
 
-void EventFile::addEvent(const std::string &text) {
 	{
-		cosmos::MutexGuard g{m_parent->getLock()};
+		cosmos::MutexGuard g{m_lock};
 
-		// reflect the most recent event time as modification time
-		this->setModifyTime(Xwmfs::getInstance().getCurrentTime());
-
-		if (!m_refcount) {
-			// no readers, so nothing to do
+		if (!storeEvent(kind, info)) {
 			return;
 		}
 
-		if (m_event_queue.size() == m_max_backlog) {
-			// drop the oldest event
-			m_event_queue.pop_front();
+		handles = takePollers();
+	}
+
+	notifyPollers(handles);
+}
+
+bool EventFile::storeEvent(const EventKind kind, const EventInfo &info) {
+	// reflect the most recent event time as modification time
+	this->setModifyTime(Xwmfs::getInstance().getCurrentTime());
+
+	if (m_num_readers == 0) {
+		// no readers, so nothing to do
+		return false;
+	}
+
+	applyFilters(m_next_seq, kind, info.classes);
+
+	const auto now = cosmos::MonotonicClock{}.now();
+
+	// this overwrites the oldest event once the ring is full
+	auto &slot = m_ring[m_next_seq % m_ring.size()];
+	slot.seq = m_next_seq++;
+	slot.monotonic_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+	slot.kind = kind;
+	slot.window = info.window;
+	slot.show_window = info.show_window;
+	slot.origin = info.origin;
+
+	if (m_with_values) {
+		// only allocates if the value exceeds previous ones in this slot
+		slot.value.assign(info.value.value_or(std::string_view{}));
+		slot.has_value = info.value.has_value();
+	}
+
+	wakeReaders();
+	return true;
+}
+
+size_t EventFile::formatEvent(const Event &event, char *line, const size_t size) const {
+	size_t length = 0;
+
+	auto append = [&](const std::string_view part) {
+		if (length < size) {
+			std::memcpy(line + length, part.data(), std::min(part.size(), size - length));
+		}
+
+		length += part.size();
+	};
+
+	append(event.kind.name());
+
+	if (event.show_window) {
+		char window[16];
+		const auto res = std::to_chars(window, window + sizeof(window), event.window, 16);
+		append(" 0x");
+		append(std::string_view{window, static_cast<size_t>(res.ptr - window)});
+	}
+
+	if (!m_with_values || !event.has_value) {
+		// unknown values are omitted to tell them apart from empty ones
+		return length;
+	}
+
+	append(" ");
+
+	std::string_view value{event.value};
+
+	// file contents end in a newline, which is implied by the record
+	if (value.ends_with('\n')) {
+		value.remove_suffix(1);
+	}
+
+	// escape characters that would break up the record
+	while (!value.empty()) {
+		const auto special = value.find_first_of("\\\n");
+		append(value.substr(0, special));
+
+		if (special == value.npos) {
+			break;
+		}
+
+		append(value[special] == '\n' ? "\\n" : "\\\\");
+		value.remove_prefix(special + 1);
+	}
+
+	return length;
+}
+
+void EventFile::applyFilters(const uint64_t seq, const EventKind kind, const std::string_view classes) {
+	const auto index = seq % m_ring.size();
+
+	for (auto ctx: m_filtered) {
+		// the event about to be replaced is lost if it was still to be read
+		if (ctx->matched[index] && seq >= m_ring.size() && ctx->cursor <= seq - m_ring.size()) {
+			ctx->lost++;
 		}
 
-		m_event_queue.push_back(Event{text, nextID()});
+		const bool match = ctx->filter.matches(kind, classes);
+		ctx->matched[index] = match;
 
-		if (m_next_id == Event::ID::INVALID) {
-			m_next_id = Event::ID{0};
+		if (match) {
+			ctx->match_end = seq + 1;
 		}
 	}
+}
+
+void EventFile::encodeEvent(const Event &event, char *out) {
+	const BinaryRecord record{
+		htole64(event.seq),
+		htole64(event.monotonic_ns),
+		htole32(event.origin.server_time),
+		htole32(event.window),
+		htole32(event.origin.atom),
+		htole32(event.kind.id())
+	};
+
+	std::memcpy(out, &record, sizeof(record));
+}
 
-	// wake up all readers so they can read the new event, if possible.
-	m_cond.broadcast();
+bool EventFile::isSelected(const EventOpenContext &ctx, const uint64_t seq) const {
+	return !ctx.filter.active() || ctx.matched[seq % m_ring.size()];
 }
 
-const EventFile::Event* EventFile::nextEvent(const Event::ID prev_id) {
-	if (m_event_queue.empty()) {
-		return nullptr;
+bool EventFile::hasEvent(const EventOpenContext &ctx) const {
+	if (ctx.filter.active()) {
+		return ctx.cursor < ctx.match_end;
 	}
 
-	const auto num_events = m_event_queue.size();
-	const auto oldest_id = m_event_queue.front().id;
-	const auto newest_id = m_event_queue.back().id;
+	return ctx.cursor != m_next_seq;
+}
 
-	if (prev_id == Event::ID::INVALID || oldest_id > prev_id) {
-		// no previous event available, return the oldest one then
-		return &m_event_queue.front();
-	} else if (newest_id == prev_id) {
-		// no new event available
-		return nullptr;
-	} else if (oldest_id > newest_id) {
-		// id wraparound situation, fallback to linear search to find
-		// the right current event.
-		bool found_prev = false;
-		for (const auto &event: m_event_queue) {
-			if (found_prev) {
-				return &event;
-			} else if (event.id == prev_id) {
-				found_prev = true;
-			}
+void EventFile::wakeReaders(const bool all) {
+	for (auto ctx: m_waiters) {
+		if (all || hasEvent(*ctx)) {
+			ctx->cond.broadcast();
 		}
+	}
+}
 
-		// shouldn't happen, but you never know.
-		throw cosmos::RuntimeError{"failed to find next event"};
+void EventFile::waitForEvent(EventOpenContext &ctx) {
+	if (ctx.num_waiting++ == 0) {
+		m_waiters.push_back(&ctx);
 	}
-	else if (oldest_id > prev_id) {
-		// some events have been lost for this reader, return the
-		// oldest instead
-		//
-		// NOTE: only check for this after the wraparound check above,
-		// to prevent wrong logic.
-		return &m_event_queue.front();
-	} else {
-		// just return the next event then
-		const auto index = cosmos::to_integral(prev_id) - cosmos::to_integral(oldest_id) + 1;
-		return &(m_event_queue[index]);
+
+	ctx.cond.wait();
+
+	if (--ctx.num_waiting == 0) {
+		auto it = std::find(m_waiters.begin(), m_waiters.end(), &ctx);
+		*it = m_waiters.back();
+		m_waiters.pop_back();
 	}
 }
 
-int EventFile::readEvent(EventOpenContext &ctx, char *buf, size_t size) {
-	const Event *event = nullptr;
+EventFile::PollHandles EventFile::takePollers(const bool all) {
+	PollHandles ret;
+
+	for (size_t i = 0; i < m_pollers.size();) {
+		auto ctx = m_pollers[i];
+
+		if (!all && !hasEvent(*ctx)) {
+			i++;
+			continue;
+		}
+
+		ret.push_back(std::exchange(ctx->poll_handle, nullptr));
+		m_pollers[i] = m_pollers.back();
+		m_pollers.pop_back();
+	}
+
+	return ret;
+}
+
+void EventFile::notifyPollers(const PollHandles &handles) {
+	for (auto ph: handles) {
+		// a notification only causes the kernel to poll() again
+		fuse_lowlevel_notify_poll(ph);
+		fuse_pollhandle_destroy(ph);
+	}
+}
+
+unsigned EventFile::poll(OpenContext *ctx, struct fuse_pollhandle *ph) {
+	auto &evt_ctx = *(reinterpret_cast<EventOpenContext*>(ctx));
+
+	cosmos::MutexGuard g{m_lock};
+
+	if (isDeleted() || hasEvent(evt_ctx)) {
+		if (ph) {
+			fuse_pollhandle_destroy(ph);
+		}
+
+		return POLLIN;
+	} else if (ph) {
+		// only the most recent handle is of interest
+		if (evt_ctx.poll_handle) {
+			fuse_pollhandle_destroy(evt_ctx.poll_handle);
+		} else {
+			m_pollers.push_back(&evt_ctx);
+		}
+
+		evt_ctx.poll_handle = ph;
+	}
+
+	return 0;
+}
 
-	cosmos::MutexGuard g{m_parent->getLock()};
+int EventFile::readEvents(EventOpenContext &ctx, char *buf, size_t size) {
+	cosmos::MutexGuard g{m_lock};
 
-	while ((event = nextEvent(ctx.cur_id)) == nullptr) {
+	while (!hasEvent(ctx)) {
 		if (this->isDeleted()) {
 			// file was closed in the meantime, signal EOF
 			return 0;
@@ -155,18 +413,95 @@ int EventFile::readEvent(EventOpenContext &ctx, char *buf, size_t size) {
 		if (!m_abort_handler->prepareBlockingCall(this)) {
 			return -EINTR;
 		}
-		m_cond.wait();
+		waitForEvent(ctx);
 		m_abort_handler->finishedBlockingCall();
 	}
 
-	const auto copy_size = std::min(event->text.size(), size - 1);
-	std::memcpy(buf, (event->text).c_str(), copy_size);
-	// ship a newline after each event
-	buf[copy_size] = '\n';
+	if (ctx.binary && size < sizeof(BinaryRecord)) {
+		// like inotify(7) we don't truncate binary records
+		return -EINVAL;
+	}
+
+	const bool filtered = ctx.filter.active();
+	const auto oldest = oldestSeq();
+	size_t lost = filtered ? ctx.lost : 0;
+
+	if (!filtered && ctx.cursor < oldest) {
+		lost = oldest - ctx.cursor;
+	}
+
+	if (!ctx.binary && lost != 0 && lost_record(lost).size() > size) {
+		// don't drop the record, the reader can retry with a larger buffer
+		return -EINVAL;
+	}
+
+	ctx.lost = 0;
+	ctx.cursor = std::max(ctx.cursor, oldest);
+
+	const auto used = ctx.binary ?
+		readBinary(ctx, buf, size, lost) : readText(ctx, buf, size, lost);
+
+	return static_cast<int>(used);
+}
+
+size_t EventFile::readText(EventOpenContext &ctx, char *buf, size_t size, const size_t lost) {
+	size_t used = 0;
+
+	// let the reader know if it missed some events
+	if (lost != 0) {
+		// readEvents() made sure that the record fits
+		const auto record = lost_record(lost);
+		std::memcpy(buf, record.data(), record.size());
+		used += record.size();
+	}
+
+	// return as many complete events as fit into the buffer
+	for (; hasEvent(ctx) && used < size; ctx.cursor++) {
+		if (!isSelected(ctx, ctx.cursor)) {
+			continue;
+		}
+
+		// render directly into the buffer, reserving room for the newline
+		const auto avail = size - used - 1;
+		const auto length = formatEvent(eventAt(ctx.cursor), buf + used, avail);
+
+		if (length > avail && used != 0) {
+			// doesn't fit anymore, keep it for the next read
+			break;
+		}
+
+		// ship a newline after each event, if not even a single
+		// event fits then it's truncated.
+		const auto copied = std::min(length, avail);
+		buf[used + copied] = '\n';
+		used += copied + 1;
+	}
+
+	return used;
+}
+
+size_t EventFile::readBinary(EventOpenContext &ctx, char *buf, size_t size, const size_t lost) {
+	size_t used = 0;
 
-	ctx.cur_id = event->id;
+	if (lost != 0) {
+		Event record;
+		record.seq = ctx.cursor;
+		record.kind = LOST_KIND;
+		record.origin.atom = static_cast<uint32_t>(lost);
+		encodeEvent(record, buf);
+		used += sizeof(BinaryRecord);
+	}
 
-	return copy_size + 1;
+	for (; hasEvent(ctx) && used + sizeof(BinaryRecord) <= size; ctx.cursor++) {
+		if (!isSelected(ctx, ctx.cursor)) {
+			continue;
+		}
+
+		encodeEvent(eventAt(ctx.cursor), buf + used);
+		used += sizeof(BinaryRecord);
+	}
+
+	return used;
 }
 
 EventFile::Bytes EventFile::read(OpenContext *ctx, char *buf, size_t size, off_t offset) {
@@ -174,50 +509,80 @@ EventFile::Bytes EventFile::read(OpenContext *ctx, char *buf, size_t size, off_t
 	// the state of the open context here
 	(void)offset;
 	auto &evt_ctx = *(reinterpret_cast<EventOpenContext*>(ctx));
-	auto &fs_lock = xwmfs::Xwmfs::getInstance().getFS();
 
-	/*
-	 * This is a pretty stupid situation here. We need to release
-	 * the global filesystem read lock here to avoid deadlocks.
-	 * For example if the caller wants to close its file
-	 * descriptor while being blocked here, or practically any
-	 * other operation.
-	 *
-	 * Now that we have a mutex per directory we might just use
-	 * that one instead or the global lock to protect read
-	 * operations from write operations or events.
-	 *
-	 * The read lock is actually not required at all for
-	 * EventFile for reading, but in general is required for other
-	 * entry types and is taken in xwmfs_read early on.
-	 */
-
-	FileSysRevReadGuard guard{fs_lock};
-	const int ret = readEvent(evt_ctx, buf, size);
+	// no file system global lock is held here, and our own lock is
+	// independent of the parent directory, so we can block without
+	// hindering unrelated operations.
+	const int ret = readEvents(evt_ctx, buf, size);
 	return Bytes{ret};
 }
 
 EventFile::Bytes EventFile::write(OpenContext *ctx, const char *buf, size_t size, off_t offset) {
-	/*
-	 * writing to an event file is not supported at all
-	 */
-	(void)ctx;
-	(void)buf;
-	(void)size;
+	// every write replaces the settings, regardless of the offset
 	(void)offset;
-	throw cosmos::Errno::OP_NOT_SUPPORTED;
+	auto &evt_ctx = *(reinterpret_cast<EventOpenContext*>(ctx));
+	auto settings = Settings::parse(std::string_view{buf, size});
+
+	if (settings.binary && m_with_values) {
+		// BinaryRecord has no room for values
+		throw cosmos::Errno::INVALID_ARG;
+	}
+
+	cosmos::MutexGuard g{m_lock};
+
+	auto it = std::find(m_filtered.begin(), m_filtered.end(), &evt_ctx);
+
+	if (it != m_filtered.end()) {
+		m_filtered.erase(it);
+	}
+
+	evt_ctx.filter = std::move(settings.filter);
+	evt_ctx.binary = settings.binary;
+	// we don't know which of the pending events match the new filter
+	evt_ctx.cursor = m_next_seq;
+	evt_ctx.match_end = m_next_seq;
+	evt_ctx.lost = 0;
+
+	if (evt_ctx.filter.active()) {
+		evt_ctx.matched.assign(m_ring.size(), false);
+		m_filtered.push_back(&evt_ctx);
+	} else {
+		evt_ctx.matched.clear();
+	}
+
+	return Bytes{static_cast<int>(size)};
 }
 
 OpenContext* EventFile::createOpenContext() {
-	auto ret = new EventOpenContext{
-		this,
+	OpenContext *ret = nullptr;
+
+	{
+		cosmos::MutexGuard g{m_lock};
 		// make sure no outdated events are presented to new readers
-		m_event_queue.empty() ? Event::ID::INVALID : m_event_queue.back().id
-	};
+		ret = new EventOpenContext{this, m_lock, m_next_seq};
+		m_num_readers++;
+	}
 
 	this->ref();
 
 	return ret;
 }
 
+void EventFile::destroyOpenContext(OpenContext *ctx) {
+	{
+		cosmos::MutexGuard g{m_lock};
+		for (auto list: {&m_pollers, &m_filtered}) {
+			auto it = std::find(list->begin(), list->end(), ctx);
+
+			if (it != list->end()) {
+				list->erase(it);
+			}
+		}
+
+		m_num_readers--;
+	}
+
+	Entry::destroyOpenContext(ctx);
+}
+
 } // end ns
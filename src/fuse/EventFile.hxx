@@ -1,51 +1,122 @@
 #pragma once
 
 // C++
-#include <deque>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 // cosmos
-#include <cosmos/thread/Condition.hxx>
+#include <cosmos/thread/Mutex.hxx>
+#include <cosmos/utils.hxx>
 
 // xwmfs
 #include "fuse/Entry.hxx"
+#include "fuse/EventKind.hxx"
+#include "main/Options.hxx"
 
 namespace xwmfs {
 
 // forward declaration
 struct EventOpenContext;
 
+/// Information about the X event an EventFile event originates from.
+struct EventOrigin {
+	/// The X server timestamp, zero if unknown.
+	uint32_t server_time = 0;
+	/// The ID of the changed atom, zero if unknown.
+	uint32_t atom = 0;
+};
+
+/// Additional information about an event passed to EventFile::addEvent().
+struct EventInfo {
+	/// The ID of the X window the event relates to, zero if none.
+	uint32_t window = 0;
+	/// Whether text records name `window`, otherwise it's implied by the file.
+	bool show_window = false;
+	/// The newline separated class names of `window`, only used for filtering.
+	std::string_view classes;
+	EventOrigin origin;
+	/// The new value of a changed attribute, only kept by files created WithValues.
+	/**
+	 * This is unset if the new value isn't known, like for attributes
+	 * that are only fetched upon access.
+	 **/
+	std::optional<std::string_view> value;
+};
+
 /// A special file that allows readers to block until new events arrive.
 /**
  * While all other file system entries contain some small and defined amount
  * of data, an EventFile offers a potentially endless stream of data as new
  * events are coming in.
  *
- * Events can be arbitrary strings to be delivered to readers. Multiple
- * readers may block on an EventFile until new data arrives.
+ * Events are identified by their EventKind, whose name is delivered to
+ * readers. An event can optionally name the window it relates to, whose ID
+ * is then appended to the name in hexadecimal notation, like
+ * "created 0x1e00003". Multiple readers may block on an EventFile until new
+ * data arrives.
+ *
+ * Readers can alternatively switch to binary mode, in which each read
+ * returns an array of fixed size BinaryRecord structures.
+ *
+ * An EventFile created WithValues additionally stores the new value of the
+ * changed attribute with each event. It is appended to the text record, with
+ * newlines and backslashes escaped, like "geometry 0x1e00003 0,0:640x480".
+ * Such files only support text mode.
  *
- * If a reader is too slow to catch up with new events then it'll loose
- * some events in between without noticing.
+ * Each read returns as many complete events as fit into the read buffer. If
+ * a reader is too slow to catch up with new events then it'll loose the
+ * oldest events. This is reported via a LOST_EVENT record carrying the
+ * number of missed events, like "lost 5".
+ *
+ * Readers can write a filter specification to their open file, see
+ * Settings::parse(). Events not matching the filter are never delivered to
+ * the reader and don't wake it up.
+ *
+ * Events are kept in a ring buffer of fixed capacity that is shared by all
+ * readers. Each reader only keeps the sequence number of the next event it
+ * wants to see. Adding an event doesn't allocate any memory. The EventFile
+ * uses its own lock, independent of the parent directory, and each reader
+ * blocks on its own condition, which is only signaled if the reader has
+ * something to read.
  **/
 class EventFile :
 		public Entry {
-public:
+public: // types
+
+	/// Whether events carry the new value of a changed attribute.
+	using WithValues = cosmos::NamedBool<struct with_values_t, false>;
+
+public: // functions
 
 	/// Creates a new event file using the given name and initial timestamp.
 	/**
 	 * \param[in] max_backlog
 	 * 	Determines the maximum number of events that an active reader
 	 * 	may have in backlog before it's loosing the oldest events.
-	 * 	This is necessary to avoid infinite growth of the event queue
-	 * 	in case an active reader doesn't catch up with the data.
+	 * 	This is the fixed capacity of the event ring buffer.
 	 **/
-	EventFile(DirEntry &parent, const std::string &name, const cosmos::RealTime &time = cosmos::RealTime{},
-			const size_t max_backlog = 64);
+	EventFile(const std::string &name, const cosmos::RealTime &time = cosmos::RealTime{},
+			const size_t max_backlog = Options::getInstance().eventBacklog(),
+			const WithValues with_values = WithValues{false});
 
 	/// Creates an extended OpenContext with additional EventFile context data.
 	OpenContext* createOpenContext() override;
 
+	void destroyOpenContext(OpenContext *ctx) override;
+
+	/// Reports readability if a new event is available for `ctx`.
+	/**
+	 * If no event is available then `ph` is kept and the caller is
+	 * notified once the next event arrives. This allows a single thread
+	 * to wait for events on many files, using non-blocking reads.
+	 **/
+	unsigned poll(OpenContext *ctx, struct fuse_pollhandle *ph) override;
+
 	/// Adds a new event for potential readers to receive.
-	void addEvent(const std::string &text);
+	void addEvent(const EventKind kind, const EventInfo &info = EventInfo{});
 
 	bool enableDirectIO() const override { return true; }
 
@@ -57,47 +128,196 @@ public:
 
 public: // types
 
+	/// The name of the record reporting lost events to a reader.
+	static constexpr const char *LOST_EVENT = "lost";
+
+	/// A single recorded event.
 	struct Event {
-		enum class ID : size_t {
-			INVALID = SIZE_MAX
-		};
+		/// The position of the event in the stream of events of this file.
+		uint64_t seq = 0;
+		/// The CLOCK_MONOTONIC time the event was added at in nanoseconds.
+		uint64_t monotonic_ns = 0;
+		EventKind kind;
+		uint32_t window = 0;
+		bool show_window = false;
+		EventOrigin origin;
+		/// The EventInfo::value for files WithValues, its capacity is reused across events.
+		std::string value;
+		/// Whether the EventInfo::value was set.
+		bool has_value = false;
+	};
+
+	using EventRing = std::vector<Event>;
+
+	/// Poll handles taken from pending pollers, see takePollers().
+	using PollHandles = std::vector<struct fuse_pollhandle*>;
+
+	/// The record format returned to readers in binary mode.
+	/**
+	 * All fields are in little endian byte order. A LOST_EVENT record
+	 * carries the number of missed events in the `atom` field. The names
+	 * of the kind IDs can be obtained from EventKindsFile.
+	 **/
+	struct BinaryRecord {
+		uint64_t seq;
+		uint64_t monotonic_ns;
+		uint32_t server_time;
+		uint32_t window;
+		uint32_t atom;
+		uint32_t kind;
+	};
+
+	static_assert(sizeof(BinaryRecord) == 32);
 
-		std::string text;
-		ID id = ID{0};
+	/// Selects the events an individual reader is interested in.
+	struct Filter {
+		/// Matching event kinds indexed by EventKind::id(), all kinds if empty.
+		std::vector<bool> kinds;
+		/// The window class or instance name to match, any if empty.
+		std::string window_class;
 
-		Event(const std::string &s, ID _id) :
-			text{s}, id{_id} {
-		}
+		bool active() const { return !kinds.empty() || !window_class.empty(); }
+
+		bool matches(const EventKind kind, const std::string_view classes) const;
 	};
 
-	using EventQueue = std::deque<Event>;
+	/// The per reader settings written to an open EventFile.
+	struct Settings {
+		Filter filter;
+		/// Whether BinaryRecord structures are returned instead of text.
+		bool binary = false;
+
+		/// Parses a settings specification written by a reader.
+		/**
+		 * The specification consists of whitespace separated event
+		 * names to filter for. A word of the form "class=NAME"
+		 * additionally restricts events to windows whose class or
+		 * instance name is NAME. The word "format=binary" selects
+		 * binary mode, "format=text" the default text mode. An
+		 * empty specification matches all events in text mode.
+		 * Unknown event names or formats cause an INVALID_ARG
+		 * cosmos::Errno to be thrown.
+		 **/
+		static Settings parse(const std::string_view spec);
+	};
 
 protected: // functions
 
 	bool markDeleted() override;
 
 	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
+	/// Replaces the Settings of the writer's open context.
+	/**
+	 * Events that have not been read yet are discarded, thus the filter
+	 * should be written before reading the first event.
+	 **/
 	Bytes write(OpenContext *ctx, const char *buf, size_t size, off_t offset) override;
 
-	/// Returns a pointer to the next event in the queue coming after the event with `prev_id`.
+	/// Returns the sequence number of the oldest event still contained in m_ring.
+	uint64_t oldestSeq() const {
+		return m_next_seq > m_ring.size() ? m_next_seq - m_ring.size() : 0;
+	}
+
+	/// Returns the event with sequence number `seq`, which must still be contained in m_ring.
+	const Event& eventAt(const uint64_t seq) const {
+		return m_ring[seq % m_ring.size()];
+	}
+
+	/// Renders the textual record for `event` into `line`, without a trailing newline.
+	/**
+	 * \return
+	 * 	The resulting length, which may exceed `size`, in which case
+	 * 	the record has been truncated.
+	 **/
+	size_t formatEvent(const Event &event, char *line, const size_t size) const;
+
+	/// Stores the BinaryRecord for `event` in `out`.
+	static void encodeEvent(const Event &event, char *out);
+
+	/// Copies as many events as fit into `buf` as text.
+	size_t readText(EventOpenContext &ctx, char *buf, size_t size, const size_t lost);
+
+	/// Copies as many events as fit into `buf` as BinaryRecord structures.
+	size_t readBinary(EventOpenContext &ctx, char *buf, size_t size, const size_t lost);
+
+	/// Returns whether there is an unread event for `ctx`.
+	bool hasEvent(const EventOpenContext &ctx) const;
+
+	/// Copies as many complete events as fit into `buf`, blocking until at least one is available.
+	/**
+	 * If the reader missed some events then a LOST_EVENT record is
+	 * returned first. If it doesn't fit into `buf` then -EINVAL is
+	 * returned and the record is kept for the next read.
+	 **/
+	int readEvents(EventOpenContext &ctx, char *buf, size_t size);
+
+	/// Blocks the calling thread until `ctx` is signaled.
 	/**
-	 * This must be called with the parent lock held. Returns nullptr if
-	 * there is no next event yet. Events between `prev_id` and the
-	 * returned event may have been skipped if the reader took too much
-	 * time.
+	 * This must be called with m_lock held.
 	 **/
-	const Event* nextEvent(const Event::ID prev_id);
+	void waitForEvent(EventOpenContext &ctx);
 
-	int readEvent(EventOpenContext &ctx, char *buf, size_t size);
+	/// Wakes up blocked readers that have unread events.
+	/**
+	 * If `all` is set then every blocked reader is woken up, which is
+	 * necessary for aborting blocking calls and upon deletion. This
+	 * must be called with m_lock held.
+	 **/
+	void wakeReaders(const bool all = false);
+
+	/// Removes pending pollers that have unread events and returns their poll handles.
+	/**
+	 * If `all` is set then every pending poller is removed. This must be
+	 * called with m_lock held. The returned handles are to be passed to
+	 * notifyPollers() after m_lock has been released.
+	 **/
+	PollHandles takePollers(const bool all = false);
+
+	/// Notifies the kernel about readiness of `handles` and frees them.
+	/**
+	 * This talks to the kernel, thus it must not be called with m_lock
+	 * held.
+	 **/
+	static void notifyPollers(const PollHandles &handles);
+
+	/// Stores a new event in m_ring and wakes up blocked readers.
+	/**
+	 * This must be called with m_lock held.
+	 *
+	 * \return
+	 * 	`false` if nobody reads events, in which case the event isn't
+	 * 	stored.
+	 **/
+	bool storeEvent(const EventKind kind, const EventInfo &info);
+
+	/// Records whether the new event `seq` matches the filter of each filtering reader.
+	/**
+	 * This must be called with m_lock held, before the event replaces
+	 * the oldest event in m_ring.
+	 **/
+	void applyFilters(const uint64_t seq, const EventKind kind, const std::string_view classes);
 
-	Event::ID nextID();
+	/// Returns whether `seq` is to be presented to the reader of `ctx`.
+	bool isSelected(const EventOpenContext &ctx, const uint64_t seq) const;
 
 protected: // data
 
-	const size_t m_max_backlog;
-	cosmos::Condition m_cond;
-	EventQueue m_event_queue;
-	Event::ID m_next_id = Event::ID{0};
+	/// Protects all of the following data.
+	cosmos::Mutex m_lock;
+	/// The most recent events, indexed by their sequence number modulo its size.
+	EventRing m_ring;
+	/// The sequence number to assign to the next event.
+	uint64_t m_next_seq = 0;
+	/// The number of currently open contexts.
+	size_t m_num_readers = 0;
+	/// Open contexts with threads blocking in readEvents().
+	std::vector<EventOpenContext*> m_waiters;
+	/// Open contexts waiting for a poll notification.
+	std::vector<EventOpenContext*> m_pollers;
+	/// Open contexts with an active filter.
+	std::vector<EventOpenContext*> m_filtered;
+	/// Whether Event::value is stored and presented to readers.
+	const bool m_with_values;
 };
 
 } // end ns
@@ -0,0 +1,65 @@
+// C++
+#include <deque>
+#include <unordered_map>
+
+// cosmos
+#include <cosmos/thread/Mutex.hxx>
+
+// xwmfs
+#include "fuse/EventKind.hxx"
+
+namespace xwmfs {
+
+struct EventKind::Registry {
+	static Registry& getInstance() {
+		static Registry instance;
+		return instance;
+	}
+
+	cosmos::Mutex lock;
+	/// All registered kinds in order of their IDs, a std::deque keeps their addresses stable.
+	std::deque<Info> kinds;
+	/// Maps names to kinds, the keys refer to the names stored in `kinds`.
+	std::unordered_map<std::string_view, const Info*> index;
+};
+
+EventKind EventKind::intern(const std::string_view name) {
+	auto &registry = Registry::getInstance();
+	cosmos::MutexGuard g{registry.lock};
+
+	if (auto it = registry.index.find(name); it != registry.index.end()) {
+		return EventKind{it->second};
+	}
+
+	const auto &info = registry.kinds.emplace_back(
+		Info{static_cast<ID>(registry.kinds.size()), std::string{name}});
+	registry.index[info.name] = &info;
+
+	return EventKind{&info};
+}
+
+bool EventKind::lookup(const std::string_view name, EventKind &kind) {
+	auto &registry = Registry::getInstance();
+	cosmos::MutexGuard g{registry.lock};
+
+	if (auto it = registry.index.find(name); it != registry.index.end()) {
+		kind = EventKind{it->second};
+		return true;
+	}
+
+	return false;
+}
+
+size_t EventKind::count() {
+	auto &registry = Registry::getInstance();
+	cosmos::MutexGuard g{registry.lock};
+	return registry.kinds.size();
+}
+
+EventKind EventKind::fromID(const ID id) {
+	auto &registry = Registry::getInstance();
+	cosmos::MutexGuard g{registry.lock};
+	return EventKind{&registry.kinds.at(id)};
+}
+
+} // end ns
@@ -0,0 +1,87 @@
+#pragma once
+
+// C++
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace xwmfs {
+
+/// An interned event name like "geometry" or "destroyed".
+/**
+ * Event names are registered once in a process wide table and are then
+ * referred to by a pointer sized handle. This allows to store and compare
+ * events cheaply, without copying or allocating strings on the event path.
+ *
+ * Each kind has a small numerical ID which is assigned in order of
+ * registration. Registered kinds are never removed again, thus the
+ * name() reference stays valid for the lifetime of the program.
+ **/
+class EventKind {
+public: // types
+
+	using ID = uint32_t;
+
+public: // functions
+
+	/// Returns the kind for `name`, registering it if necessary.
+	/**
+	 * This function is thread safe. Only the registration of a
+	 * previously unknown name allocates memory. Frequently used kinds
+	 * should be looked up once and kept around.
+	 **/
+	static EventKind intern(const std::string_view name);
+
+	/// Returns the kind for `name`, if it has been registered before.
+	/**
+	 * \return
+	 * 	`false` if `name` isn't known, in which case `kind` is left
+	 * 	unchanged.
+	 **/
+	static bool lookup(const std::string_view name, EventKind &kind);
+
+	/// Returns the number of registered kinds, whose IDs are [0, count()).
+	static size_t count();
+
+	/// Returns the kind registered with `id`, which must be smaller than count().
+	static EventKind fromID(const ID id);
+
+	/// Creates an invalid kind that must not be used except for assignment.
+	EventKind() = default;
+
+	bool valid() const { return m_info != nullptr; }
+
+	const std::string& name() const { return m_info->name; }
+
+	ID id() const { return m_info->id; }
+
+	bool operator==(const EventKind &other) const {
+		return m_info == other.m_info;
+	}
+
+	bool operator!=(const EventKind &other) const {
+		return !(*this == other);
+	}
+
+protected: // types
+
+	struct Info {
+		ID id;
+		std::string name;
+	};
+
+	/// The process wide table of registered kinds.
+	struct Registry;
+
+protected: // functions
+
+	explicit EventKind(const Info *info) :
+			m_info{info} {
+	}
+
+protected: // data
+
+	const Info *m_info = nullptr;
+};
+
+} // end ns
@@ -0,0 +1,39 @@
+// C++
+#include <sstream>
+
+// xwmfs
+#include "fuse/EventKind.hxx"
+#include "fuse/EventKindsFile.hxx"
+
+namespace xwmfs {
+
+EventKindsFile::EventKindsFile(const std::string &n) :
+		FileEntry{n} {
+	updateKinds();
+}
+
+Entry::Bytes EventKindsFile::read(OpenContext *ctx, char *buf, size_t size, off_t offset) {
+	updateKinds();
+
+	return FileEntry::read(ctx, buf, size, offset);
+}
+
+void EventKindsFile::updateKinds() {
+	const auto num_kinds = EventKind::count();
+
+	if (num_kinds == m_num_kinds) {
+		// kinds are never removed, so nothing changed
+		return;
+	}
+
+	std::stringstream ss;
+
+	for (EventKind::ID id = 0; id < num_kinds; id++) {
+		ss << id << " " << EventKind::fromID(id).name() << "\n";
+	}
+
+	this->setContent(ss.str());
+	m_num_kinds = num_kinds;
+}
+
+} // end ns
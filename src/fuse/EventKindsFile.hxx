@@ -0,0 +1,39 @@
+#pragma once
+
+// C++
+#include <atomic>
+
+// xwmfs
+#include "fuse/FileEntry.hxx"
+
+namespace xwmfs {
+
+/// Lists all registered EventKind IDs and their names.
+/**
+ * This allows readers of EventFile in binary mode to map the numerical
+ * kinds found in EventFile::BinaryRecord to event names. The file contains
+ * one line per kind in the form "<id> <name>". Kinds can be registered at
+ * any time, thus the content is refreshed upon read if necessary.
+ **/
+class EventKindsFile :
+		public FileEntry {
+public: // functions
+
+	explicit EventKindsFile(const std::string &n);
+
+	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
+
+	/// The content changes without notice, thus bypass the kernel cache.
+	bool enableDirectIO() const override { return true; }
+
+protected: // functions
+
+	void updateKinds();
+
+protected: // data
+
+	/// The number of kinds contained in the current content.
+	std::atomic_size_t m_num_kinds = 0;
+};
+
+} // end ns
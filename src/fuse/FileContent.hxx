@@ -0,0 +1,80 @@
+#pragma once
+
+// C++
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <string_view>
+
+namespace xwmfs {
+
+/// An immutable snapshot of the content of a FileEntry.
+/**
+ * The data is stored in the same allocation right after the size prefix.
+ * Once created the object is never modified. A FileEntry publishes new
+ * content by atomically swapping the pointer to its current FileContent,
+ * the old one is retired via the EpochReclaimer. This way readers can
+ * access the content without locking.
+ **/
+class FileContent {
+public: // functions
+
+	/// Creates a new snapshot containing a copy of `data`.
+	static const FileContent* create(const std::string_view data) {
+		return new(data.size()) FileContent{data};
+	}
+
+	FileContent(const FileContent&) = delete;
+	FileContent& operator=(const FileContent&) = delete;
+
+	/// Returns the number of bytes of content.
+	size_t size() const { return m_size; }
+
+	/// Returns the raw content, which is *not* null terminated.
+	const char* data() const {
+		return reinterpret_cast<const char*>(this + 1);
+	}
+
+	std::string_view view() const { return {data(), size()}; }
+
+	/// Copies up to `size` bytes starting at `offset` into `buf`.
+	/**
+	 * \return
+	 * 	The number of bytes copied, zero if `offset` is beyond the end.
+	 **/
+	size_t copy(char *buf, const size_t size, const size_t offset) const {
+		if (offset >= m_size)
+			return 0;
+
+		const auto bytes = std::min(size, m_size - offset);
+		std::memcpy(buf, data() + offset, bytes);
+		return bytes;
+	}
+
+	static void operator delete(void *ptr) {
+		::operator delete(ptr);
+	}
+
+protected: // functions
+
+	explicit FileContent(const std::string_view data) :
+			m_size{data.size()} {
+		std::memcpy(const_cast<char*>(this->data()), data.data(), m_size);
+	}
+
+	/// Allocates room for the object plus `extra` bytes of content.
+	static void* operator new(size_t size, const size_t extra) {
+		return ::operator new(size + extra);
+	}
+
+	/// Counterpart of the placement allocation, in case the constructor throws.
+	static void operator delete(void *ptr, const size_t) {
+		::operator delete(ptr);
+	}
+
+protected: // data
+
+	const size_t m_size;
+};
+
+} // end ns
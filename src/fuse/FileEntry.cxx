@@ -3,23 +3,67 @@
 
 // xwmfs
 #include "fuse/DirEntry.hxx"
+#include "fuse/EpochReclaimer.hxx"
 #include "fuse/FileEntry.hxx"
+#include "fuse/KernelCache.hxx"
 
 namespace xwmfs {
 
-void FileEntry::getStat(struct stat *s) const {
-	Entry::getStat(s);
-	cosmos::MutexGuard g{m_parent->getLock()};
+FileEntry::~FileEntry() {
+	// we're only deleted once no reader can see us anymore
+	delete m_content.load();
+}
 
-	/*
-	 * we are modifying the stream position here, but that isn't
-	 * problematic, since we'll always reposition it during read or write.
-	 */
-	auto &stream = static_cast<std::stringstream&>(const_cast<FileEntry&>(*this));
+cosmos::RealTime FileEntry::fromNanoseconds(const int64_t ns) {
+	cosmos::RealTime ret;
+	ret.tv_sec = static_cast<time_t>(ns / 1000000000);
+	ret.tv_nsec = static_cast<long>(ns % 1000000000);
+	return ret;
+}
 
-	// determine size of stream and return it in stat structure
-	stream.seekg(0, xwmfs::FileEntry::end);
-	s->st_size = stream.tellg();
+void FileEntry::setContent(const std::string_view data) {
+	const auto old_size = publish(data);
+	auto &cache = KernelCache::getInstance();
+
+	// the kernel may still cache the old content
+	if (m_push_content) {
+		cache.store(*this, data, data.size() < old_size);
+	} else {
+		cache.invalidate(*this);
+	}
+}
+
+void FileEntry::setContent(const std::string_view data, const cosmos::RealTime &t) {
+	m_modify_ns.store(toNanoseconds(t), std::memory_order_release);
+	setContent(data);
+}
+
+size_t FileEntry::publish(const std::string_view data) {
+	auto old_content = m_content.exchange(FileContent::create(data),
+			std::memory_order_acq_rel);
+	const auto ret = old_content->size();
+	// readers may still be copying from the old snapshot
+	EpochReclaimer::getInstance().retire(old_content);
+	return ret;
+}
+
+std::string FileEntry::content() const {
+	EpochGuard guard;
+	return std::string{currentContent()->view()};
+}
+
+void FileEntry::setModifyTime(const cosmos::RealTime &t) {
+	m_modify_ns.store(toNanoseconds(t), std::memory_order_release);
+	// this also invalidates the kernel cache. The content may be
+	// outdated in lazy mode, so don't push it.
+	Entry::setModifyTime(t);
+}
+
+void FileEntry::getStat(struct stat *s) const {
+	// the snapshot provides the size without locking
+	EpochGuard guard;
+	fillStat(s, fromNanoseconds(m_modify_ns.load(std::memory_order_acquire)));
+	s->st_size = currentContent()->size();
 }
 
 FileEntry::Bytes FileEntry::write(OpenContext *ctx, const char *data, size_t size, off_t offset) {
@@ -32,21 +76,18 @@ FileEntry::Bytes FileEntry::write(OpenContext *ctx, const char *data, size_t siz
 
 FileEntry::Bytes FileEntry::read(OpenContext *ctx, char *buf, size_t size, off_t offset) {
 	(void)ctx;
-	cosmos::MutexGuard g{m_parent->getLock()};
-
-	// position to the required offset in the file (to beginning of file, if no offset)
-	seekg(offset, xwmfs::FileEntry::beg);
-
-	// read data into FUSE buffer
-	static_cast<std::stringstream&>(*this).read(buf, size);
 
-	const int ret = gcount();
+	if (offset < 0) {
+		throw cosmos::Errno::INVALID_ARG;
+	}
 
-	// remove any possible error or EOF states from stream
-	clear();
+	// copy straight from the current snapshot, concurrent updates
+	// publish a new one and don't affect us.
+	EpochGuard guard;
+	const auto bytes = currentContent()->copy(buf, size, offset);
 
 	// return number of bytes actually retrieved
-	return Bytes{ret};
+	return Bytes{static_cast<int>(bytes)};
 }
 
 } // end ns
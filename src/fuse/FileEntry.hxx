@@ -1,11 +1,15 @@
 #pragma once
 
 // C++
-#include <sstream>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
 
 // xwmfs
 #include "common/types.hxx"
 #include "fuse/Entry.hxx"
+#include "fuse/FileContent.hxx"
 
 namespace xwmfs {
 
@@ -29,23 +33,25 @@ namespace xwmfs {
 
 /// This type represents regular file entries in the file system
 /**
- * The FileEntry inherits from std::stringstream which allows us to easily
- * store and retrieve small bits of data from regular files. This makes
- * coding easy and should be enough for the purposes of XWMFS. We don't
- * intend to store huge files. And our files are always kept in RAM anyways.
+ * The content of a FileEntry is kept in an immutable FileContent snapshot.
+ * Updating the content means publishing a new snapshot, see setContent().
+ * This way read() and getStat() don't need any locking, they simply
+ * operate on whatever snapshot is current when they're called. The
+ * modification time is kept in a separate atomic, so that changing it
+ * doesn't require copying the content. We don't intend to store huge
+ * files. And our files are always kept in RAM anyways.
  *
  * FileEntry objects can be read-only or read-write. They should be read-write
  * when writing to it is possible and has a sensible effect on whatever it
  * represents.
  *
  * The data to be returned on read is always considered to be present in
- * the inherited stringstream. Write calls, however, need to be handled
- * via specializations of FileEntry that overwrite the write-function
+ * the current snapshot. Write calls, however, need to be handled via
+ * specializations of FileEntry that overwrite the write-function
  * accordingly to do something sensible.
  **/
 class FileEntry :
-		public Entry,
-		public std::stringstream {
+		public Entry {
 public:
 	/// Create a new FileEntry named `n`.
 	/**
@@ -55,9 +61,46 @@ public:
 	FileEntry(const std::string &n,
 			const cosmos::RealTime t = cosmos::RealTime{},
 			const Writable writable = Writable{false}) :
-			Entry{n, REG_FILE, t, writable} {
+			Entry{n, REG_FILE, t, writable},
+			m_content{FileContent::create({})},
+			m_modify_ns{toNanoseconds(t)} {
 	}
 
+	~FileEntry();
+
+	/// Replaces the file content by `data`, keeping the modification time.
+	/**
+	 * This can be called from any thread without holding locks. Readers
+	 * will either see the old or the new content, never a mix of both.
+	 **/
+	void setContent(const std::string_view data);
+
+	/// Replaces the file content by `data` and sets the modification time to `t`.
+	void setContent(const std::string_view data, const cosmos::RealTime &t);
+
+	/// Returns a copy of the current file content.
+	std::string content() const;
+
+	/// Returns a view of the current file content without copying it.
+	/**
+	 * The view is only valid as long as the caller holds an EpochGuard.
+	 **/
+	std::string_view contentView() const { return currentContent()->view(); }
+
+	/// Sets the modification time, keeping the current content.
+	void setModifyTime(const cosmos::RealTime &t) override;
+
+	/// Sets whether changed content should be pushed into the kernel cache.
+	/**
+	 * By default changed content is only invalidated in the kernel cache
+	 * and fetched again on the next read. For files that are read very
+	 * often the content can be pushed into the kernel right away
+	 * instead. This costs kernel memory for each file, though.
+	 *
+	 * This needs to be set before the entry is added to the file system.
+	 **/
+	void setPushContent(const bool push) { m_push_content = push; }
+
 	/// Base implementation of the FUSE write function.
 	/**
 	 * \return
@@ -75,6 +118,42 @@ public:
 	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
 
 	void getStat(struct stat*) const override;
+
+protected: // functions
+
+	/// Replaces the current content snapshot without notifying the kernel cache.
+	/**
+	 * \return
+	 * 	The size of the previous content.
+	 **/
+	size_t publish(const std::string_view data);
+
+	static int64_t toNanoseconds(const cosmos::RealTime &t) {
+		return static_cast<int64_t>(t.tv_sec) * 1000000000 + t.tv_nsec;
+	}
+
+	static cosmos::RealTime fromNanoseconds(const int64_t ns);
+
+	/// Returns the current content snapshot.
+	/**
+	 * The caller needs to hold an EpochGuard or be the event thread.
+	 **/
+	const FileContent* currentContent() const {
+		return m_content.load(std::memory_order_acquire);
+	}
+
+protected: // data
+
+	/// The current immutable content of the file.
+	std::atomic<const FileContent*> m_content;
+	/// The modification time of the file in nanoseconds since the epoch.
+	/**
+	 * This is read without locking by getStat(). It can briefly be out
+	 * of sync with m_content while setContent() is running.
+	 **/
+	std::atomic<int64_t> m_modify_ns;
+	/// Whether changed content is pushed into the kernel cache, see setPushContent().
+	bool m_push_content = false;
 };
 
 } // end ns
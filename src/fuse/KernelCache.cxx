@@ -0,0 +1,135 @@
+// C++
+#include <algorithm>
+#include <unordered_set>
+
+// xwmfs
+#include "fuse/DirEntry.hxx"
+#include "fuse/KernelCache.hxx"
+#include "fuse/xwmfs_fuse_ops.h"
+#include "main/logger.hxx"
+
+namespace xwmfs {
+
+KernelCache& KernelCache::getInstance() {
+	static KernelCache instance;
+	return instance;
+}
+
+void KernelCache::setSession(struct fuse_session *session) {
+	cosmos::MutexGuard g{m_lock};
+	m_session = session;
+}
+
+void KernelCache::setWakeup(WakeupFunc wakeup) {
+	cosmos::MutexGuard g{m_lock};
+	m_wakeup = wakeup;
+}
+
+void KernelCache::wakeupIfIdle() {
+	if (m_wakeup && m_inodes.empty() && m_names.empty() && m_stores.empty()) {
+		m_wakeup();
+	}
+}
+
+void KernelCache::invalidate(const Entry &entry) {
+	if (!entry.parent()) {
+		// not yet part of the file system, so the kernel can't know it
+		return;
+	}
+
+	// direct I/O entries and directories have no cached content, only
+	// their attributes need to be dropped.
+	const bool content = entry.isRegular() && !entry.enableDirectIO();
+
+	cosmos::MutexGuard g{m_lock};
+	wakeupIfIdle();
+	m_inodes.push_back(InodeInval{entry.inode(), content});
+}
+
+void KernelCache::store(const Entry &entry, const std::string_view data, const bool shrunk) {
+	if (!entry.parent()) {
+		return;
+	}
+
+	cosmos::MutexGuard g{m_lock};
+	wakeupIfIdle();
+
+	if (shrunk) {
+		m_inodes.push_back(InodeInval{entry.inode(), true});
+	}
+
+	m_stores.push_back(Store{entry.inode(), std::string{data}});
+}
+
+void KernelCache::invalidateName(const DirEntry &dir, const std::string &name) {
+	cosmos::MutexGuard g{m_lock};
+	wakeupIfIdle();
+	m_names.push_back(NameInval{dir.inode(), name});
+}
+
+void KernelCache::flush() {
+	std::vector<InodeInval> inodes;
+	std::vector<NameInval> names;
+	std::vector<Store> stores;
+	struct fuse_session *session = nullptr;
+
+	{
+		cosmos::MutexGuard g{m_lock};
+		inodes.swap(m_inodes);
+		names.swap(m_names);
+		stores.swap(m_stores);
+		session = m_session;
+	}
+
+	if (!session)
+		return;
+
+	std::sort(inodes.begin(), inodes.end());
+	inodes.erase(std::unique(inodes.begin(), inodes.end()), inodes.end());
+
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+
+	for (const auto &[parent, name]: names) {
+		if (auto res = fuse_lowlevel_notify_inval_entry(
+				session, parent, name.c_str(), name.size()); res != 0 && res != -ENOENT) {
+			logger->warn() << "failed to invalidate cached name " << name
+				<< ": " << cosmos::Errno{-res} << "\n";
+		}
+	}
+
+	for (const auto &[ino, content]: inodes) {
+		// the kernel returns ENOENT for inodes it doesn't know, which
+		// is the common case.
+		//
+		// a negative offset only invalidates the attributes
+		if (auto res = fuse_lowlevel_notify_inval_inode(
+				session, ino, content ? 0 : -1, 0); res != 0 && res != -ENOENT) {
+			logger->warn() << "failed to invalidate cached inode " << ino
+				<< ": " << cosmos::Errno{-res} << "\n";
+		}
+	}
+
+	// only the most recent content of each inode is of interest
+	std::unordered_set<uint64_t> stored;
+
+	for (auto it = stores.rbegin(); it != stores.rend(); it++) {
+		if (it->data.empty() || !stored.insert(it->ino).second)
+			continue;
+
+		struct fuse_bufvec bufv;
+		cosmos::zero_object(bufv);
+		bufv.count = 1;
+		bufv.buf[0].size = it->data.size();
+		bufv.buf[0].mem = it->data.data();
+		bufv.buf[0].fd = -1;
+
+		if (auto res = fuse_lowlevel_notify_store(session, it->ino, 0, &bufv,
+				fuse_buf_copy_flags{}); res != 0 && res != -ENOENT) {
+			logger->warn() << "failed to store content of inode " << it->ino
+				<< ": " << cosmos::Errno{-res} << "\n";
+		}
+	}
+}
+
+} // end ns
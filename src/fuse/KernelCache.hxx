@@ -0,0 +1,135 @@
+#pragma once
+
+// C++
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// cosmos
+#include <cosmos/thread/Mutex.hxx>
+
+struct fuse_session;
+
+namespace xwmfs {
+
+class DirEntry;
+class Entry;
+
+/// Keeps the kernel's FUSE caches coherent with the file system content.
+/**
+ * The kernel is allowed to cache names, attributes and file content for a
+ * long time, see CACHE_TIMEOUT. Whenever something changes on our side the
+ * affected cache entries need to be invalidated explicitly.
+ *
+ * Invalidations are not sent to the kernel right away but collected and
+ * sent by the event thread in flush(). Invalidating an inode can require
+ * kernel side inode and page locks, which may be held by a FUSE request
+ * that in turn waits for one of our locks. Sending the notifications
+ * without holding any locks avoids such deadlocks. It also allows to
+ * suppress duplicate notifications for entries that changed multiple times
+ * in one batch of X events.
+ *
+ * Changes made by FUSE threads, like lazily fetched attributes, don't
+ * coincide with X events. The wakeup function is invoked whenever
+ * invalidations become pending, so that the event thread can flush them
+ * without waiting for the next X event.
+ **/
+class KernelCache {
+public: // types
+
+	using WakeupFunc = std::function<void ()>;
+
+public: // data
+
+	/// Time in seconds the kernel may cache names and attributes.
+	static constexpr double CACHE_TIMEOUT = 3600.0;
+
+public: // functions
+
+	static KernelCache& getInstance();
+
+	KernelCache(const KernelCache&) = delete;
+	KernelCache& operator=(const KernelCache&) = delete;
+
+	/// Sets the FUSE session to send notifications to, or nullptr to stop sending them.
+	void setSession(struct fuse_session *session);
+
+	/// Sets the function to call when invalidations become pending.
+	/**
+	 * The function is called with the internal lock held and must not
+	 * block or call back into this object.
+	 **/
+	void setWakeup(WakeupFunc wakeup);
+
+	/// Schedules invalidation of the cached attributes and content of `entry`.
+	void invalidate(const Entry &entry);
+
+	/// Schedules writing `data` as the new content of `entry` into the kernel cache.
+	/**
+	 * If `shrunk` is set then the new content is smaller than the
+	 * previous one. Storing data can't reduce the file size known to the
+	 * kernel, thus the cached content and attributes are invalidated
+	 * first in this case.
+	 *
+	 * The cached attributes are not invalidated otherwise, thus the
+	 * modification time seen via the kernel may lag behind.
+	 **/
+	void store(const Entry &entry, const std::string_view data, const bool shrunk);
+
+	/// Schedules invalidation of the cached name `name` in `dir`.
+	/**
+	 * This is necessary when an entry is removed from `dir`.
+	 **/
+	void invalidateName(const DirEntry &dir, const std::string &name);
+
+	/// Sends all pending invalidations to the kernel.
+	/**
+	 * This is called by the event thread, without holding any locks.
+	 **/
+	void flush();
+
+protected: // types
+
+	struct InodeInval {
+		uint64_t ino;
+		/// Whether cached file content also needs to be dropped.
+		bool content;
+
+		auto operator<=>(const InodeInval&) const = default;
+	};
+
+	struct Store {
+		uint64_t ino;
+		std::string data;
+	};
+
+	struct NameInval {
+		uint64_t parent;
+		std::string name;
+
+		auto operator<=>(const NameInval&) const = default;
+	};
+
+protected: // functions
+
+	KernelCache() = default;
+
+	/// Invokes m_wakeup if nothing was pending before, called with m_lock held.
+	void wakeupIfIdle();
+
+protected: // data
+
+	/// Protects the pending invalidations.
+	cosmos::Mutex m_lock;
+	std::vector<InodeInval> m_inodes;
+	std::vector<NameInval> m_names;
+	std::vector<Store> m_stores;
+	/// The FUSE session to notify, accessed only by the event thread and main().
+	struct fuse_session *m_session = nullptr;
+	/// Function to wake up the event thread for calling flush().
+	WakeupFunc m_wakeup;
+};
+
+} // end ns
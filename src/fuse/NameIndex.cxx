@@ -0,0 +1,113 @@
+// C++
+#include <functional>
+
+// xwmfs
+#include "fuse/Entry.hxx"
+#include "fuse/NameIndex.hxx"
+
+namespace xwmfs {
+
+namespace {
+
+/// The capacity of a freshly allocated table.
+constexpr size_t MIN_CAPACITY = 8;
+
+} // end anon ns
+
+size_t NameIndex::hashName(const std::string_view name) {
+	return std::hash<std::string_view>{}(name);
+}
+
+size_t NameIndex::probe(const std::string_view name, const size_t hash) const {
+	auto pos = hash & mask();
+
+	while (true) {
+		const auto &slot = m_slots[pos];
+
+		if (!slot.entry || (slot.hash == hash && slot.entry->name() == name)) {
+			return pos;
+		}
+
+		pos = (pos + 1) & mask();
+	}
+}
+
+Entry* NameIndex::find(const std::string_view name) const {
+	if (m_slots.empty())
+		return nullptr;
+
+	return m_slots[probe(name, hashName(name))].entry;
+}
+
+bool NameIndex::insert(Entry *entry) {
+	// keep the load factor at or below 1/2 to keep probe sequences short
+	if ((m_size + 1) * 2 > m_slots.size()) {
+		rehash(m_slots.empty() ? MIN_CAPACITY : m_slots.size() * 2);
+	}
+
+	const auto hash = hashName(entry->name());
+	auto &slot = m_slots[probe(entry->name(), hash)];
+
+	if (slot.entry) {
+		return false;
+	}
+
+	slot = Slot{hash, entry};
+	m_size++;
+	return true;
+}
+
+Entry* NameIndex::erase(const std::string_view name) {
+	if (m_slots.empty())
+		return nullptr;
+
+	auto pos = probe(name, hashName(name));
+	auto ret = m_slots[pos].entry;
+
+	if (!ret)
+		return nullptr;
+
+	/*
+	 * backward shift deletion: move following entries of the same
+	 * probe sequence up into the gap, so that lookups never encounter
+	 * an empty slot before reaching their entry.
+	 */
+	auto next = (pos + 1) & mask();
+
+	while (m_slots[next].entry) {
+		const auto home = m_slots[next].hash & mask();
+
+		// the distance from the entry's home slot to the gap is
+		// smaller than to its current position, so it may move up.
+		if (((pos - home) & mask()) < ((next - home) & mask())) {
+			m_slots[pos] = m_slots[next];
+			pos = next;
+		}
+
+		next = (next + 1) & mask();
+	}
+
+	m_slots[pos] = Slot{};
+	m_size--;
+	return ret;
+}
+
+void NameIndex::rehash(const size_t capacity) {
+	SlotVector old_slots(capacity);
+	old_slots.swap(m_slots);
+
+	for (const auto &slot: old_slots) {
+		if (!slot.entry)
+			continue;
+
+		auto pos = slot.hash & mask();
+
+		while (m_slots[pos].entry) {
+			pos = (pos + 1) & mask();
+		}
+
+		m_slots[pos] = slot;
+	}
+}
+
+} // end ns
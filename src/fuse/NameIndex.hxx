@@ -0,0 +1,131 @@
+#pragma once
+
+// C++
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace xwmfs {
+
+class Entry;
+
+/// A flat open addressing hash table of file system entries, keyed by their names.
+/**
+ * This is used by DirEntry for looking up its children. Other than a
+ * std::map it doesn't need to walk a tree of separately allocated nodes,
+ * but finds an entry typically with a single hash computation and one or
+ * two probes into a contiguous array.
+ *
+ * The table uses linear probing and keeps the load factor at or below one
+ * half. Removal uses backward shifting, thus no tombstones are necessary.
+ * The keys are not stored separately, but taken from Entry::name().
+ *
+ * DirEntry never modifies a published index in place, but creates modified
+ * copies, thus no synchronization is contained here.
+ **/
+class NameIndex {
+protected: // types
+
+	struct Slot {
+		size_t hash = 0;
+		Entry *entry = nullptr;
+	};
+
+	using SlotVector = std::vector<Slot>;
+
+public: // types
+
+	/// Iterates over all entries contained in the index, in no specific order.
+	class const_iterator {
+		friend class NameIndex;
+	public: // functions
+
+		Entry* operator*() const { return m_pos->entry; }
+
+		const_iterator& operator++() {
+			++m_pos;
+			skipEmpty();
+			return *this;
+		}
+
+		bool operator==(const const_iterator &other) const {
+			return m_pos == other.m_pos;
+		}
+
+		bool operator!=(const const_iterator &other) const {
+			return !(*this == other);
+		}
+
+	protected: // functions
+
+		const_iterator(SlotVector::const_iterator pos, SlotVector::const_iterator end) :
+				m_pos{pos}, m_end{end} {
+			skipEmpty();
+		}
+
+		void skipEmpty() {
+			while (m_pos != m_end && !m_pos->entry)
+				++m_pos;
+		}
+
+	protected: // data
+
+		SlotVector::const_iterator m_pos;
+		SlotVector::const_iterator m_end;
+	};
+
+public: // functions
+
+	NameIndex() = default;
+
+	/// Returns the entry called `name` or nullptr if it isn't contained.
+	Entry* find(const std::string_view name) const;
+
+	/// Adds `entry` to the index.
+	/**
+	 * \return
+	 * 	`false` if an entry of the same name is already contained, in
+	 * 	which case nothing is changed.
+	 **/
+	bool insert(Entry *entry);
+
+	/// Removes the entry called `name` from the index.
+	/**
+	 * \return
+	 * 	The removed entry or nullptr if no such entry was contained.
+	 **/
+	Entry* erase(const std::string_view name);
+
+	size_t size() const { return m_size; }
+
+	bool empty() const { return m_size == 0; }
+
+	const_iterator begin() const {
+		return const_iterator{m_slots.begin(), m_slots.end()};
+	}
+
+	const_iterator end() const {
+		return const_iterator{m_slots.end(), m_slots.end()};
+	}
+
+protected: // functions
+
+	static size_t hashName(const std::string_view name);
+
+	/// Returns the slot index for `name`, which is either empty or holds the matching entry.
+	size_t probe(const std::string_view name, const size_t hash) const;
+
+	/// Resizes the table to hold `capacity` slots, which must be a power of two.
+	void rehash(const size_t capacity);
+
+	size_t mask() const { return m_slots.size() - 1; }
+
+protected: // data
+
+	/// The hash table, the size of which is always zero or a power of two.
+	SlotVector m_slots;
+	/// The number of occupied slots.
+	size_t m_size = 0;
+};
+
+} // end ns
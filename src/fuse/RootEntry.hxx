@@ -1,8 +1,5 @@
 #pragma once
 
-// cosmos
-#include <cosmos/thread/RWLock.hxx>
-
 // xwmfs
 #include "fuse/DirEntry.hxx"
 
@@ -15,9 +12,10 @@ namespace xwmfs {
  *
  * - looking up entries in the file system, recursively (this operation could
  *   actually also be part of the DirEntry itself?)
- * - a file system global read-write lock for safe access to its
- *   structure. For XWMFS purposes this is good enough. For a large file
- *   system we'd need a more fine-grained approach
+ *
+ * There is no file system global lock. Lookups don't take any locks at all,
+ * they rely on the caller holding an EpochGuard instead, see
+ * EpochReclaimer.
  *
  * The RootEntry does not really have a name. But we name it '/', as it
  * is conventional.
@@ -40,31 +38,13 @@ public: // functions
 	 * 	The terminating entry may be of any type. The corresponding
 	 * 	path must exist for success.
 	 * \return
-	 *	Corresponding entry or nullptr if not found.
+	 *	The found entry or nullptr if not found. The entry stays valid
+	 *	as long as the caller's EpochGuard exists, even if it is
+	 *	removed from the file system in the meantime. To keep it
+	 *	beyond that a reference needs to be obtained via
+	 *	Entry::tryRef().
 	 **/
 	Entry* findEntry(const std::string_view path);
-
-	/// Obtains a read-lock for the complete file system.
-	/**
-	 * While the read lock is held the structure of the file system can't
-	 * change. It can be obtained in parallel by multiple threads.
-	 **/
-	void readlock() const { m_lock.readlock(); }
-
-	/// Obtains a write-lock for the complete file system.
-	/**
-	 * This lock can only be obtained by one thread exclusively. It allows
-	 * alteration of the file system structure.
-	 **/
-	void writelock() { m_lock.writelock(); }
-
-	/// Returns a previously obtained read- or write-lock.
-	void unlock() const { m_lock.unlock(); }
-
-protected: // data
-
-	/// The read-write lock protecting the file system
-	cosmos::RWLock m_lock;
 };
 
 } // end ns
@@ -11,8 +11,9 @@
 namespace xwmfs {
 
 void SymlinkEntry::getStat(struct stat *s) const {
-	Entry::getStat(s);
+	// the parent lock also protects our timestamps
 	cosmos::MutexGuard g{m_parent->getLock()};
+	Entry::getStat(s);
 
 	s->st_size = m_target.size();
 }
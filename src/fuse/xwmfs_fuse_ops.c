@@ -5,16 +5,23 @@
  * designated initializers, which we cannot do in C++.
  */
 
-struct fuse_operations xwmfs_oper = {
+struct fuse_lowlevel_ops xwmfs_oper = {
+	.init = xwmfs_init,
+	.destroy = xwmfs_destroy,
+	.lookup = xwmfs_lookup,
+	.forget = xwmfs_forget,
 	.getattr = xwmfs_getattr,
-	.readdir = xwmfs_readdir,
+	.setattr = xwmfs_setattr,
+	.readlink = xwmfs_readlink,
 	.open = xwmfs_open,
-	.release = xwmfs_release,
 	.read = xwmfs_read,
-	.readlink = xwmfs_readlink,
 	.write = xwmfs_write,
-	.truncate = xwmfs_truncate,
-	.init = xwmfs_init,
-	.destroy = xwmfs_destroy,
-	.create = xwmfs_create
+	.release = xwmfs_release,
+	.opendir = xwmfs_opendir,
+	.readdir = xwmfs_readdir,
+	.releasedir = xwmfs_releasedir,
+	.create = xwmfs_create,
+	.poll = xwmfs_poll,
+	.forget_multi = xwmfs_forget_multi,
+	.readdirplus = xwmfs_readdirplus
 };
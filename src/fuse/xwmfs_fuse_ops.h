@@ -1,91 +1,144 @@
 #pragma once
 
 #include <fcntl.h>
-#include <fuse.h>
+#include <fuse_lowlevel.h>
 
 /*
  * This is a C/C++ header that declares the FUSE operations implemented for
  * xwmfs
  *
  * It needs to be includeable by C, because the definition of struct
- * fuse_operations is done in C, as in C99 we can have designated initializers
- * (as opposed to C++) which makes the setup of that structure way easier for
- * us then if done in C++.
+ * fuse_lowlevel_ops is done in C, as in C99 we can have designated
+ * initializers (as opposed to C++) which makes the setup of that structure
+ * way easier for us then if done in C++.
+ *
+ * We use the low level inode based FUSE API. The inode numbers are derived
+ * from the Entry objects, see Entry::inode().
  */
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-extern int xwmfs_getattr(
-	const char *path,
-	struct stat *stbuf,
+extern void xwmfs_init(
+	void *userdata,
+	struct fuse_conn_info *conn
+);
+
+extern void xwmfs_destroy(
+	void *userdata
+);
+
+extern void xwmfs_lookup(
+	fuse_req_t req,
+	fuse_ino_t parent,
+	const char *name
+);
+
+extern void xwmfs_forget(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	uint64_t nlookup
+);
+
+extern void xwmfs_getattr(
+	fuse_req_t req,
+	fuse_ino_t ino,
 	struct fuse_file_info *fi
 );
 
-extern int xwmfs_readdir(
-	const char *path,
-	void *buf,
-	fuse_fill_dir_t filler,
-	off_t offset,
-	struct fuse_file_info *fi,
-	enum fuse_readdir_flags flags
+extern void xwmfs_setattr(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	struct stat *attr,
+	int to_set,
+	struct fuse_file_info *fi
 );
 
-extern int xwmfs_open(
-	const char *path,
+extern void xwmfs_readlink(
+	fuse_req_t req,
+	fuse_ino_t ino
+);
+
+extern void xwmfs_open(
+	fuse_req_t req,
+	fuse_ino_t ino,
 	struct fuse_file_info *fi
 );
 
-extern int xwmfs_release(
-	const char *path,
+extern void xwmfs_read(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	size_t size,
+	off_t offset,
 	struct fuse_file_info *fi
 );
 
-extern int xwmfs_read(
-	const char *path,
-	char *buf,
+extern void xwmfs_write(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	const char *data,
 	size_t size,
 	off_t offset,
 	struct fuse_file_info *fi
 );
 
-extern int xwmfs_readlink(
-	const char *path,
-	char *buf,
-	size_t size
+extern void xwmfs_release(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	struct fuse_file_info *fi
 );
 
-extern int xwmfs_write(
-	const char *path,
-	const char *data,
+extern void xwmfs_opendir(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	struct fuse_file_info *fi
+);
+
+extern void xwmfs_readdir(
+	fuse_req_t req,
+	fuse_ino_t ino,
 	size_t size,
 	off_t offset,
 	struct fuse_file_info *fi
 );
 
-extern int xwmfs_truncate(
-	const char *path,
-	off_t size,
+extern void xwmfs_releasedir(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	struct fuse_file_info *fi
+);
+
+extern void xwmfs_create(
+	fuse_req_t req,
+	fuse_ino_t parent,
+	const char *name,
+	mode_t mode,
 	struct fuse_file_info *fi
 );
 
-extern void* xwmfs_init(
-	struct fuse_conn_info*,
-	struct fuse_config*
+extern void xwmfs_poll(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	struct fuse_file_info *fi,
+	struct fuse_pollhandle *ph
 );
 
-extern void xwmfs_destroy(
-	void*
+extern void xwmfs_forget_multi(
+	fuse_req_t req,
+	size_t count,
+	struct fuse_forget_data *forgets
 );
 
-extern int xwmfs_create(
-	const char *path,
-	mode_t mode,
-	struct fuse_file_info *ffi
+extern void xwmfs_readdirplus(
+	fuse_req_t req,
+	fuse_ino_t ino,
+	size_t size,
+	off_t offset,
+	struct fuse_file_info *fi
 );
 
-extern struct fuse_operations xwmfs_oper;
+extern struct fuse_lowlevel_ops xwmfs_oper;
 
 #ifdef __cplusplus
 } // end extern
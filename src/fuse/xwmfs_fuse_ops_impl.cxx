@@ -4,6 +4,14 @@
  *
  * The file system operations are called directly by FUSE as soon as some
  * access to the file system occurs.
+ *
+ * We're using the low level FUSE API. The kernel addresses file system
+ * entries by inode numbers, which map directly to Entry objects, see
+ * Entry::inode(). Path resolution happens in the kernel, one lookup per
+ * path component, which is cached in the kernel's dentry cache. Each
+ * successful lookup takes a reference on the Entry which is dropped again
+ * in forget(). Thus an inode number is always valid while the kernel uses
+ * it.
  */
 
 // C/C++
@@ -11,127 +19,350 @@
 #include <errno.h>
 #include <exception>
 #include <cstdlib>
+#include <limits.h>
+#include <optional>
+#include <vector>
 
 // libcosmos
 #include <cosmos/proc/process.hxx>
 
 // xwmfs
+#include "fuse/DirEntry.hxx"
 #include "fuse/Entry.hxx"
+#include "fuse/EpochReclaimer.hxx"
 #include "fuse/FileEntry.hxx"
+#include "fuse/KernelCache.hxx"
 #include "fuse/OpenContext.hxx"
-#include "fuse/xwmfs_fuse.hxx"
 #include "fuse/xwmfs_fuse_ops.h"
 #include "main/logger.hxx"
+#include "main/Options.hxx"
 #include "main/Xwmfs.hxx"
 
 namespace xwmfs {
 
 xwmfs::RootEntry *filesystem = nullptr;
 
-static OpenContext* context_from_fi(struct fuse_file_info *fi) {
+namespace {
+
+OpenContext* context_from_fi(struct fuse_file_info *fi) {
 	// get our entry pointer back from the file handle field
 	return reinterpret_cast<xwmfs::OpenContext*>(fi->fh);
 }
 
-static Entry* entry_from_fi(struct fuse_file_info *fi) {
-	xwmfs::OpenContext *context = context_from_fi(fi);
-	return context->getEntry();
+/// Returns the Entry corresponding to the given inode number.
+/**
+ * The kernel only passes inode numbers it obtained from lookup() or
+ * readdirplus() before and for which it holds a reference, thus the
+ * returned Entry is always valid.
+ **/
+Entry* entry_from_ino(const fuse_ino_t ino) {
+	if (ino == FUSE_ROOT_ID)
+		return filesystem;
+
+	return reinterpret_cast<Entry*>(ino);
 }
 
-inline int errnum_to_fuse_err(const cosmos::Errno err) {
-	// FUSE expect negative error codes
-	return - cosmos::to_integral(err);
+/// Returns a per-thread buffer of at least `size` bytes for assembling replies.
+char* reply_buffer(const size_t size) {
+	static thread_local std::vector<char> buffer;
+
+	if (buffer.size() < size) {
+		buffer.resize(size);
+	}
+
+	return buffer.data();
 }
 
-} // end ns
+int reply_errno(fuse_req_t req, const cosmos::Errno err) {
+	// the low level API expects positive error codes
+	return fuse_reply_err(req, cosmos::to_integral(err));
+}
 
-/// Get stat information about a file system entry.
+void fill_entry_param(const Entry &entry, struct fuse_entry_param &param) {
+	cosmos::zero_object(param);
+	param.ino = entry.inode();
+	param.attr_timeout = KernelCache::CACHE_TIMEOUT;
+	param.entry_timeout = KernelCache::CACHE_TIMEOUT;
+	entry.getStat(&param.attr);
+}
+
+/// Called by FUSE in some other thread when a pending request is interrupted.
+void interrupt_request(fuse_req_t req, void *data) {
+	(void)req;
+
+	// data carries the ID of the request, see RequestScope
+	const auto id = reinterpret_cast<uintptr_t>(data);
+	Xwmfs::getInstance().interruptRequest(id);
+}
+
+/// Tracks a possibly blocking request while it is processed, see Xwmfs::beginRequest().
+class RequestScope {
+public: // functions
+
+	explicit RequestScope(fuse_req_t req) {
+		const uintptr_t id = Xwmfs::getInstance().beginRequest(req);
+
+		// if the request blocks then an interrupt needs to abort it.
+		// If it is already interrupted then this calls
+		// interrupt_request() right away.
+		fuse_req_interrupt_func(req, &interrupt_request,
+				reinterpret_cast<void*>(id));
+	}
+
+	~RequestScope() {
+		Xwmfs::getInstance().endRequest();
+	}
+
+	RequestScope(const RequestScope&) = delete;
+	RequestScope& operator=(const RequestScope&) = delete;
+};
+
+/// Adds the entries of `context` starting at `offset` to `buf`, returns the bytes used.
 /**
- * stat may happen with or without file open context in `fi`.
+ * For readdirplus() each listed entry other than "." and ".." is added to
+ * `referenced` after taking a lookup reference on it.
  **/
-int xwmfs_getattr(const char *path, struct stat *stbuf, struct fuse_file_info *fi) {
-	cosmos::zero_object(*stbuf);
-	xwmfs::FileSysReadGuard read_guard{*xwmfs::filesystem};
-
-	const xwmfs::Entry *entry = fi ?
-		xwmfs::entry_from_fi(fi) :
-		xwmfs::filesystem->findEntry(path);
-	if (!entry) {
-		xwmfs::logger->debug()
-			<< __FUNCTION__ << ": ENOENT for path "
-			<< path << "\n";
-		return -ENOENT;
+size_t add_dir_entries(fuse_req_t req, DirOpenContext &context, char *buf,
+		const size_t size, const off_t offset, const bool plus,
+		std::vector<Entry*> &referenced) {
+	auto dir = context.getEntry();
+	const auto &entries = context.entries;
+	size_t used = 0;
+	struct fuse_entry_param param;
+
+	/*
+	 * offsets zero and one belong to "." and "..", the contained entries
+	 * follow. The offset passed to FUSE is the one of the next entry to
+	 * list.
+	 */
+	for (size_t pos = offset; pos < entries.size() + 2; pos++) {
+		const char *name = nullptr;
+		Entry *entry = nullptr;
+
+		if (pos == 0) {
+			name = ".";
+			entry = dir;
+		} else if (pos == 1) {
+			name = "..";
+			entry = dir->parent();
+		} else {
+			entry = entries[pos - 2];
+			name = entry->name().c_str();
+		}
+
+		const auto left = size - used;
+		size_t entsize;
+
+		if (plus) {
+			fill_entry_param(*entry, param);
+			entsize = fuse_add_direntry_plus(req, buf + used, left,
+					name, &param, pos + 1);
+		} else {
+			// only st_ino and the file type bits of st_mode are used
+			cosmos::zero_object(param.attr);
+			param.attr.st_ino = entry->inode();
+			param.attr.st_mode = entry->isDir() ? S_IFDIR :
+				entry->isSymlink() ? S_IFLNK : S_IFREG;
+			entsize = fuse_add_direntry(req, buf + used, left,
+					name, &param.attr, pos + 1);
+		}
+
+		if (entsize > left) {
+			// doesn't fit anymore, continue in the next call
+			break;
+		}
+
+		used += entsize;
+
+		if (plus && pos >= 2) {
+			// the kernel now holds a lookup reference, "." and ".."
+			// are excluded from this.
+			entry->ref();
+			referenced.push_back(entry);
+		}
 	}
 
-	xwmfs::logger->debug()
-		<< __FUNCTION__ << ": stat for path "
-		<< path << "\n";
+	return used;
+}
 
-	entry->getStat(stbuf);
+/// Common implementation of readdir() and readdirplus().
+void fill_dir(fuse_req_t req, size_t size, off_t offset,
+		struct fuse_file_info *fi, const bool plus) {
+	auto context = static_cast<DirOpenContext*>(context_from_fi(fi));
+	char *buf = reply_buffer(size);
+	std::vector<Entry*> referenced;
 
-	return 0;
+	try {
+		const auto used = add_dir_entries(req, *context, buf, size, offset, plus, referenced);
+		fuse_reply_buf(req, buf, used);
+		return;
+	} catch (const std::exception &ex) {
+		// getStat() may need to fetch data from the X server
+		logger->error()
+			<< "Failed to list " << context->getEntry()->name() << ": " << ex.what() << "\n";
+	} catch (const cosmos::Errno errnum) {
+		logger->error()
+			<< "Failed to list " << context->getEntry()->name() << ": " << errnum << "\n";
+	}
+
+	// the kernel won't learn about the entries listed so far
+	for (auto entry: referenced) {
+		entry->release();
+	}
+
+	fuse_reply_err(req, EIO);
 }
 
-/// A request to list the contents of a directory.
+} // end anon ns
+
+} // end ns
+
+/// Looks up the entry `name` in the directory `parent`.
 /**
- * The \c filler object allows for easy creation of the required dirent
- * structures behind the scene.
+ * On success a reference is taken on the entry found, which is dropped again
+ * once the kernel forgets about the inode.
  **/
-int xwmfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
-		off_t offset, struct fuse_file_info *fi,
-		enum fuse_readdir_flags flags) {
-	(void) offset;
-	(void) fi;
+void xwmfs_lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
+	xwmfs::EpochGuard guard;
+	auto dir_entry = xwmfs::Entry::tryCastDirEntry(xwmfs::entry_from_ino(parent));
 
-	xwmfs::FileSysReadGuard read_guard{*xwmfs::filesystem};
+	if (!dir_entry) {
+		fuse_reply_err(req, ENOTDIR);
+		return;
+	}
 
-	/*
-	 * note: right now we always lookup the file system entry within
-	 * readdir. We could optimize this by implementing opendir() and set a
-	 * file handle there just like it is done in open(). Also opendir()
-	 * should do access checking.
-	 *
-	 * However, we're currently always allowing access to directories for
-	 * reading. Also this is the only relevant operation for directories
-	 * we're currently implementing so the performance benefit from
-	 * implementing opendir() is small.
-	 */
-	xwmfs::Entry *entry = xwmfs::filesystem->findEntry(path);
-	xwmfs::DirEntry *dir_entry = xwmfs::Entry::tryCastDirEntry(entry);
+	auto entry = dir_entry->lookupEntry(name);
 
-	if (!entry) {
+	// if the entry is on its way to reclamation then it is gone for us,
+	// too.
+	if (!entry || !entry->tryRef()) {
 		xwmfs::logger->debug()
-			<< __FUNCTION__ << ": no such entity: " << path << "\n";
+			<< __FUNCTION__ << ": ENOENT for " << name << "\n";
+		fuse_reply_err(req, ENOENT);
+		return;
+	}
 
-		return -ENOENT;
-	} else if (!dir_entry) {
-		xwmfs::logger->debug()
-			<< __FUNCTION__ << ": not a dir: " << path << "\n";
-		return -ENOTDIR;
+	struct fuse_entry_param param;
+
+	try {
+		// this may need to fetch data from the X server
+		xwmfs::fill_entry_param(*entry, param);
+	} catch (const std::exception &ex) {
+		xwmfs::logger->error()
+			<< "Failed to stat " << name << ": " << ex.what() << "\n";
+		entry->release();
+		fuse_reply_err(req, EIO);
+		return;
+	} catch (const cosmos::Errno errnum) {
+		xwmfs::logger->error()
+			<< "Failed to stat " << name << ": " << errnum << "\n";
+		entry->release();
+		fuse_reply_err(req, EIO);
+		return;
 	}
 
-	// okay we found a valid directory to list the contents of
-	const auto &entries = dir_entry->getEntries();
+	if (fuse_reply_entry(req, &param) != 0) {
+		// the request has been interrupted, the kernel doesn't know
+		// about the lookup
+		entry->release();
+	}
+}
 
-	// the kernel would like stat information for each entry right away.
-	const bool provide_stat = (flags & FUSE_READDIR_PLUS) != 0;
-	const enum fuse_fill_dir_flags fill_flags = provide_stat ?
-		FUSE_FILL_DIR_PLUS : FUSE_FILL_DIR_DEFAULTS;
-	struct stat stbuf;
+/// The kernel drops `nlookup` lookup references of the given inode.
+void xwmfs_forget(fuse_req_t req, fuse_ino_t ino, uint64_t nlookup) {
+	// the root is not heap allocated and never looked up
+	if (ino != FUSE_ROOT_ID) {
+		xwmfs::entry_from_ino(ino)->release(nlookup);
+	}
+
+	fuse_reply_none(req);
+}
+
+void xwmfs_forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data *forgets) {
+	for (size_t i = 0; i < count; i++) {
+		const auto &forget = forgets[i];
 
-	for (const auto &it: entries) {
-		if (provide_stat) {
-			cosmos::zero_object(stbuf);
-			it.second->getStat(&stbuf);
+		if (forget.ino != FUSE_ROOT_ID) {
+			xwmfs::entry_from_ino(forget.ino)->release(forget.nlookup);
 		}
+	}
+
+	fuse_reply_none(req);
+}
+
+/// Get stat information about a file system entry.
+void xwmfs_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+	(void)fi;
+	struct stat stbuf;
+	cosmos::zero_object(stbuf);
+	auto entry = xwmfs::entry_from_ino(ino);
+
+	try {
+		// this may need to fetch data from the X server
+		entry->getStat(&stbuf);
+	} catch (const std::exception &ex) {
+		xwmfs::logger->error()
+			<< "Failed to stat " << entry->name() << ": " << ex.what() << "\n";
+		fuse_reply_err(req, EIO);
+		return;
+	} catch (const cosmos::Errno errnum) {
+		xwmfs::logger->error()
+			<< "Failed to stat " << entry->name() << ": " << errnum << "\n";
+		fuse_reply_err(req, EIO);
+		return;
+	}
+
+	fuse_reply_attr(req, &stbuf, xwmfs::KernelCache::CACHE_TIMEOUT);
+}
 
-		filler(buf, it.first.data(), provide_stat ? &stbuf : nullptr, 0, fill_flags);
+/// Change stat information of a file system entry.
+/**
+ * Only truncation is accepted, but nothing is done.
+ *
+ * Note: Doing nothing on a "proc like fs" is okay I guess.
+ *
+ * If you try to append or truncate a writable file on proc then nothing
+ * happens. We simply implement "overwrite" all the time.
+ *
+ * This null implementation is needed for shell operations to succeed that try
+ * to truncate a file upon writing.
+ **/
+void xwmfs_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr,
+		int to_set, struct fuse_file_info *fi) {
+	(void)attr;
+
+	if ((to_set & FUSE_SET_ATTR_SIZE) == 0) {
+		fuse_reply_err(req, ENOSYS);
+		return;
 	}
 
-	return 0;
+	xwmfs_getattr(req, ino, fi);
 }
 
-/// Create an open-context for a given path.
+void xwmfs_readlink(fuse_req_t req, fuse_ino_t ino) {
+	auto entry = xwmfs::entry_from_ino(ino);
+	char buf[PATH_MAX];
+
+	try {
+		if (auto res = entry->isOperationAllowed(); res) {
+			fuse_reply_err(req, -res);
+			return;
+		}
+
+		entry->readlink(buf, sizeof(buf));
+		fuse_reply_readlink(req, buf);
+	} catch (const std::exception &ex) {
+		xwmfs::logger->error()
+			<< "Failed to readlink from " << entry->name() << ": " << ex.what() << "\n";
+		fuse_reply_err(req, EFAULT);
+	} catch (const cosmos::Errno errnum) {
+		xwmfs::logger->error()
+			<< "Failed to readlink from " << entry->name() << ": " << errnum << "\n";
+		xwmfs::reply_errno(req, errnum);
+	}
+}
+
+/// Create an open-context for a given inode.
 /**
  * This call is used to check whether the given flags are okay for opening the
  * file
@@ -139,24 +370,16 @@ int xwmfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
  * We can set `fi->fh` (file handle) here and it will be available in any
  * other operations coming up.
  **/
-int xwmfs_open(const char *path, struct fuse_file_info *fi) {
-	xwmfs::FileSysReadGuard read_guard{*xwmfs::filesystem};
-
-	xwmfs::Entry *entry = xwmfs::filesystem->findEntry(path);
-
-	// if entry is a directory then we allow the open call but during any
-	// read/writes we return EISDIR
+void xwmfs_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+	auto entry = xwmfs::entry_from_ino(ino);
 
-	if (!entry) {
-		// if entry not there at all
-		xwmfs::logger->debug()
-			<< __FUNCTION__ << " didn't find " << path << "\n";
-		return -ENOENT;
-	} else if((fi->flags & 3) != O_RDONLY && !entry->isWritable()) {
+	if ((fi->flags & O_ACCMODE) != O_RDONLY && !entry->isWritable()) {
 		// don't allow any write access if entity is not writable
-		return -EACCES;
+		fuse_reply_err(req, EACCES);
+		return;
 	}
 
+	// the open context keeps its own reference
 	auto ctx = entry->createOpenContext();
 
 	if (fi->flags & O_NONBLOCK) {
@@ -168,133 +391,164 @@ int xwmfs_open(const char *path, struct fuse_file_info *fi) {
 
 	if (entry->enableDirectIO()) {
 		fi->direct_io = 1;
+	} else {
+		// all changes are invalidated explicitly, see KernelCache
+		fi->keep_cache = 1;
 	}
 
-	return 0;
+	if (fuse_reply_open(req, fi) != 0) {
+		// the open was interrupted, there will be no release
+		entry->destroyOpenContext(ctx);
+	}
 }
 
 /// This is called as soon as a user of a given file object closes it's file descriptor.
 /**
  * This is the counterpart to xwmfs_open().
  **/
-int xwmfs_release(const char *path, struct fuse_file_info *fi) {
-	(void)path;
-
-	xwmfs::FileSysReadGuard read_guard{*xwmfs::filesystem};
+void xwmfs_release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+	(void)ino;
 
 	auto *context = xwmfs::context_from_fi(fi);
 	auto entry = context->getEntry();
 
 	entry->destroyOpenContext(context);
 
-	// return value is ignored by FUSE
-	return 0;
+	fuse_reply_err(req, 0);
 }
 
-int xwmfs_read(const char *path, char *buf, size_t size,
+void xwmfs_read(fuse_req_t req, fuse_ino_t ino, size_t size,
 		off_t offset, struct fuse_file_info *fi) {
-	(void)path;
-
-	xwmfs::FileSysReadGuard read_guard{*xwmfs::filesystem};
+	(void)ino;
 
 	// get our context pointer back from the file handle field
 	auto context = xwmfs::context_from_fi(fi);
 	auto entry = context->getEntry();
+	// reads may block, keep track of interrupts until we replied. This
+	// costs some global locking, thus only do it if necessary.
+	std::optional<xwmfs::RequestScope> scope;
 
-	try {
-		if (auto res = entry->isOperationAllowed(); res)
-			return res;
-
-		const auto bytes = entry->read(context, buf, size, offset);
-		if (auto raw = cosmos::to_integral(bytes); raw >= 0) {
-			return raw;
-		} else {
-			// bad return value
-			throw cosmos::Errno::NO_DATA;
-		}
-	} catch (const std::exception &ex) {
-		xwmfs::logger->error()
-			<< "Failed to read from " << path << ": " << ex.what() << "\n";
-		return -EFAULT;
-	} catch (const cosmos::Errno errnum) {
-		xwmfs::logger->error()
-			<< "Failed to read from " << path << ": " << errnum << "\n";
-		return xwmfs::errnum_to_fuse_err(errnum);
+	if (entry->mayBlock()) {
+		scope.emplace(req);
 	}
-}
-
-int xwmfs_readlink(const char *path, char *buf, size_t size) {
-	auto &fs = *xwmfs::filesystem;
-	xwmfs::FileSysReadGuard read_guard{fs};
-
-	auto entry = fs.findEntry(path);
 
 	try {
 		if (auto res = entry->isOperationAllowed(); res) {
-			return res;
+			fuse_reply_err(req, -res);
+			return;
 		}
 
-		entry->readlink(buf, size);
-		return 0;
+		// O_NONBLOCK may have been changed via fcntl() since open
+		context->setNonBlocking((fi->flags & O_NONBLOCK) != 0);
+
+		char *buf = xwmfs::reply_buffer(size);
+		const auto bytes = entry->read(context, buf, size, offset);
+
+		if (auto raw = cosmos::to_integral(bytes); raw >= 0) {
+			fuse_reply_buf(req, buf, raw);
+		} else {
+			// a negative error code like -EAGAIN or -EINTR
+			fuse_reply_err(req, -raw);
+		}
 	} catch (const std::exception &ex) {
 		xwmfs::logger->error()
-			<< "Failed to readlink from " << path << ": " << ex.what() << "\n";
-		return -EFAULT;
+			<< "Failed to read from " << entry->name() << ": " << ex.what() << "\n";
+		fuse_reply_err(req, EFAULT);
 	} catch (const cosmos::Errno errnum) {
 		xwmfs::logger->error()
-			<< "Failed to readlink from " << path << ": " << errnum << "\n";
-		return xwmfs::errnum_to_fuse_err(errnum);
+			<< "Failed to read from " << entry->name() << ": " << errnum << "\n";
+		xwmfs::reply_errno(req, errnum);
 	}
 }
 
-int xwmfs_write(const char *path, const char *buf, size_t size,
+void xwmfs_write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size,
 		off_t offset, struct fuse_file_info *fi) {
-	(void)path;
-
-	xwmfs::FileSysReadGuard read_guard{*xwmfs::filesystem};
+	(void)ino;
 
 	auto context = xwmfs::context_from_fi(fi);
 	auto entry = context->getEntry();
 
 	try {
 		if (auto res = entry->isOperationAllowed(); res) {
-			return res;
+			fuse_reply_err(req, -res);
+			return;
 		}
 
 		const auto bytes = entry->write(context, buf, size, offset);
 		if (auto raw = cosmos::to_integral(bytes); raw >= 0) {
-			return raw;
+			fuse_reply_write(req, raw);
 		} else {
 			// bad return value
 			throw cosmos::Errno::NO_DATA;
 		}
 	} catch(const std::exception &ex) {
 		xwmfs::logger->error()
-			<< "Failed to write to " << path << ": " << ex.what() << "\n";
-		return -EFAULT;
+			<< "Failed to write to " << entry->name() << ": " << ex.what() << "\n";
+		fuse_reply_err(req, EFAULT);
 	} catch (const cosmos::Errno errnum) {
 		xwmfs::logger->error()
-			<< "Failed to write to " << path << ": " << errnum << "\n";
-		return xwmfs::errnum_to_fuse_err(errnum);
+			<< "Failed to write to " << entry->name() << ": " << errnum << "\n";
+		xwmfs::reply_errno(req, errnum);
 	}
 }
 
-int xwmfs_truncate(const char *path, off_t size, struct fuse_file_info *fi) {
-	/*
-	 * Do nothing.
-	 *
-	 * Note: Doing nothing on a "proc like fs" is okay I guess.
-	 *
-	 * If you try to append or truncate a writable file on proc then
-	 * nothing happens. We simply implement "overwrite" all the time.
-	 *
-	 * This null implementation is needed for shell operations to succeed
-	 * that try to truncate a file upon writing.
-	 */
-	(void)path;
-	(void)size;
-	(void)fi;
-	return 0;
+/// Checks the I/O readiness of an open file.
+/**
+ * If `ph` is set then the kernel wants to be notified when the readiness
+ * changes, see Entry::poll().
+ **/
+void xwmfs_poll(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi,
+		struct fuse_pollhandle *ph) {
+	(void)ino;
+
+	auto context = xwmfs::context_from_fi(fi);
+	auto entry = context->getEntry();
+
+	fuse_reply_poll(req, entry->poll(context, ph));
+}
+
+/// Opens a directory for listing its contents.
+/**
+ * The DirOpenContext created here contains a snapshot of the directory,
+ * which serves all following readdir requests.
+ **/
+void xwmfs_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+	auto dir_entry = xwmfs::Entry::tryCastDirEntry(xwmfs::entry_from_ino(ino));
+
+	if (!dir_entry) {
+		fuse_reply_err(req, ENOTDIR);
+		return;
+	}
+
+	auto ctx = dir_entry->createOpenContext();
+	fi->fh = (intptr_t)ctx;
+
+	if (fuse_reply_open(req, fi) != 0) {
+		dir_entry->destroyOpenContext(ctx);
+	}
+}
+
+/// A request to list the contents of a directory.
+void xwmfs_readdir(fuse_req_t req, fuse_ino_t ino, size_t size,
+		off_t offset, struct fuse_file_info *fi) {
+	(void)ino;
+	xwmfs::fill_dir(req, size, offset, fi, false);
+}
+
+/// A request to list the contents of a directory including stat information.
+/**
+ * Each entry returned this way counts as a lookup, this saves the kernel
+ * separate lookup() calls for each entry.
+ **/
+void xwmfs_readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size,
+		off_t offset, struct fuse_file_info *fi) {
+	(void)ino;
+	xwmfs::fill_dir(req, size, offset, fi, true);
+}
+
+/// This is the counterpart to xwmfs_opendir().
+void xwmfs_releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info *fi) {
+	xwmfs_release(req, ino, fi);
 }
 
 /// Request to create a file on the file system.
@@ -305,11 +559,13 @@ int xwmfs_truncate(const char *path, off_t size, struct fuse_file_info *fi) {
  * \note On kernels < 2.6.15 mknod() and open() will be called instead of
  * create.
  **/
-int xwmfs_create(const char *path, mode_t mode, struct fuse_file_info *ffi) {
-	(void)path;
+void xwmfs_create(fuse_req_t req, fuse_ino_t parent, const char *name,
+		mode_t mode, struct fuse_file_info *fi) {
+	(void)parent;
+	(void)name;
 	(void)mode;
-	(void)ffi;
-	return -EROFS;
+	(void)fi;
+	fuse_reply_err(req, EROFS);
 }
 
 /// File system initialization.
@@ -319,16 +575,26 @@ int xwmfs_create(const char *path, mode_t mode, struct fuse_file_info *ffi) {
  * We initialize the XWMFS. It will gather all window manager related
  * information and build the file system from it. We set our global file
  * system pointer to that file system for further FUSE processing.
- *
- * \return The returned value is passed to all other operations in the
- * fuse_context structure and also to xwmfs_destroy(void*).
  **/
-void* xwmfs_init(struct fuse_conn_info *conn, struct fuse_config *config) {
-	(void)conn;
+void xwmfs_init(void *userdata, struct fuse_conn_info *conn) {
+	(void)userdata;
 
-	// make interruptible the default, this seems to be the only way.
-	// Otherwise the abort logic for blocking calls is not enabled
-	config->intr = 1;
+	/*
+	 * we invalidate cached content explicitly, see KernelCache. With
+	 * this capability the kernel would drop the cached content whenever
+	 * it notices a changed modification time, including content that
+	 * has been pushed into the cache.
+	 */
+	conn->want &= ~FUSE_CAP_AUTO_INVAL_DATA;
+
+	if (xwmfs::Options::getInstance().lazyAttrs()) {
+		/*
+		 * readdirplus() reports stat data of each listed entry, which
+		 * would fetch all attributes of a window directory upon
+		 * listing it. Let the kernel look up entries separately.
+		 */
+		conn->want &= ~(FUSE_CAP_READDIRPLUS | FUSE_CAP_READDIRPLUS_AUTO);
+	}
 
 	try {
 		xwmfs::Xwmfs &xwmfs = xwmfs::Xwmfs::getInstance();
@@ -350,18 +616,14 @@ void* xwmfs_init(struct fuse_conn_info *conn, struct fuse_config *config) {
 	}
 
 	assert(xwmfs::filesystem);
-
-	// we return our file system instance such that we can access it from
-	// all contexts.
-	return xwmfs::filesystem;
 }
 
 /// File System cleanup callback.
 /**
  * This function is called by FUSE to cleanup the complete file system.
  **/
-void xwmfs_destroy(void* data) {
-	(void)data;
+void xwmfs_destroy(void *userdata) {
+	(void)userdata;
 
 	xwmfs::Xwmfs::getInstance().exit();
 
@@ -0,0 +1,132 @@
+// C++
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <utility>
+
+// libxpp
+#include <xpp/formatting.hxx>
+
+// xwmfs
+#include "fuse/SymlinkEntry.hxx"
+#include "main/AttrIndexDir.hxx"
+#include "main/WindowDirEntry.hxx"
+
+namespace xwmfs {
+
+AttrIndexDir::AttrIndexDir(const std::string &name, const std::string_view attr, KeyFunc key_func,
+			const ValueKeys value_keys) :
+		DirEntry{name},
+		m_attr{attr},
+		m_key_func{std::move(key_func)},
+		m_value_keys{value_keys} {
+}
+
+void AttrIndexDir::lookup(std::string key, std::vector<std::string_view> &windows) const {
+	if (!sanitizeKey(key))
+		return;
+
+	auto key_dir = getEntry(key, Entry::Type::DIRECTORY);
+
+	if (!key_dir)
+		return;
+
+	for (auto link: static_cast<const DirEntry*>(key_dir)->getEntries()) {
+		windows.push_back(link->name());
+	}
+}
+
+bool AttrIndexDir::sanitizeKey(std::string &key) {
+	if (key.empty() || key == "." || key == ".." || key.size() > NAME_MAX) {
+		return false;
+	}
+
+	// path separators can't be part of a name
+	std::replace(key.begin(), key.end(), '/', '_');
+	return true;
+}
+
+void AttrIndexDir::updateWindow(const WindowDirEntry &win) {
+	std::vector<std::string> keys;
+	m_key_func(win, keys);
+
+	keys.erase(std::remove_if(keys.begin(), keys.end(),
+		[](std::string &key) { return !sanitizeKey(key); }), keys.end());
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	const auto id = win.window().id();
+	auto it = m_window_keys.find(id);
+	const std::vector<std::string> no_keys;
+	const auto &old_keys = it == m_window_keys.end() ? no_keys : it->second;
+
+	if (keys == old_keys) {
+		// the common case, some unrelated part of the attribute changed
+		return;
+	}
+
+	const auto &win_name = win.name();
+
+	// both lists are sorted, so only apply the differences
+	std::vector<std::string> diff;
+	std::set_difference(old_keys.begin(), old_keys.end(),
+			keys.begin(), keys.end(), std::back_inserter(diff));
+
+	for (const auto &key: diff) {
+		removeLink(key, win_name);
+	}
+
+	diff.clear();
+	std::set_difference(keys.begin(), keys.end(),
+			old_keys.begin(), old_keys.end(), std::back_inserter(diff));
+
+	for (const auto &key: diff) {
+		addLink(key, win_name);
+	}
+
+	if (keys.empty()) {
+		m_window_keys.erase(it);
+	} else {
+		m_window_keys[id] = std::move(keys);
+	}
+}
+
+void AttrIndexDir::removeWindow(const xpp::WinID win) {
+	auto it = m_window_keys.find(win);
+
+	if (it == m_window_keys.end())
+		return;
+
+	const auto win_name = xpp::to_string(win);
+
+	for (const auto &key: it->second) {
+		removeLink(key, win_name);
+	}
+
+	m_window_keys.erase(it);
+}
+
+void AttrIndexDir::addLink(const std::string &key, const std::string &win) {
+	auto key_dir = getDirEntry(key);
+
+	if (!key_dir) {
+		key_dir = addEntry(new DirEntry{key});
+	}
+
+	key_dir->addEntry(new SymlinkEntry{win, "../../windows/" + win});
+}
+
+void AttrIndexDir::removeLink(const std::string &key, const std::string &win) {
+	auto key_dir = getDirEntry(key);
+
+	if (!key_dir)
+		return;
+
+	key_dir->removeEntry(win);
+
+	if (key_dir->getEntries().size() == 0) {
+		removeEntry(key);
+	}
+}
+
+} // end ns
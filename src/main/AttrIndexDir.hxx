@@ -0,0 +1,99 @@
+#pragma once
+
+// C++
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// libxpp
+#include <xpp/types.hxx>
+
+// cosmos
+#include <cosmos/utils.hxx>
+
+// xwmfs
+#include "fuse/DirEntry.hxx"
+
+namespace xwmfs {
+
+class WindowDirEntry;
+
+/// A directory indexing windows by the value of one of their attributes.
+/**
+ * For each distinct key derived from the attribute a sub-directory exists,
+ * containing a symlink for each window carrying that key. The symlinks point
+ * towards the top-level `windows/<id>` directory, like `by-class/xterm/<id>`.
+ * Key directories are created when the first window gets indexed under them
+ * and removed again with the last window.
+ *
+ * The index is updated incrementally whenever the attribute of a window
+ * changes, see WindowsRootDir::attributeChanged(). Like all structural
+ * changes this only happens in the event thread, which is also the only one
+ * accessing m_window_keys.
+ **/
+class AttrIndexDir :
+		public DirEntry {
+public: // types
+
+	/// Determines the keys `win` is to be indexed under.
+	/**
+	 * The function is called from the event thread and may access the
+	 * file content of `win` without an EpochGuard.
+	 **/
+	using KeyFunc = std::function<void (const WindowDirEntry &win, std::vector<std::string> &keys)>;
+
+	/// Whether the keys are the lines of the attribute value itself.
+	using ValueKeys = cosmos::NamedBool<struct value_keys_t, false>;
+
+public: // functions
+
+	/// Creates an index named `name` depending on the window attribute `attr`.
+	/**
+	 * If `value_keys` is set then windows can be looked up by the lines
+	 * of their attribute value via lookup().
+	 **/
+	AttrIndexDir(const std::string &name, const std::string_view attr, KeyFunc key_func,
+			const ValueKeys value_keys = ValueKeys{false});
+
+	/// Returns the name of the window attribute this index depends on.
+	std::string_view attribute() const { return m_attr; }
+
+	bool hasValueKeys() const { return m_value_keys; }
+
+	/// Appends the names of the windows indexed under `key` to `windows`.
+	/**
+	 * In contrast to the other functions this can be called from any
+	 * thread. The caller needs to hold an EpochGuard, the names are
+	 * only valid as long as the guard is held. Since keys are
+	 * sanitized the result may contain windows whose keys only
+	 * resemble `key`.
+	 **/
+	void lookup(std::string key, std::vector<std::string_view> &windows) const;
+
+	/// Indexes `win` according to the current value of its attribute.
+	void updateWindow(const WindowDirEntry &win);
+
+	/// Removes all index entries of `win`.
+	void removeWindow(const xpp::WinID win);
+
+protected: // functions
+
+	/// Turns `key` into a valid directory name, returns `false` if impossible.
+	static bool sanitizeKey(std::string &key);
+
+	void addLink(const std::string &key, const std::string &win);
+
+	void removeLink(const std::string &key, const std::string &win);
+
+protected: // data
+
+	const std::string m_attr;
+	KeyFunc m_key_func;
+	const bool m_value_keys;
+	/// The keys each window is currently indexed under.
+	std::map<xpp::WinID, std::vector<std::string>> m_window_keys;
+};
+
+} // end ns
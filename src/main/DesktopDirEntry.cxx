@@ -8,7 +8,7 @@ DesktopDirEntry::DesktopDirEntry(size_t nr, const std::string &name) :
 		DirEntry{std::to_string(nr)}, m_nr{nr}, m_name{name} {
 	auto name_node = new FileEntry{"name"};
 
-	*name_node << name << "\n";
+	name_node->setContent(name + "\n");
 
 	this->addEntry(name_node);
 	this->addEntry(new DirEntry{"windows"});
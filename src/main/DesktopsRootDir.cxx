@@ -1,4 +1,5 @@
 // C++
+#include <optional>
 #include <vector>
 
 // xwmfs
@@ -6,6 +7,8 @@
 #include "main/DesktopDirEntry.hxx"
 #include "main/DesktopsRootDir.hxx"
 #include "main/Exception.hxx"
+#include "main/Xwmfs.hxx"
+#include "x11/PropertyFetcher.hxx"
 #include "x11/WinManagerWindow.hxx"
 
 namespace xwmfs {
@@ -14,15 +17,28 @@ using WindowMap = std::map<size_t, std::vector<xpp::XWindow>>;
 
 static WindowMap buildWindowMap(const xpp::RootWin &root_win) {
 	WindowMap ret;
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
 
+	// request the desktop assignment of all windows in one go
 	for (const auto winid: root_win.windowList()) {
+		fetcher.requestProperty(winid, xpp::atoms::ewmh_desktop_nr);
+	}
+
+	fetcher.collect();
+
+	for (const auto winid: root_win.windowList()) {
+		auto value = fetcher.findProperty(winid, xpp::atoms::ewmh_desktop_nr);
+
 		try {
-			auto window = xpp::XWindow{winid};
-			// TODO: libxpp conversion: this no longer uses caching
-			auto desktop_nr = window.getDesktop();
-			ret[desktop_nr].push_back(window);
+			if (!value) {
+				// has no desktop assignment for some reason
+				continue;
+			}
+
+			const auto desktop_nr = static_cast<int>(value->asNumber());
+			ret[desktop_nr].push_back(xpp::XWindow{winid});
 		} catch (const std::exception &ex) {
-			// has no desktop assignment for some reason
+			// malformed desktop assignment
 			continue;
 		}
 	}
@@ -30,36 +46,58 @@ static WindowMap buildWindowMap(const xpp::RootWin &root_win) {
 	return ret;
 }
 
-DesktopsRootDir::DesktopsRootDir(WinManagerWindow &root) :
-		DirEntry{"desktops"}, m_root_win{root} {
-}
+/// Returns the desktop `w` is assigned to, if any.
+static std::optional<int> queryDesktop(const xpp::XWindow &w) {
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+	fetcher.requestProperty(w.id(), xpp::atoms::ewmh_desktop_nr);
+	fetcher.collect();
 
-void DesktopsRootDir::handleDesktopsChanged() {
-	// Currently we rebuild the complete structure every time desktop
-	// names change or desktops (dis)appear. This could be more
-	// efficient by only applying incremental changes but also more
-	// complex to do right.
-	this->clear();
-	m_window_desktop_dir_map.clear();
+	auto value = fetcher.findProperty(w.id(), xpp::atoms::ewmh_desktop_nr);
 
-	m_root_win.queryWindows();
+	if (!value) {
+		// no desktop assigned yet
+		return std::nullopt;
+	}
 
-	const auto window_map = buildWindowMap(m_root_win);
-	const auto &desktops = m_root_win.getDesktopNames();
+	try {
+		return static_cast<int>(value->asNumber());
+	} catch (const std::exception &) {
+		return std::nullopt;
+	}
+}
 
-	for (size_t i = 0; i < desktops.size(); i++) {
-		auto desktop_dir = new DesktopDirEntry{i, desktops[i]};
-		this->addEntry(desktop_dir);
+DesktopsRootDir::DesktopsRootDir(WinManagerWindow &root) :
+		DirEntry{"desktops"}, m_root_win{root} {
+}
 
-		auto window_it = window_map.find(i);
-		if (window_it == window_map.end())
-			continue;
-		auto &windows = window_it->second;
+CommitFunction DesktopsRootDir::prepareDesktopsChanged() {
+	m_root_win.queryWindows();
 
-		for (auto window: windows) {
-			addWindowToDesktop(desktop_dir, window);
+	auto window_map = buildWindowMap(m_root_win);
+	auto desktops = m_root_win.getDesktopNames();
+
+	return [this, window_map = std::move(window_map), desktops = std::move(desktops)]() {
+		// Currently we rebuild the complete structure every time
+		// desktop names change or desktops (dis)appear. This could be
+		// more efficient by only applying incremental changes but
+		// also more complex to do right.
+		this->clear();
+		m_window_desktop_dir_map.clear();
+
+		for (size_t i = 0; i < desktops.size(); i++) {
+			auto desktop_dir = new DesktopDirEntry{i, desktops[i]};
+			this->addEntry(desktop_dir);
+
+			auto window_it = window_map.find(i);
+			if (window_it == window_map.end())
+				continue;
+			auto &windows = window_it->second;
+
+			for (auto window: windows) {
+				addWindowToDesktop(desktop_dir, window);
+			}
 		}
-	}
+	};
 }
 
 void DesktopsRootDir::addWindowToDesktop(DesktopDirEntry *dir, const xpp::XWindow &window) {
@@ -90,53 +128,56 @@ DesktopDirEntry* DesktopsRootDir::getDesktopDir(const size_t desktop_nr) {
 	return reinterpret_cast<DesktopDirEntry*>(ret);
 }
 
-void DesktopsRootDir::handleWindowCreated(const xpp::XWindow &w) {
-	int desktop_nr = -1;
+CommitFunction DesktopsRootDir::prepareWindowCreated(const xpp::XWindow &w) {
+	const auto desktop_nr = queryDesktop(w);
 
-	try {
-		desktop_nr = w.getDesktop();
-	} catch (const xpp::XWindow::PropertyNotExisting &) {
-		// no desktop assigned yet
-		return;
-	}
+	if (!desktop_nr || *desktop_nr < 0)
+		return {};
 
-	auto desktop_entry = this->getDesktopDir(desktop_nr);
+	return [this, w, desktop_nr]() {
+		auto desktop_entry = this->getDesktopDir(*desktop_nr);
 
-	if (!desktop_entry)
-		// could be a race condition, new window created but also
-		// the desktop structure changed in the meantime. Should be
-		// covered by handleDesktopsChanged().
-		return;
+		if (!desktop_entry)
+			// could be a race condition, new window created but
+			// also the desktop structure changed in the meantime.
+			// Should be covered by prepareDesktopsChanged().
+			return;
 
-	addWindowToDesktop(desktop_entry, w);
+		addWindowToDesktop(desktop_entry, w);
+	};
 }
 
 void DesktopsRootDir::handleWindowDestroyed(const xpp::XWindow &w) {
 	removeWindow(w);
 }
 
-void DesktopsRootDir::handleWindowDesktopChanged(const xpp::XWindow &w) {
-	auto it = m_window_desktop_dir_map.find(w.id());
+CommitFunction DesktopsRootDir::prepareWindowDesktopChanged(const xpp::XWindow &w) {
+	const auto desktop_nr = queryDesktop(w);
 
-	if (it == m_window_desktop_dir_map.end()) {
-		// so maybe this is the first time a value is assigned for the
-		// desktop, do a plain add
-		return handleWindowCreated(w);
-	}
+	if (!desktop_nr || *desktop_nr < 0)
+		// should not happen
+		return {};
 
-	const auto desktop_nr = w.getDesktop();
-	auto desktop_dir = it->second;
+	return [this, w, desktop_nr]() {
+		auto it = m_window_desktop_dir_map.find(w.id());
 
-	if (desktop_nr < 0)
-		// should not happen
-		return;
+		if (it != m_window_desktop_dir_map.end()) {
+			if (static_cast<size_t>(*desktop_nr) == it->second->getDesktopNr())
+				// unchanged for some reason
+				return;
 
-	if (static_cast<size_t>(desktop_nr) == desktop_dir->getDesktopNr())
-		// unchanged for some reason
-		return;
+			removeWindow(w);
+		}
 
-	removeWindow(w);
-	addWindowToDesktop(desktop_dir, w);
+		// if the window wasn't known before then this is the first
+		// time a value is assigned for the desktop
+		auto desktop_dir = this->getDesktopDir(*desktop_nr);
+
+		if (!desktop_dir)
+			return;
+
+		addWindowToDesktop(desktop_dir, w);
+	};
 }
 
 } // end ns
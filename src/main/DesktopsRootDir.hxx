@@ -8,6 +8,7 @@
 #include <xpp/types.hxx>
 
 // xwmfs
+#include "common/types.hxx"
 #include "fuse/DirEntry.hxx"
 
 namespace xwmfs {
@@ -33,13 +34,29 @@ public: // functions
 
 	DesktopsRootDir(WinManagerWindow &root);
 
-	void handleDesktopsChanged();
+	/// Rebuilds the complete directory structure.
+	/**
+	 * This performs both phases of prepareDesktopsChanged() in one go.
+	 **/
+	void handleDesktopsChanged() {
+		prepareDesktopsChanged()();
+	}
 
-	void handleWindowDesktopChanged(const xpp::XWindow &w);
+	/// Prepares rebuilding the directory structure after the desktops changed.
+	/**
+	 * The window to desktop assignments are queried from the X server,
+	 * this needs to be called with the event lock held but without any
+	 * directory locks. The returned function rebuilds the structure.
+	 **/
+	CommitFunction prepareDesktopsChanged();
 
-	void handleWindowDestroyed(const xpp::XWindow &w);
+	/// Prepares moving `w` to the desktop it is currently assigned to.
+	CommitFunction prepareWindowDesktopChanged(const xpp::XWindow &w);
+
+	/// Prepares adding the newly created `w` to its desktop.
+	CommitFunction prepareWindowCreated(const xpp::XWindow &w);
 
-	void handleWindowCreated(const xpp::XWindow &w);
+	void handleWindowDestroyed(const xpp::XWindow &w);
 
 protected: // functions
 
@@ -1,5 +1,10 @@
 #pragma once
 
+// C++
+#include <cstddef>
+#include <set>
+#include <string>
+
 namespace xwmfs {
 
 /// Simple class to store global XWMFS program options
@@ -34,6 +39,36 @@ public: // functions
 	/// Sets the pseudo windows handling to \c val
 	void setHandlePseudoWindows(const bool val) { m_handle_pseudo_windows = val; }
 
+	/// Returns whether window attributes should be fetched lazily.
+	/**
+	 * In lazy mode window directories are created without querying any
+	 * attributes from the X server. Each attribute file is only
+	 * populated when it is accessed for the first time and after
+	 * change notifications for it have been received.
+	 **/
+	bool lazyAttrs() const { return m_lazy_attrs; }
+
+	/// Sets the lazy attribute handling to \c val
+	void setLazyAttrs(const bool val) { m_lazy_attrs = val; }
+
+	/// Returns whether the content of files named `name` should be pushed into the kernel cache.
+	/**
+	 * Such files are written into the kernel's page cache as soon as
+	 * their content changes, thus readers don't need to call into xwmfs
+	 * at all. This applies to window attributes as well as to files in
+	 * the wm directory.
+	 **/
+	bool pushAttr(const std::string &name) const { return m_push_attrs.count(name) != 0; }
+
+	/// Sets the names of files whose content should be pushed into the kernel cache.
+	void setPushAttrs(const std::set<std::string> &names) { m_push_attrs = names; }
+
+	/// Returns the maximum number of events kept for slow readers of event files.
+	size_t eventBacklog() const { return m_event_backlog; }
+
+	/// Sets the event backlog to \c val
+	void setEventBacklog(const size_t val) { m_event_backlog = val; }
+
 	/// Returns the singleton instance of the options object
 	static Options& getInstance() {
 		static Options opt;
@@ -53,6 +88,9 @@ private: // data
 
 	bool m_xsync = false;
 	bool m_handle_pseudo_windows = false;
+	bool m_lazy_attrs = false;
+	std::set<std::string> m_push_attrs;
+	size_t m_event_backlog = 64;
 };
 
 } // end ns
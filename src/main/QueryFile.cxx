@@ -0,0 +1,127 @@
+// C++
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// cosmos
+#include <cosmos/thread/Mutex.hxx>
+
+// xwmfs
+#include "fuse/EpochReclaimer.hxx"
+#include "fuse/OpenContext.hxx"
+#include "main/Options.hxx"
+#include "main/QueryFile.hxx"
+#include "main/WindowDirEntry.hxx"
+#include "main/WindowPredicate.hxx"
+#include "main/WindowTable.hxx"
+#include "main/WindowsRootDir.hxx"
+#include "main/Xwmfs.hxx"
+
+namespace xwmfs {
+
+namespace {
+
+struct QueryOpenContext :
+		public OpenContext {
+
+	using OpenContext::OpenContext;
+
+	/// Protects the result against concurrent use of the same file descriptor.
+	cosmos::Mutex lock;
+	/// The result of the most recent query.
+	std::string result;
+	/// The amount of `result` already returned to the client.
+	size_t pos = 0;
+};
+
+} // end anon ns
+
+QueryFile::QueryFile(const WindowsRootDir &windows) :
+		Entry{"query", REG_FILE, cosmos::RealTime{}, Writable{true}},
+		m_windows{windows} {
+}
+
+OpenContext* QueryFile::createOpenContext() {
+	auto ret = new QueryOpenContext{this};
+
+	this->ref();
+
+	return ret;
+}
+
+QueryFile::Bytes QueryFile::read(OpenContext *ctx, char *buf, size_t size, off_t offset) {
+	// the result is consumed sequentially, regardless of the offset
+	(void)offset;
+	auto &query_ctx = *static_cast<QueryOpenContext*>(ctx);
+	cosmos::MutexGuard g{query_ctx.lock};
+	const auto &result = query_ctx.result;
+
+	const auto bytes = std::min(size, result.size() - query_ctx.pos);
+	std::memcpy(buf, result.data() + query_ctx.pos, bytes);
+	query_ctx.pos += bytes;
+
+	return Bytes{static_cast<int>(bytes)};
+}
+
+QueryFile::Bytes QueryFile::write(OpenContext *ctx, const char *buf, size_t size, off_t offset) {
+	// every write replaces the query, regardless of the offset
+	(void)offset;
+	constexpr std::string_view TABLE_PREFIX{"table="};
+	WindowPredicate predicate;
+	std::optional<WindowTable> table;
+
+	for (const auto word: predicate.parse(std::string_view{buf, size})) {
+		if (!word.starts_with(TABLE_PREFIX)) {
+			throw cosmos::Errno::INVALID_ARG;
+		}
+
+		table.emplace();
+
+		if (!WindowTable::parse(word.substr(TABLE_PREFIX.size()), *table)) {
+			throw cosmos::Errno::INVALID_ARG;
+		}
+	}
+
+	std::string result;
+
+	{
+		EpochGuard guard;
+
+		if (Options::getInstance().lazyAttrs()) {
+			// fetch what the query depends on first, this must not
+			// happen while holding the commit lock.
+			WindowDirEntry::materialize(m_windows.collectWindows(), predicate.attributes());
+
+			if (table) {
+				// only the likely matches need the table columns
+				const auto &columns = table->columns();
+				WindowDirEntry::materialize(predicate.select(m_windows),
+					std::vector<std::string_view>{columns.begin(), columns.end()});
+			}
+		}
+
+		// don't evaluate against a partially committed event batch
+		cosmos::MutexGuard g{Xwmfs::getInstance().getCommitLock()};
+		const auto matches = predicate.select(m_windows);
+
+		if (table) {
+			table->render(matches, result);
+		} else {
+			for (const auto win: matches) {
+				result += win->name();
+				result += '\n';
+			}
+		}
+	}
+
+	auto &query_ctx = *static_cast<QueryOpenContext*>(ctx);
+	cosmos::MutexGuard g{query_ctx.lock};
+	query_ctx.result = std::move(result);
+	query_ctx.pos = 0;
+
+	return Bytes{static_cast<int>(size)};
+}
+
+} // end ns
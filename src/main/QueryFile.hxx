@@ -0,0 +1,51 @@
+#pragma once
+
+// C++
+#include <string>
+
+// xwmfs
+#include "fuse/Entry.hxx"
+
+namespace xwmfs {
+
+class WindowsRootDir;
+
+/// Represents the "query" root file for ad-hoc window queries.
+/**
+ * A client writes a query to its open file descriptor and subsequently
+ * reads back the result. A query consists of whitespace separated
+ * WindowPredicate terms like "class=xterm desktop=2 mapped=1". By default
+ * the IDs of all matching windows are returned, one per line. An
+ * additional "table=<spec>" word selects a WindowTable to render for the
+ * matching windows instead, like "table=id,name,geometry.json".
+ *
+ * The query is evaluated once during write() while holding
+ * Xwmfs::getCommitLock(), the result is stored in the OpenContext. Like
+ * for EventFile the file offset is ignored: reads continue where the
+ * previous read stopped and return EOF once the result is consumed. Each
+ * write replaces the result of the previous query. Invalid queries are
+ * rejected with EINVAL.
+ **/
+class QueryFile :
+		public Entry {
+public: // functions
+
+	explicit QueryFile(const WindowsRootDir &windows);
+
+	OpenContext* createOpenContext() override;
+
+	/// The content depends on the writing client, thus bypass the kernel cache.
+	bool enableDirectIO() const override { return true; }
+
+protected: // functions
+
+	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
+
+	Bytes write(OpenContext *ctx, const char *buf, size_t size, off_t offset) override;
+
+protected: // data
+
+	const WindowsRootDir &m_windows;
+};
+
+} // end ns
@@ -3,7 +3,6 @@
 
 // xwmfs
 #include "fuse/AbortHandler.hxx"
-#include "fuse/xwmfs_fuse.hxx"
 #include "main/Exception.hxx"
 #include "main/logger.hxx"
 #include "main/SelectionAccessFile.hxx"
@@ -31,8 +30,6 @@ Entry::Bytes SelectionAccessFile::read(
 		// no one owns the selection at the moment
 		throw cosmos::Errno::AGAIN;
 	} else if (m_owner != xwmfs.getSelectionWindow()) {
-		// stupid situation here, see EventFile::read
-		FileSysRevReadGuard guard(xwmfs.getFS());
 		updateSelection();
 	}
 	// else: we ourselves own the selection, so just return our local node
@@ -55,8 +52,7 @@ Entry::Bytes SelectionAccessFile::write(
 	sel_window.makeSelectionOwner(m_sel_type, xpp::XTime::CURRENT_TIME);
 
 	// store the data for later requests to provide the selection buffer
-	this->str("");
-	(*this) << std::string(data, bytes);
+	this->setContent(std::string_view{data, bytes});
 
 	return Bytes{static_cast<int>(bytes)};
 }
@@ -73,8 +69,7 @@ void SelectionAccessFile::reportConversionResult(const xpp::AtomID result_prop)
 
 void SelectionAccessFile::provideConversion(xpp::XWindow &requestor,
 		const xpp::AtomID target_prop) const {
-	cosmos::MutexGuard g{m_parent.getLock()};
-	const auto copy = this->str();
+	const auto copy = this->content();
 	xpp::Property<xpp::utf8_string> data{xpp::utf8_string{copy.c_str()}};
 	requestor.setProperty(target_prop, data);
 }
@@ -128,8 +123,7 @@ void SelectionAccessFile::updateSelection() {
 		xpp::Property<xpp::utf8_string> selection_data;
 		sel_win.getProperty(m_target_prop, selection_data);
 
-		this->str("");
-		(*this) << selection_data.get().str;
+		this->setContent(selection_data.get().str);
 	} catch (const std::exception &ex) {
 		xwmfs::logger->error()
 			<< "Failed to acquire selection buffer conversion data: "
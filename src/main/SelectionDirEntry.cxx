@@ -8,6 +8,7 @@
 #include <xpp/event/SelectionRequestEvent.hxx>
 
 // xwmfs
+#include "fuse/EventFile.hxx"
 #include "main/logger.hxx"
 #include "main/SelectionAccessFile.hxx"
 #include "main/SelectionDirEntry.hxx"
@@ -67,6 +68,9 @@ void SelectionDirEntry::createSelectionAccessFiles() {
 
 		m_selection_access_files.push_back(file);
 		addEntry(file);
+		// register the event kind used in reportEvent() right away,
+		// event filters only accept registered kinds
+		EventKind::intern(file->name());
 	}
 }
 
@@ -91,6 +95,8 @@ void SelectionDirEntry::conversionResult(const xpp::SelectionEvent &ev) {
 			break;
 		}
 	}
+
+	reportEvent(ev.selection(), Xwmfs::getInstance().getSelectionWindow().id());
 }
 
 void SelectionDirEntry::conversionRequest(const xpp::SelectionRequestEvent &ev) {
@@ -113,6 +119,7 @@ void SelectionDirEntry::conversionRequest(const xpp::SelectionRequestEvent &ev)
 	xpp::XWindow requestor{ev.requestor()};
 	selection_file->provideConversion(requestor, ev.property());
 	replyConversionRequest(ev, true);
+	reportEvent(ev.selection(), ev.requestor());
 }
 
 void SelectionDirEntry::replyConversionRequest(
@@ -142,6 +149,24 @@ void SelectionDirEntry::lostOwnership(const xpp::SelectionClearEvent &ev) {
 	// selection data?
 	logger->info() << "Lost ownership of selection buffer '"
 		<< selectionBufferLabel(ev.selection()) << "'\n";
+
+	reportEvent(ev.selection(), Xwmfs::getInstance().getSelectionWindow().id());
+}
+
+void SelectionDirEntry::reportEvent(const xpp::AtomID selection, const xpp::WinID win) {
+	for (const auto &file: m_selection_access_files) {
+		if (file->type() == selection) {
+			// name the event after the affected access file
+			Xwmfs::getInstance().getEvents().addEvent(
+				EventKind::intern(file->name()),
+				EventInfo{
+					static_cast<uint32_t>(win),
+					true, {},
+					Xwmfs::getEventOrigin(), {}
+				});
+			break;
+		}
+	}
 }
 
 } // end ns
@@ -99,6 +99,9 @@ protected: // functions
 
 	void replyConversionRequest(const xpp::SelectionRequestEvent &ev, const bool good);
 
+	/// Reports an event concerning the `selection` buffer and window `win` via the global events file.
+	void reportEvent(const xpp::AtomID selection, const xpp::WinID win);
+
 	/// Returns the label for the selection buffer identified by `atom`.
 	std::string selectionBufferLabel(const xpp::AtomID atom) const;
 
@@ -1,3 +1,6 @@
+// C++
+#include <sstream>
+
 // libxpp
 #include <xpp/XWindow.hxx>
 
@@ -41,20 +44,22 @@ Entry::Bytes SelectionOwnerFile::read(
 }
 
 void SelectionOwnerFile::updateOwners() {
-	this->str("");
+	std::stringstream ss;
 
 	xpp::XWindow owner;
 
 	for (const auto &selection: m_selection_dir.getSelectionTypes()) {
 		owner = xpp::XWindow{m_selection_dir.getSelectionOwner(selection.first)};
 
-		(*this) << selection.second << ": ";
+		ss << selection.second << ": ";
 		if (owner.id() == xpp::WinID::INVALID)
-			(*this) << "0";
+			ss << "0";
 		else 
-			(*this) << xpp::to_string(owner.id());
-		*this << "\n";
+			ss << xpp::to_string(owner.id());
+		ss << "\n";
 	}
+
+	this->setContent(ss.str());
 }
 
 } // end ns
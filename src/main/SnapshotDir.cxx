@@ -0,0 +1,123 @@
+// C++
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// xwmfs
+#include "fuse/EpochReclaimer.hxx"
+#include "fuse/OpenContext.hxx"
+#include "main/SnapshotDir.hxx"
+#include "main/WindowDirEntry.hxx"
+#include "main/WindowsRootDir.hxx"
+#include "main/Xwmfs.hxx"
+
+namespace xwmfs {
+
+namespace {
+
+struct SnapshotOpenContext :
+		public OpenContext {
+
+	using OpenContext::OpenContext;
+
+	/// The table rendered at open time.
+	std::string data;
+};
+
+} // end anon ns
+
+std::atomic<uint64_t> SnapshotFile::m_use_counter = 0;
+
+SnapshotFile::SnapshotFile(const std::string &name, const WindowsRootDir &windows, const WindowTable &table) :
+		Entry{name, REG_FILE, cosmos::RealTime{}},
+		m_windows{windows},
+		m_table{table} {
+	markUsed();
+}
+
+OpenContext* SnapshotFile::createOpenContext() {
+	auto ret = new SnapshotOpenContext{this};
+	markUsed();
+
+	{
+		EpochGuard guard;
+		const auto &columns = m_table.columns();
+		// fetch lazy attributes first, this must not happen while
+		// holding the commit lock.
+		WindowDirEntry::materialize(m_windows.collectWindows(),
+			std::vector<std::string_view>{columns.begin(), columns.end()});
+
+		// don't render a partially committed event batch
+		cosmos::MutexGuard g{Xwmfs::getInstance().getCommitLock()};
+		m_table.render(m_windows.collectWindows(), ret->data);
+	}
+
+	this->ref();
+
+	return ret;
+}
+
+SnapshotFile::Bytes SnapshotFile::read(OpenContext *ctx, char *buf, size_t size, off_t offset) {
+	if (offset < 0) {
+		throw cosmos::Errno::INVALID_ARG;
+	}
+
+	const auto &data = static_cast<SnapshotOpenContext*>(ctx)->data;
+
+	if (static_cast<size_t>(offset) >= data.size()) {
+		return Bytes{0};
+	}
+
+	const auto bytes = std::min(size, data.size() - offset);
+	std::memcpy(buf, data.data() + offset, bytes);
+
+	return Bytes{static_cast<int>(bytes)};
+}
+
+SnapshotDir::SnapshotDir(const WindowsRootDir &windows) :
+		DirEntry{"snapshot"},
+		m_windows{windows} {
+}
+
+Entry* SnapshotDir::lookupEntry(const std::string_view name) {
+	if (auto entry = getEntry(name); entry) {
+		return entry;
+	}
+
+	WindowTable table;
+
+	if (!WindowTable::parse(name, table)) {
+		return nullptr;
+	}
+
+	cosmos::MutexGuard g{m_create_lock};
+
+	// somebody else might have been faster
+	if (auto entry = getEntry(name); entry) {
+		return entry;
+	} else if (getEntries().size() >= MAX_TABLES) {
+		evictTable();
+	}
+
+	return addEntry(new SnapshotFile{std::string{name}, m_windows, table});
+}
+
+void SnapshotDir::evictTable() {
+	const SnapshotFile *oldest = nullptr;
+
+	for (auto entry: getEntries()) {
+		// we only ever contain SnapshotFiles
+		auto file = static_cast<const SnapshotFile*>(entry);
+
+		if (!oldest || file->lastUse() < oldest->lastUse()) {
+			oldest = file;
+		}
+	}
+
+	// open files and kernel references keep the entry alive until
+	// they're gone, our EpochGuard keeps it alive for the moment.
+	removeEntry(oldest->name());
+}
+
+} // end ns
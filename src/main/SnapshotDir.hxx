@@ -0,0 +1,98 @@
+#pragma once
+
+// C++
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// cosmos
+#include <cosmos/thread/Mutex.hxx>
+
+// xwmfs
+#include "fuse/DirEntry.hxx"
+#include "main/WindowTable.hxx"
+
+namespace xwmfs {
+
+class WindowsRootDir;
+
+/// A read-only file presenting a WindowTable of all windows.
+/**
+ * The table is rendered once when the file is opened, while holding
+ * Xwmfs::getCommitLock(). Thus all rows reflect the same state of the file
+ * system, and successive reads of the same open file see the same content.
+ * In lazy attribute mode the outdated columns are fetched beforehand.
+ * Attributes that change in between are rendered with their previous
+ * value.
+ **/
+class SnapshotFile :
+		public Entry {
+public: // functions
+
+	SnapshotFile(const std::string &name, const WindowsRootDir &windows, const WindowTable &table);
+
+	/// Creates an OpenContext carrying the rendered table.
+	OpenContext* createOpenContext() override;
+
+	/// The content is generated on open, thus bypass the kernel cache.
+	bool enableDirectIO() const override { return true; }
+
+	/// Returns a value that is larger the more recently the file was created or opened.
+	uint64_t lastUse() const { return m_last_use.load(std::memory_order_relaxed); }
+
+protected: // functions
+
+	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
+
+	void markUsed() {
+		m_last_use.store(++m_use_counter, std::memory_order_relaxed);
+	}
+
+protected: // data
+
+	const WindowsRootDir &m_windows;
+	const WindowTable m_table;
+	/// The value of m_use_counter when the file was last created or opened.
+	std::atomic<uint64_t> m_last_use;
+	/// Counts uses of all SnapshotFiles, see lastUse().
+	static std::atomic<uint64_t> m_use_counter;
+};
+
+/// Represents the "snapshot" root directory.
+/**
+ * Looking up a name in this directory that is a valid WindowTable
+ * specification, like "id,class,geometry" or "id,name.json", creates a
+ * SnapshotFile for it on demand. Created files are kept around for
+ * subsequent lookups. To bound the memory used for this, at most
+ * MAX_TABLES files are kept. Beyond that the least recently used file is
+ * removed to make room for a new one. Processes that still have it open
+ * can continue to use it.
+ **/
+class SnapshotDir :
+		public DirEntry {
+public: // functions
+
+	explicit SnapshotDir(const WindowsRootDir &windows);
+
+	Entry* lookupEntry(const std::string_view name) override;
+
+public: // data
+
+	static constexpr size_t MAX_TABLES = 64;
+
+protected: // functions
+
+	/// Removes the least recently used SnapshotFile.
+	/**
+	 * Must be called with m_create_lock held, from within an EpochGuard.
+	 **/
+	void evictTable();
+
+protected: // data
+
+	const WindowsRootDir &m_windows;
+	/// Serializes the on-demand creation and removal of SnapshotFile entries.
+	cosmos::Mutex m_create_lock;
+};
+
+} // end ns
@@ -1,8 +1,13 @@
+// C++
+#include <sstream>
+
 // xwmfs
+#include "main/logger.hxx"
 #include "main/UpdatableDir.hxx"
 #include "main/WinManagerDirEntry.hxx"
 #include "main/WindowDirEntry.hxx"
 #include "main/Xwmfs.hxx"
+#include "x11/PropertyFetcher.hxx"
 
 namespace xwmfs {
 
@@ -43,7 +48,34 @@ UpdatableDir<CLASS>::getAlwaysUpdateSpecs() const {
 
 template <typename CLASS>
 void UpdatableDir<CLASS>::updateModifyTime() {
-	m_modify_time = Xwmfs::getInstance().getCurrentTime();
+	setModifyTime(Xwmfs::getInstance().getCurrentTime());
+}
+
+template <typename CLASS>
+void UpdatableDir<CLASS>::requestSpec(PropertyFetcher &fetcher,
+		const xpp::WinID win, const EntrySpec &spec) {
+	for (const auto atom: spec.atoms) {
+		fetcher.requestProperty(win, atom);
+	}
+}
+
+template <typename CLASS>
+std::optional<std::string> UpdatableDir<CLASS>::render(const EntrySpec &spec,
+		const PropertyFetcher &fetched) {
+	std::stringstream content;
+
+	try {
+		(static_cast<CLASS*>(this)->*(spec.member_func))(content, fetched);
+	} catch (const std::exception &ex) {
+		logger->debug()
+			<< "Couldn't get " << spec.name << " for " << m_name
+			<< ": " << ex.what() << "\n";
+		return std::nullopt;
+	}
+
+	content << '\n';
+
+	return content.str();
 }
 
 /* explicit template instantiations */
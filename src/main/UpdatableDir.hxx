@@ -2,6 +2,9 @@
 
 // C++
 #include <map>
+#include <optional>
+#include <ostream>
+#include <string>
 #include <vector>
 
 // libxpp
@@ -10,16 +13,19 @@
 // xwmfs
 #include "common/types.hxx"
 #include "fuse/DirEntry.hxx"
+#include "fuse/EventKind.hxx"
 
 namespace xwmfs {
 
+class PropertyFetcher;
+
 /// Base class for directories that contain updatable files.
 template <typename CLASS>
 class UpdatableDir :
 		public DirEntry {
 protected: // types
 
-	using UpdateFunction = void (CLASS::*)(FileEntry &entry);
+	using UpdateFunction = void (CLASS::*)(std::ostream &out, const PropertyFetcher &fetched);
 	using AlwaysUpdate = cosmos::NamedBool<struct always_update_t, false>;
 
 	/// Holds information about a single file entry.
@@ -34,26 +40,31 @@ protected: // types
 		UpdateFunction member_func = nullptr;
 		/// The associated AtomIDs, if any.
 		xpp::AtomIDVector atoms;
+		/// The event reported when the entry changes, named like the entry.
+		EventKind event;
 
 		EntrySpec(const char *n, UpdateFunction f,
 				const Writable wrt = Writable{false},
 				const AlwaysUpdate always = AlwaysUpdate{false}) :
 			name{n}, writable{wrt},
 			always_update{always},
-			member_func{f}, atoms{{}} {
+			member_func{f}, atoms{{}},
+			event{EventKind::intern(n)} {
 		}
 
 		EntrySpec(const char *n, UpdateFunction f,
 				const xpp::AtomID atom,
 				const Writable wrt = Writable{false}) :
 			name{n}, writable{wrt},
-			member_func{f}, atoms{{atom}} {
+			member_func{f}, atoms{{atom}},
+			event{EventKind::intern(n)} {
 		}
 
 		EntrySpec(const char *n, UpdateFunction f,
 				const xpp::AtomIDVector &av,
 				const Writable wrt = Writable{false}) :
-			name(n), writable(wrt), member_func(f), atoms(av) {
+			name(n), writable(wrt), member_func(f), atoms(av),
+			event{EventKind::intern(n)} {
 		}
 	};
 
@@ -61,12 +72,45 @@ protected: // types
 	using AtomSpecMap = std::map<xpp::AtomID, EntrySpec>;
 	using SpecVector = std::vector<EntrySpec>;
 
+	/// The outcome of the fetch phase of an entry update.
+	/**
+	 * Updates are split into a fetch phase that performs X requests
+	 * without holding any directory locks and a commit phase that
+	 * only puts the already rendered content into place, see
+	 * CommitFunction.
+	 **/
+	struct PendingUpdate {
+		/// The spec of the entry to be updated.
+		const EntrySpec *spec = nullptr;
+		/// The new content of the entry or nothing if it couldn't be obtained.
+		std::optional<std::string> content;
+	};
+
+	using PendingUpdates = std::vector<PendingUpdate>;
+
 protected: // functions
 
 	UpdatableDir(const std::string &n, const SpecVector &vec);
 
 	void updateModifyTime();
 
+	/// Requests the properties of `win` needed for rendering `spec`.
+	static void requestSpec(PropertyFetcher &fetcher, const xpp::WinID win,
+			const EntrySpec &spec);
+
+	/// Renders the content for the entry described by `spec`.
+	/**
+	 * This calls the spec's update function which is supposed to use the
+	 * data collected in `fetched`, see requestSpec(). No file system
+	 * state is touched.
+	 *
+	 * \return
+	 * 	The rendered content including a trailing newline or
+	 * 	std::nullopt if the update function failed.
+	 **/
+	std::optional<std::string> render(const EntrySpec &spec,
+			const PropertyFetcher &fetched);
+
 	AtomSpecMap getUpdateMap() const;
 	SpecVector getAlwaysUpdateSpecs() const;
 
@@ -0,0 +1,304 @@
+// C++
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+// POSIX
+#include <poll.h>
+
+// FUSE
+#include <fuse_lowlevel.h>
+
+// cosmos
+#include <cosmos/thread/Condition.hxx>
+
+// xwmfs
+#include "fuse/AbortHandler.hxx"
+#include "fuse/EpochReclaimer.hxx"
+#include "fuse/OpenContext.hxx"
+#include "main/Options.hxx"
+#include "main/WaitFile.hxx"
+#include "main/WindowDirEntry.hxx"
+#include "main/WindowPredicate.hxx"
+#include "main/WindowsRootDir.hxx"
+#include "main/Xwmfs.hxx"
+
+namespace xwmfs {
+
+struct WaitOpenContext :
+		public OpenContext {
+
+	WaitOpenContext(Entry *entry, cosmos::Mutex &lock) :
+			OpenContext{entry},
+			cond{lock} {
+	}
+
+	WaitOpenContext(const WaitOpenContext&) = delete;
+
+	~WaitOpenContext() {
+		if (poll_handle) {
+			fuse_pollhandle_destroy(poll_handle);
+		}
+	}
+
+	/// Blocked readers of this context wait on this, bound to WaitFile::m_lock.
+	cosmos::Condition cond;
+	/// The condition this reader is waiting for, by default any window.
+	WindowPredicate predicate;
+	/// The number of threads currently blocking on `cond`.
+	size_t num_waiting = 0;
+	/// A pending poll notification request, if any.
+	struct fuse_pollhandle *poll_handle = nullptr;
+};
+
+WaitFile::WaitFile(const WindowsRootDir &windows) :
+		Entry{"wait", REG_FILE, cosmos::RealTime{}, Writable{true}},
+		m_windows{windows},
+		m_lazy{Options::getInstance().lazyAttrs()} {
+	this->createAbortHandler(m_lock, [this]() {
+		for (auto ctx: m_waiters) {
+			ctx->cond.broadcast();
+		}
+	});
+}
+
+OpenContext* WaitFile::createOpenContext() {
+	auto ret = new WaitOpenContext{this, m_lock};
+
+	this->ref();
+
+	return ret;
+}
+
+void WaitFile::destroyOpenContext(OpenContext *ctx) {
+	{
+		cosmos::MutexGuard g{m_lock};
+		auto it = std::find(m_pollers.begin(), m_pollers.end(), ctx);
+
+		if (it != m_pollers.end()) {
+			m_pollers.erase(it);
+		}
+	}
+
+	Entry::destroyOpenContext(ctx);
+}
+
+bool WaitFile::markDeleted() {
+	PollHandles handles;
+	bool ret = false;
+
+	{
+		cosmos::MutexGuard g{m_lock};
+		ret = Entry::markDeleted();
+
+		// make sure any blocked readers notice we're gone
+		for (auto ctx: m_waiters) {
+			ctx->cond.broadcast();
+		}
+
+		for (auto ctx: m_pollers) {
+			handles.push_back(std::exchange(ctx->poll_handle, nullptr));
+		}
+
+		m_pollers.clear();
+	}
+
+	notifyPollers(handles);
+
+	return ret;
+}
+
+std::string WaitFile::findMatches(const WindowPredicate &predicate) const {
+	std::string ret;
+
+	for (const auto win: predicate.select(m_windows)) {
+		ret += win->name();
+		ret += '\n';
+	}
+
+	return ret;
+}
+
+std::string WaitFile::evaluate(const WaitOpenContext &ctx) {
+	const auto predicate = ctx.predicate;
+	// the event thread acquires m_lock while holding the commit lock
+	cosmos::MutexReverseGuard rg{m_lock};
+	EpochGuard guard;
+
+	if (m_lazy) {
+		// this must not happen while holding the commit lock
+		WindowDirEntry::materialize(m_windows.collectWindows(), predicate.attributes());
+	}
+
+	cosmos::MutexGuard g{Xwmfs::getInstance().getCommitLock()};
+	return findMatches(predicate);
+}
+
+void WaitFile::notifyPollers(const PollHandles &handles) {
+	for (auto ph: handles) {
+		// a notification only causes the kernel to poll() again
+		fuse_lowlevel_notify_poll(ph);
+		fuse_pollhandle_destroy(ph);
+	}
+}
+
+void WaitFile::windowsChanged() {
+	PollHandles handles;
+
+	{
+		EpochGuard guard;
+		cosmos::MutexGuard g{m_lock};
+
+		m_generation++;
+
+		// in lazy mode the predicates may refer to outdated
+		// attributes, which can't be fetched here, see evaluate().
+		for (auto ctx: m_waiters) {
+			if (m_lazy || !findMatches(ctx->predicate).empty()) {
+				ctx->cond.broadcast();
+			}
+		}
+
+		for (size_t i = 0; i < m_pollers.size();) {
+			auto ctx = m_pollers[i];
+
+			if (!m_lazy && findMatches(ctx->predicate).empty()) {
+				i++;
+				continue;
+			}
+
+			handles.push_back(std::exchange(ctx->poll_handle, nullptr));
+			m_pollers[i] = m_pollers.back();
+			m_pollers.pop_back();
+		}
+	}
+
+	notifyPollers(handles);
+}
+
+unsigned WaitFile::poll(OpenContext *ctx, struct fuse_pollhandle *ph) {
+	auto &wait_ctx = *(reinterpret_cast<WaitOpenContext*>(ctx));
+
+	cosmos::MutexGuard g{m_lock};
+
+	while (true) {
+		const auto generation = m_generation;
+
+		if (isDeleted() || !evaluate(wait_ctx).empty()) {
+			if (ph) {
+				fuse_pollhandle_destroy(ph);
+			}
+
+			return POLLIN;
+		} else if (generation != m_generation) {
+			// windows changed while evaluating, try again
+			continue;
+		} else if (ph) {
+			// only the most recent handle is of interest
+			if (wait_ctx.poll_handle) {
+				fuse_pollhandle_destroy(wait_ctx.poll_handle);
+			} else {
+				m_pollers.push_back(&wait_ctx);
+			}
+
+			wait_ctx.poll_handle = ph;
+		}
+
+		return 0;
+	}
+}
+
+int WaitFile::waitForMatch(WaitOpenContext &ctx, char *buf, size_t size) {
+	cosmos::MutexGuard g{m_lock};
+	std::string matches;
+
+	while (true) {
+		const auto generation = m_generation;
+		matches = evaluate(ctx);
+
+		if (!matches.empty()) {
+			break;
+		} else if (this->isDeleted()) {
+			// file was closed in the meantime, signal EOF
+			return 0;
+		} else if (ctx.isNonBlocking()) {
+			return -EAGAIN;
+		} else if (m_abort_handler->wasAborted()) {
+			return -EINTR;
+		} else if (generation != m_generation) {
+			// windows changed while evaluating, try again
+			continue;
+		}
+
+		if (!m_abort_handler->prepareBlockingCall(this)) {
+			return -EINTR;
+		}
+
+		if (ctx.num_waiting++ == 0) {
+			m_waiters.push_back(&ctx);
+		}
+
+		ctx.cond.wait();
+
+		if (--ctx.num_waiting == 0) {
+			auto it = std::find(m_waiters.begin(), m_waiters.end(), &ctx);
+			*it = m_waiters.back();
+			m_waiters.pop_back();
+		}
+
+		m_abort_handler->finishedBlockingCall();
+	}
+
+	// return as many complete lines as fit, truncate if not even one does
+	size_t used = matches.size();
+
+	if (used > size) {
+		const auto last = matches.rfind('\n', size - 1);
+		used = last == matches.npos ? size : last + 1;
+	}
+
+	std::memcpy(buf, matches.data(), used);
+	return static_cast<int>(used);
+}
+
+WaitFile::Bytes WaitFile::read(OpenContext *ctx, char *buf, size_t size, off_t offset) {
+	// each read reflects the current state, regardless of the offset
+	(void)offset;
+	auto &wait_ctx = *(reinterpret_cast<WaitOpenContext*>(ctx));
+
+	// like EventFile we only use our own lock here, so we can block
+	// without hindering unrelated operations.
+	return Bytes{waitForMatch(wait_ctx, buf, size)};
+}
+
+WaitFile::Bytes WaitFile::write(OpenContext *ctx, const char *buf, size_t size, off_t offset) {
+	// every write replaces the predicate, regardless of the offset
+	(void)offset;
+	WindowPredicate predicate;
+
+	if (!predicate.parse(std::string_view{buf, size}).empty()) {
+		throw cosmos::Errno::INVALID_ARG;
+	}
+
+	auto &wait_ctx = *(reinterpret_cast<WaitOpenContext*>(ctx));
+	PollHandles handles;
+
+	{
+		cosmos::MutexGuard g{m_lock};
+
+		wait_ctx.predicate = std::move(predicate);
+		// let waiters and pollers re-evaluate using the new predicate
+		wait_ctx.cond.broadcast();
+
+		if (wait_ctx.poll_handle) {
+			handles.push_back(std::exchange(wait_ctx.poll_handle, nullptr));
+			std::erase(m_pollers, &wait_ctx);
+		}
+	}
+
+	notifyPollers(handles);
+
+	return Bytes{static_cast<int>(size)};
+}
+
+} // end ns
@@ -0,0 +1,117 @@
+#pragma once
+
+// C++
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// cosmos
+#include <cosmos/thread/Mutex.hxx>
+
+// xwmfs
+#include "fuse/Entry.hxx"
+
+namespace xwmfs {
+
+class WindowPredicate;
+class WindowsRootDir;
+struct WaitOpenContext;
+
+/// Represents the "wait" root file for blocking until a window condition holds.
+/**
+ * A client writes a WindowPredicate like "class=xterm mapped=1" to its open
+ * file descriptor. A subsequent read blocks until at least one window
+ * satisfies the predicate and returns the IDs of all matching windows, one
+ * per line. If the predicate is already satisfied then the read returns
+ * immediately, thus each read reflects the state at that time.
+ *
+ * Blocked readers and pending pollers are re-evaluated by the event thread
+ * after each committed batch of events, see windowsChanged(), and only
+ * woken up if their predicate is satisfied. In lazy attribute mode the
+ * attributes a predicate refers to need to be fetched first, which the
+ * event thread can't do. All of them are woken up then, to re-evaluate on
+ * their own. Blocking reads can be aborted like for EventFile, with
+ * O_NONBLOCK a read fails with EAGAIN instead.
+ **/
+class WaitFile :
+		public Entry {
+public: // functions
+
+	explicit WaitFile(const WindowsRootDir &windows);
+
+	OpenContext* createOpenContext() override;
+
+	void destroyOpenContext(OpenContext *ctx) override;
+
+	/// Reports readability if the predicate of `ctx` is satisfied.
+	unsigned poll(OpenContext *ctx, struct fuse_pollhandle *ph) override;
+
+	/// Wakes up readers and pollers whose predicate is now satisfied.
+	/**
+	 * This is called by the event thread after each committed batch of
+	 * events, while holding Xwmfs::getCommitLock().
+	 **/
+	void windowsChanged();
+
+	bool enableDirectIO() const override { return true; }
+
+	/// We always allow operations on the wait file, even if closed.
+	int isOperationAllowed() const override { return 0; }
+
+protected: // types
+
+	/// Poll handles taken from pending pollers while holding m_lock.
+	using PollHandles = std::vector<struct fuse_pollhandle*>;
+
+protected: // functions
+
+	bool markDeleted() override;
+
+	/// Blocks until the predicate of `ctx` is satisfied, then returns the matching windows.
+	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
+
+	/// Replaces the predicate of the writer's open context.
+	Bytes write(OpenContext *ctx, const char *buf, size_t size, off_t offset) override;
+
+	/// Returns the newline terminated IDs of the windows satisfying `predicate`.
+	/**
+	 * The caller needs to hold an EpochGuard and either be the event
+	 * thread or hold Xwmfs::getCommitLock().
+	 **/
+	std::string findMatches(const WindowPredicate &predicate) const;
+
+	/// Like findMatches() but acquires Xwmfs::getCommitLock() itself.
+	/**
+	 * This must be called with m_lock held, which is temporarily released
+	 * to maintain the lock order of the event thread. In lazy attribute
+	 * mode the outdated attributes the predicate refers to are fetched
+	 * beforehand.
+	 **/
+	std::string evaluate(const WaitOpenContext &ctx);
+
+	/// Returns the matching windows for `ctx` as soon as there are any.
+	int waitForMatch(WaitOpenContext &ctx, char *buf, size_t size);
+
+	/// Notifies the kernel about readiness of `handles` and frees them.
+	/**
+	 * This talks to the kernel, thus it must not be called with m_lock
+	 * held.
+	 **/
+	static void notifyPollers(const PollHandles &handles);
+
+protected: // data
+
+	const WindowsRootDir &m_windows;
+	/// Whether attributes are only fetched upon access, see Options::lazyAttrs().
+	const bool m_lazy;
+	/// Protects all of the following data and the state of all WaitOpenContexts.
+	cosmos::Mutex m_lock;
+	/// Incremented each time windowsChanged() is called.
+	uint64_t m_generation = 0;
+	/// Open contexts with threads blocking in waitForMatch().
+	std::vector<WaitOpenContext*> m_waiters;
+	/// Open contexts waiting for a poll notification.
+	std::vector<WaitOpenContext*> m_pollers;
+};
+
+} // end ns
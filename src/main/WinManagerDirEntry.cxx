@@ -1,22 +1,33 @@
+// C++
+#include <sstream>
+
 // libxpp
 #include <xpp/atoms.hxx>
 
 // xwmfs
 #include "fuse/EventFile.hxx"
-#include "main/DesktopsRootDir.hxx"
 #include "main/WinManagerDirEntry.hxx"
 #include "main/WinManagerFileEntry.hxx"
-#include "main/Xwmfs.hxx"
 #include "main/logger.hxx"
+#include "main/Options.hxx"
+#include "main/Xwmfs.hxx"
+#include "x11/PropertyFetcher.hxx"
 #include "x11/WinManagerWindow.hxx"
 
 namespace xwmfs {
 
+namespace {
+
+const EventKind CREATED_EVENT = EventKind::intern("created");
+const EventKind DESTROYED_EVENT = EventKind::intern("destroyed");
+
+} // end anon ns
+
 WinManagerDirEntry::WinManagerDirEntry(WinManagerWindow &root_win) :
 		UpdatableDir{"wm", getSpecVector()}, m_root_win{root_win} {
 	addEntries();
 
-	m_events = new EventFile{*this, "events"};
+	m_events = new EventFile{"events"};
 
 	addEntry(m_events);
 }
@@ -50,17 +61,37 @@ WinManagerDirEntry::SpecVector WinManagerDirEntry::getSpecVector() const {
 	}};
 }
 
-void WinManagerDirEntry::forwardEvent(const EntrySpec &changed_entry) {
-	m_events->addEvent(changed_entry.name);
+void WinManagerDirEntry::forwardEvent(const EntrySpec &changed_entry, const std::string_view value) {
+	EventInfo info{
+		static_cast<uint32_t>(m_root_win.id()),
+		false, {},
+		Xwmfs::getEventOrigin(), {}
+	};
+
+	auto &fs = Xwmfs::getInstance();
+	m_events->addEvent(changed_entry.event, info);
+	// the global files need to tell WM and window events apart
+	info.show_window = true;
+	fs.getEvents().addEvent(changed_entry.event, info);
+	info.value = value;
+	fs.getChanges().addEvent(changed_entry.event, info);
 }
 
 void WinManagerDirEntry::addEntries() {
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+
+	for (const auto &spec: m_specs) {
+		requestSpec(fetcher, m_root_win.id(), spec);
+	}
+
+	fetcher.collect();
+
 	for (const auto &spec: m_specs) {
-		addSpecEntry(spec);
+		addSpecEntry(spec, fetcher);
 	}
 }
 
-void WinManagerDirEntry::addSpecEntry(const EntrySpec &spec) {
+void WinManagerDirEntry::addSpecEntry(const EntrySpec &spec, const PropertyFetcher &fetched) {
 	FileEntry *entry = nullptr;
 
 	if (spec.writable)
@@ -68,14 +99,21 @@ void WinManagerDirEntry::addSpecEntry(const EntrySpec &spec) {
 	else
 		entry = new xwmfs::FileEntry{spec.name};
 
-	(this->*(spec.member_func))(*entry);
+	entry->setPushContent(Options::getInstance().pushAttr(spec.name));
+
+	std::stringstream content;
 
-	*entry << '\n';
+	(this->*(spec.member_func))(content, fetched);
+
+	content << '\n';
+
+	// populate the entry before adding it, readers can see it right away
+	entry->setContent(content.str());
 
 	this->addEntry(entry);
 }
 
-void WinManagerDirEntry::update(const xpp::AtomID changed_atom) {
+CommitFunction WinManagerDirEntry::prepareUpdate(const xpp::AtomID changed_atom) {
 	auto it = m_atom_update_map.find(changed_atom);
 
 	if (it == m_atom_update_map.end()) {
@@ -83,41 +121,49 @@ void WinManagerDirEntry::update(const xpp::AtomID changed_atom) {
 			<< "Root window unknown property ("
 			<< cosmos::to_integral(changed_atom) << ") changed"
 			<< "\n";
-		return;
+		return {};
 	}
 
 	const auto &update_spec = it->second;
-	FileEntry *entry = getFileEntry(update_spec.name);
 
-	if (entry) {
-		logger->debug()
-			<< "WinManagerDirEntry::" << __FUNCTION__
-			<< ": update for " << update_spec.name << "\n";
-	} else {
-		logger->warn()
-			<< "WinManagerDirEntry::" << __FUNCTION__
-			<< "File entry " << update_spec.name
-			<< " not existing?" << "\n";
-		return;
-	}
+	logger->debug()
+		<< "WinManagerDirEntry::" << __FUNCTION__
+		<< ": update for " << update_spec.name << "\n";
 
-	this->updateModifyTime();
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+	requestSpec(fetcher, m_root_win.id(), update_spec);
+	fetcher.collect();
 
-	entry->str("");
+	auto content = render(update_spec, fetcher);
 
-	try {
-		(this->*(update_spec.member_func))(*entry);
-		*entry << '\n';
-	} catch (const std::exception &ex) {
+	if (!content) {
 		logger->error()
 			<< "Error updating " << update_spec.name << " property"
-			<< ex.what() << "\n";
-		return;
+			<< "\n";
+		return {};
 	}
 
-	entry->setModifyTime(m_modify_time);
+	return [this, &update_spec, content = std::move(*content)]() {
+		FileEntry *entry = getFileEntry(update_spec.name);
+
+		if (!entry) {
+			logger->warn()
+				<< "WinManagerDirEntry: file entry "
+				<< update_spec.name
+				<< " not existing?" << "\n";
+			return;
+		}
+
+		{
+			cosmos::MutexGuard g{m_lock};
+			this->updateModifyTime();
+
+			entry->setContent(content, m_modify_time);
+		}
 
-	forwardEvent(update_spec);
+		// the event file takes our lock on its own
+		forwardEvent(update_spec, content);
+	};
 }
 
 void WinManagerDirEntry::delProp(const xpp::AtomID deleted_atom) {
@@ -126,20 +172,25 @@ void WinManagerDirEntry::delProp(const xpp::AtomID deleted_atom) {
 }
 
 void WinManagerDirEntry::windowLifecycleEvent(const xpp::XWindow &win,
-		const bool created_else_destroyed) {
-	std::string event = created_else_destroyed ? "created" : "destroyed";
-	event += " ";
-	event += xpp::to_string(win.id());
-	m_events->addEvent(event);
+		const bool created_else_destroyed, const std::string_view classes) {
+	const auto kind = created_else_destroyed ? CREATED_EVENT : DESTROYED_EVENT;
+	const EventInfo info{
+		static_cast<uint32_t>(win.id()),
+		true, classes,
+		Xwmfs::getEventOrigin(), {}
+	};
+
+	m_events->addEvent(kind, info);
+	Xwmfs::getInstance().getEvents().addEvent(kind, info);
 }
 
-void WinManagerDirEntry::updateNumberOfDesktops(FileEntry &entry) {
-	m_root_win.fetchNumDesktops();
-	entry << m_root_win.getNumDesktops();
+void WinManagerDirEntry::updateNumberOfDesktops(std::ostream &out, const PropertyFetcher &fetched) {
+	m_root_win.updateNumDesktops(fetched);
+	out << m_root_win.getNumDesktops();
 }
 
-void WinManagerDirEntry::updateDesktopNames(FileEntry &entry) {
-	m_root_win.fetchDesktopNames();
+void WinManagerDirEntry::updateDesktopNames(std::ostream &out, const PropertyFetcher &fetched) {
+	m_root_win.updateDesktopNames(fetched);
 
 	bool first = true;
 	size_t pos;
@@ -153,44 +204,39 @@ void WinManagerDirEntry::updateDesktopNames(FileEntry &entry) {
 		if (first)
 			first = false;
 		else
-			entry << "\n";
-
-		entry << name;
-	}
+			out << "\n";
 
-	// update the sibling desktops directory structure
-	auto desktops = Xwmfs::getInstance().getDesktopsDir();
-	if (desktops) {
-		desktops->handleDesktopsChanged();
+		out << name;
 	}
 }
 
-void WinManagerDirEntry::updateActiveDesktop(FileEntry &entry) {
-	m_root_win.fetchActiveDesktop();
-	entry << (m_root_win.hasActiveDesktop() ?
+void WinManagerDirEntry::updateActiveDesktop(std::ostream &out, const PropertyFetcher &fetched) {
+	m_root_win.updateActiveDesktop(fetched);
+	out << (m_root_win.hasActiveDesktop() ?
 		m_root_win.getActiveDesktop() : -1);
 }
 
-void WinManagerDirEntry::updateActiveWindow(FileEntry &entry) {
-	m_root_win.fetchActiveWindow();
+void WinManagerDirEntry::updateActiveWindow(std::ostream &out, const PropertyFetcher &fetched) {
+	m_root_win.updateActiveWindow(fetched);
 	const auto win_id = m_root_win.hasActiveWindow() ?
 		m_root_win.getActiveWindow() :
 		xpp::WinID::INVALID;
-	entry << xpp::to_string(win_id);
+	out << xpp::to_string(win_id);
 }
 
-void WinManagerDirEntry::updateShowDesktopMode(FileEntry &entry) {
-	entry << (m_root_win.hasShowDesktopMode() ?
+void WinManagerDirEntry::updateShowDesktopMode(std::ostream &out, const PropertyFetcher &fetched) {
+	m_root_win.updateShowDesktopMode(fetched);
+	out << (m_root_win.hasShowDesktopMode() ?
 		m_root_win.getShowDesktopMode() : -1);
 }
 
-void WinManagerDirEntry::updateName(FileEntry &entry) {
-	entry << (m_root_win.hasWMName() ?
+void WinManagerDirEntry::updateName(std::ostream &out, const PropertyFetcher &) {
+	out << (m_root_win.hasWMName() ?
 		m_root_win.getWMName() : "N/A");
 }
 
-void WinManagerDirEntry::updateClass(FileEntry &entry) {
-	entry << (m_root_win.hasWMClass() ?
+void WinManagerDirEntry::updateClass(std::ostream &out, const PropertyFetcher &) {
+	out << (m_root_win.hasWMClass() ?
 		m_root_win.getWMClass() : "N/A");
 }
 
@@ -1,5 +1,8 @@
 #pragma once
 
+// C++
+#include <string_view>
+
 // libxpp
 #include <xpp/fwd.hxx>
 #include <xpp/types.hxx>
@@ -24,35 +27,46 @@ public: // functions
 
 	explicit WinManagerDirEntry(WinManagerWindow &root_win);
 
-	/// Update window manager data denoted by `changed_atom`.
-	void update(const xpp::AtomID changed_atom);
+	/// Prepares an update of the window manager data denoted by `changed_atom`.
+	/**
+	 * This is the fetch phase of a property change, it needs to be called
+	 * with the event lock held but without any directory locks. The
+	 * returned function puts the new data into place.
+	 **/
+	CommitFunction prepareUpdate(const xpp::AtomID changed_atom);
 
 	/// Reflect deletion of the denoted `deleted_atom` in the FS.
 	void delProp(const xpp::AtomID deleted_atom);
 
 	/// To be called when a window was created or destroyed.
+	/**
+	 * \param[in] classes
+	 * 	The window's class names for event filtering, see
+	 * 	WindowDirEntry::windowClasses().
+	 **/
 	void windowLifecycleEvent(
 		const xpp::XWindow &win,
-		const bool created_else_destroyed
+		const bool created_else_destroyed,
+		const std::string_view classes
 	);
 
 protected: // functions
 
 	void addEntries();
 
-	void addSpecEntry(const UpdatableDir<WinManagerDirEntry>::EntrySpec &spec);
+	void addSpecEntry(const EntrySpec &spec, const PropertyFetcher &fetched);
 
 	SpecVector getSpecVector() const;
 
-	void forwardEvent(const EntrySpec &changed_entry);
+	void forwardEvent(const EntrySpec &changed_entry, const std::string_view value);
 
-	void updateNumberOfDesktops(FileEntry &entry);
-	void updateDesktopNames(FileEntry &entry);
-	void updateActiveDesktop(FileEntry &entry);
-	void updateActiveWindow(FileEntry &entry);
-	void updateShowDesktopMode(FileEntry &entry);
-	void updateName(FileEntry &entry);
-	void updateClass(FileEntry &entry);
+	void updateNumberOfDesktops(std::ostream &out, const PropertyFetcher &fetched);
+	void updateDesktopNames(std::ostream &out, const PropertyFetcher &fetched);
+	void updateActiveDesktop(std::ostream &out, const PropertyFetcher &fetched);
+	void updateActiveWindow(std::ostream &out, const PropertyFetcher &fetched);
+	void updateShowDesktopMode(std::ostream &out, const PropertyFetcher &fetched);
+	void updateName(std::ostream &out, const PropertyFetcher &fetched);
+	void updateClass(std::ostream &out, const PropertyFetcher &fetched);
 
 protected: // data
 
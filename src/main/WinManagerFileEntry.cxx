@@ -50,6 +50,9 @@ Entry::Bytes WinManagerFileEntry::write(OpenContext *ctx, const char *data,
 		}
 
 		cosmos::MutexGuard g{m_parent->getLock()};
+		// the event thread updates the cached root window state
+		// while holding this, see Xwmfs::getEventLock()
+		cosmos::MutexGuard event_guard{Xwmfs::getInstance().getEventLock()};
 
 		callUpdateFunc(the_num);
 	} catch (const xpp::XWindow::NotImplemented &e) {
@@ -1,78 +1,168 @@
+// C++
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+// X11
+#include <X11/Xatom.h>
+
 // libxpp
-#include <xpp/AtomMapper.hxx>
 #include <xpp/atoms.hxx>
 #include <xpp/event/ConfigureEvent.hxx>
 #include <xpp/helpers.hxx>
-#include <xpp/Property.hxx>
-#include <xpp/X11Exception.hxx>
-#include <xpp/XWindowAttrs.hxx>
 
 // xwmfs
+#include "fuse/EpochReclaimer.hxx"
 #include "fuse/EventFile.hxx"
+#include "main/Exception.hxx"
 #include "main/logger.hxx"
+#include "main/Options.hxx"
 #include "main/WindowDirEntry.hxx"
 #include "main/WindowFileEntry.hxx"
+#include "main/WindowsRootDir.hxx"
+#include "main/Xwmfs.hxx"
+#include "x11/PropertyFetcher.hxx"
 
 namespace xwmfs {
 
+namespace {
+
+const EventKind DESTROYED_EVENT = EventKind::intern("destroyed");
+const EventKind MAPPED_EVENT = EventKind::intern("mapped");
+const EventKind GEOMETRY_EVENT = EventKind::intern("geometry");
+const EventKind PARENT_EVENT = EventKind::intern("parent");
+
+/// Appends `value` to `out`, escaping newlines and backslashes.
+void append_escaped(std::string &out, const std::string_view value) {
+	for (const auto ch: value) {
+		switch (ch) {
+		case '\n': out += "\\n"; break;
+		case '\\': out += "\\\\"; break;
+		default: out += ch; break;
+		}
+	}
+}
+
+} // end anon ns
+
 WindowDirEntry::WindowDirEntry(const xpp::XWindow &win,
+			const PropertyFetcher &fetched,
 			const bool query_attrs) :
 		UpdatableDir{xpp::to_string(win.id()), getSpecVector()},
-		m_win{win} {
-	addEntries();
+		m_win{win},
+		m_lazy{Options::getInstance().lazyAttrs()} {
+	addEntries(fetched);
 
-	m_events = new EventFile{*this, "events"};
+	m_events = new EventFile{"events"};
 	addEntry(m_events);
 
+	const auto &opts = Options::getInstance();
+
 	m_mapped = new WindowFileEntry{"mapped",
 		m_win, m_modify_time, Writable{false}};
+	m_mapped->setPushContent(opts.pushAttr(m_mapped->name()));
 	addEntry(m_mapped);
 
 	m_geometry = new WindowFileEntry{"geometry",
 		m_win, m_modify_time, Writable{true}};
+	m_geometry->setPushContent(opts.pushAttr(m_geometry->name()));
 	addEntry(m_geometry);
-	{
-		xpp::XWindowAttrs attrs;
-		try {
-			m_win.getAttrs(attrs);
-			updateGeometry(attrs);
-		} catch (const xpp::X11Exception &ex) {
-			// window disappeared again?
-		}
-	}
 
 	// NOTE: might become a writable entry, using XReparentWindow(),
 	// pretty obscure though
 	m_parent = new WindowFileEntry{"parent",
 		m_win, m_modify_time, Writable{false}};
+	m_parent->setPushContent(opts.pushAttr(m_parent->name()));
 	addEntry(m_parent);
-	try {
-		m_win.updateFamily();
-	} catch (const xpp::X11Exception &ex) {
-		// window disappeared again?
+
+	m_all = new WindowFileEntry{"all",
+		m_win, m_modify_time, Writable{false}};
+	m_all->setPushContent(opts.pushAttr(m_all->name()));
+	addEntry(m_all);
+
+	if (m_lazy) {
+		// everything will be fetched upon first access
+		m_geometry->setOutdated();
+		m_parent->setOutdated();
+		m_all->setOutdated();
+
+		if (query_attrs) {
+			m_mapped->setOutdated();
+		} else {
+			setDefaultAttrs();
+		}
+
+		return;
+	}
+
+	if (auto attrs = fetched.findAttrs(m_win.id()); attrs) {
+		updateGeometry(*attrs);
+	} // else window disappeared again?
+
+	if (auto parent = fetched.findParent(m_win.id()); parent) {
+		m_win.setParent(*parent);
 	}
 	updateParent();
 
 	if (query_attrs) {
-		queryAttrs();
+		queryAttrs(fetched);
 	} else {
 		setDefaultAttrs();
 	}
+
+	updateAll();
 }
 
-void WindowDirEntry::addEntries() {
+void WindowDirEntry::requestInitialData(PropertyFetcher &fetcher, const xpp::WinID win) {
+	const bool lazy = Options::getInstance().lazyAttrs();
+
+	for (const auto &spec: getSpecVector()) {
+		if (!lazy || isEagerSpec(spec)) {
+			requestSpec(fetcher, win, spec);
+		}
+	}
+
+	if (lazy) {
+		// everything else will be fetched upon first access
+		return;
+	}
+
+	fetcher.requestPropertyList(win, PropertyFetcher::WithValues{true});
+	fetcher.requestAttrs(win);
+	fetcher.requestParent(win);
+}
+
+void WindowDirEntry::addEntries(const PropertyFetcher &fetched) {
 	for (const auto &spec: m_specs) {
-		addSpecEntry(spec);
+		if (isLazy(spec)) {
+			// the content will be fetched upon first access
+			addSpecEntry(spec, std::nullopt);
+			continue;
+		}
+
+		/*
+		 * If this fails then this can happen legally. It is a race
+		 * condition. We've been so fast to register the window but it
+		 * hasn't got a name or whatever property yet.
+		 *
+		 * The name will be noticed later on via a property update.
+		 */
+		if (auto content = render(spec, fetched); content) {
+			addSpecEntry(spec, content);
+		}
 	}
 }
 
 bool WindowDirEntry::markDeleted() {
-	m_events->addEvent("destroyed");
+	// the global events file learns about this via
+	// WinManagerDirEntry::windowLifecycleEvent()
+	EpochGuard guard;
+	m_events->addEvent(DESTROYED_EVENT, eventInfo());
 
 	return UpdatableDir::markDeleted();
 }
 
-WindowDirEntry::SpecVector WindowDirEntry::getSpecVector() const {
+WindowDirEntry::SpecVector WindowDirEntry::getSpecVector() {
 	return SpecVector{{
 		EntrySpec{"id", &WindowDirEntry::updateId},
 		EntrySpec{"name", &WindowDirEntry::updateWindowName, {
@@ -88,7 +178,8 @@ WindowDirEntry::SpecVector WindowDirEntry::getSpecVector() const {
 		EntrySpec{"control", &WindowDirEntry::updateCommandControl,
 			Writable{true}},
 		EntrySpec{"client_machine",
-			&WindowDirEntry::updateClientMachine},
+			&WindowDirEntry::updateClientMachine,
+			xpp::AtomID{XA_WM_CLIENT_MACHINE}},
 		EntrySpec{"properties",
 			&WindowDirEntry::updateProperties,
 			Writable{true},
@@ -109,35 +200,25 @@ WindowDirEntry::SpecVector WindowDirEntry::getSpecVector() const {
 	}};
 }
 
-void WindowDirEntry::addSpecEntry(
-		const UpdatableDir<WindowDirEntry>::EntrySpec &spec) {
-	FileEntry *entry = new xwmfs::WindowFileEntry{
+WindowFileEntry* WindowDirEntry::addSpecEntry(const EntrySpec &spec,
+		const std::optional<std::string> &content) {
+	auto entry = new xwmfs::WindowFileEntry{
 		spec.name, m_win, m_modify_time, spec.writable
 	};
 
-	try {
-		(this->*(spec.member_func))(*entry);
-	} catch (const std::exception &ex) {
-		/*
-		 * This can happen legally. It is a race condition. We've been
-		 * so fast to register the window but it hasn't got a name or
-		 * whatever property yet.
-		 *
-		 * The name will be noticed later on via a property update.
-		 */
-		xwmfs::logger->debug()
-			<< "Couldn't get " << spec.name
-			<< " for window " << xpp::to_string(m_win.id())
-			<< " right away" << std::endl;
-		delete entry;
-		return;
-	}
+	entry->setPushContent(Options::getInstance().pushAttr(spec.name));
 
-	*entry << '\n';
+	// populate the entry before adding it, readers can see it right away
+	if (content) {
+		entry->setContent(*content);
+	} else {
+		entry->setOutdated();
+	}
 
 	this->addEntry(entry, DirEntry::InheritTime{false});
-}
 
+	return entry;
+}
 
 std::string WindowDirEntry::getCommandInfo() {
 	std::string ret;
@@ -153,159 +234,561 @@ std::string WindowDirEntry::getCommandInfo() {
 	return ret;
 }
 
-void WindowDirEntry::updateAll() {
-	for (auto it: m_atom_update_map) {
-		update(it.first);
+CommitFunction WindowDirEntry::prepareUpdateAll() {
+	{
+		cosmos::MutexGuard g{m_prop_cache_lock};
+		// start over with a complete property listing
+		m_prop_cache_valid = false;
+	}
+
+	PendingUpdates updates;
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+	requestInitialData(fetcher, m_win.id());
+	fetcher.collect();
+
+	for (const auto &spec: m_specs) {
+		if (isLazy(spec)) {
+			// only fetch the new value once somebody is interested in it
+			updates.push_back(PendingUpdate{&spec, std::nullopt});
+		} else {
+			updates.push_back(PendingUpdate{&spec, render(spec, fetcher)});
+		}
 	}
+
+	return [this, updates = std::move(updates)]() {
+		commitUpdates(updates);
+	};
 }
 
-void WindowDirEntry::propertyChanged(
+CommitFunction WindowDirEntry::prepareUpdate(
 		const xpp::AtomID changed_atom,
 		const bool is_delete) {
+	{
+		cosmos::MutexGuard g{m_prop_cache_lock};
+
+		// only the changed atom needs to be looked at again when
+		// rendering the properties file next time
+		if (m_prop_cache_valid) {
+			if (is_delete) {
+				m_prop_cache.erase(changed_atom);
+			} else {
+				m_prop_cache[changed_atom].reset();
+			}
+		}
+	}
+
 	// do the same for delete and update at the moment
 	// upon delete empty files might remain in the process of updating
 	// them. Removal of those files is a TODO
-	(void)is_delete;
+	std::vector<const EntrySpec*> specs;
 	auto it = m_atom_update_map.find(changed_atom);
 
 	if (it != m_atom_update_map.end()) {
-		update(it->second);
+		specs.push_back(&it->second);
 	}
 
 	for (const auto &spec: m_always_update_specs) {
-		update(spec);
+		specs.push_back(&spec);
+	}
+
+	// fire all requests at once, then render the results
+	PendingUpdates updates;
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+	bool requested = false;
+
+	for (const auto spec: specs) {
+		if (!isLazy(*spec)) {
+			requestSpec(fetcher, m_win.id(), *spec);
+			requested = true;
+		}
+	}
+
+	if (!m_lazy && !is_delete) {
+		// for the properties file
+		fetcher.requestProperty(m_win.id(), changed_atom);
 	}
+
+	if (requested) {
+		fetcher.collect();
+	}
+
+	for (const auto spec: specs) {
+		if (isLazy(*spec)) {
+			// only fetch the new value once somebody is interested in it
+			updates.push_back(PendingUpdate{spec, std::nullopt});
+		} else {
+			updates.push_back(PendingUpdate{spec, render(*spec, fetcher)});
+		}
+	}
+
+	return [this, updates = std::move(updates)]() {
+		commitUpdates(updates);
+	};
 }
 
-void WindowDirEntry::update(const EntrySpec &spec) {
-	updateModifyTime();
-	const auto entry = this->getFileEntry(spec.name);
+void WindowDirEntry::commitUpdates(const PendingUpdates &updates) {
+	if (updates.empty())
+		return;
 
-	// the property was not available during window creation but now here
-	// it is
-	if (!entry) {
-		addSpecEntry(spec);
+	std::vector<const PendingUpdate*> added;
+	std::vector<const PendingUpdate*> changed;
+
+	// the property was not available during window creation but now
+	// here it is. Changing the structure must not happen while holding
+	// m_lock, thus add these entries up front, along with their content.
+	for (const auto &update: updates) {
+		const auto &[spec, content] = update;
+
+		if (!this->getFileEntry(spec->name) && (isLazy(*spec) || content)) {
+			addSpecEntry(*spec, content);
+			added.push_back(&update);
+		}
+	}
+
+	{
+		cosmos::MutexGuard g{m_lock};
+
+		updateModifyTime();
+		// see applyFetched()
+		m_update_seq++;
+
+		for (const auto &update: updates) {
+			const auto &[spec, content] = update;
+			auto entry = static_cast<WindowFileEntry*>(
+				this->getFileEntry(spec->name));
+
+			if (!entry) {
+				// missing without content, nothing to report
+				continue;
+			} else if (std::find(added.begin(), added.end(), &update) != added.end()) {
+				// the content is already in place
+				entry->setModifyTime(m_modify_time);
+			} else if (isLazy(*spec)) {
+				entry->setOutdated();
+				entry->setModifyTime(m_modify_time);
+			} else if (content) {
+				entry->setContent(*content, m_modify_time);
+			} else {
+				xwmfs::logger->error()
+					<< "Error updating property '" << spec->name
+					<< "' of window " << xpp::to_string(m_win.id()) << "\n";
+				entry->setContent("", m_modify_time);
+			}
+
+			changed.push_back(&update);
+		}
+
+		// in the same critical section, so that all lines reflect the
+		// same state
+		allChanged();
+	}
+
+	// the event files take m_lock on their own.
+	for (const auto update: changed) {
+		const auto &[spec, content] = *update;
+
+		if (isLazy(*spec)) {
+			// the new value is unknown at this point
+			forwardEvent(*spec, std::nullopt);
+		} else {
+			forwardEvent(*spec, content ? std::string_view{*content} : std::string_view{});
+		}
+	}
+
+	// window directories are always children of the WindowsRootDir
+	auto &windows = *static_cast<WindowsRootDir*>(parent());
+
+	for (const auto update: changed) {
+		windows.attributeChanged(*this, update->spec->name);
+	}
+}
+
+void WindowDirEntry::materialize(WindowFileEntry &entry) {
+	// this only uses XCB, thus the event lock isn't needed
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+	LazyFetch fetch;
+
+	{
+		cosmos::MutexGuard g{m_lock};
+
+		if (!requestOutdated({&entry}, fetcher, fetch)) {
+			// somebody else was faster
+			return;
+		}
+	}
+
+	// don't hold m_lock during the round trip to the X server
+	fetcher.collect();
+
+	cosmos::MutexGuard g{m_lock};
+	applyFetched(fetch, fetcher);
+}
+
+void WindowDirEntry::materialize(const std::vector<const WindowDirEntry*> &windows,
+		const std::vector<std::string_view> &names) {
+	if (!Options::getInstance().lazyAttrs()) {
 		return;
 	}
 
-	try {
-		entry->str("");
-		(this->*(spec.member_func))(*entry);
-		*entry << '\n';
-	} catch(const std::exception &ex) {
-		xwmfs::logger->error()
-			<< "Error updating property '" << spec.name << "': "
-			<< ex.what() << "\n";
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+	std::vector<std::pair<WindowDirEntry*, LazyFetch>> fetches;
+
+	for (const auto window: windows) {
+		// only the lazily fetched content is modified, like in
+		// WindowFileEntry::materialize()
+		auto dir = const_cast<WindowDirEntry*>(window);
+		std::vector<WindowFileEntry*> entries;
+
+		for (const auto name: names) {
+			if (!isAttribute(name)) {
+				continue;
+			} else if (auto entry = dir->getEntry(name, Entry::Type::REG_FILE); entry) {
+				entries.push_back(static_cast<WindowFileEntry*>(entry));
+			}
+		}
+
+		LazyFetch fetch;
+		cosmos::MutexGuard g{dir->m_lock};
+
+		if (dir->requestOutdated(entries, fetcher, fetch)) {
+			fetches.emplace_back(dir, std::move(fetch));
+		}
+	}
+
+	if (fetches.empty()) {
+		return;
 	}
 
-	entry->setModifyTime(m_modify_time);
+	// a single round trip for all windows, see materialize(WindowFileEntry&)
+	fetcher.collect();
 
-	forwardEvent(spec);
+	for (auto &[dir, fetch]: fetches) {
+		cosmos::MutexGuard g{dir->m_lock};
+		dir->applyFetched(fetch, fetcher);
+	}
+}
+
+bool WindowDirEntry::requestOutdated(const std::vector<WindowFileEntry*> &entries,
+		PropertyFetcher &fetcher, LazyFetch &fetch) {
+	fetch.update_seq = m_update_seq;
+
+	for (const auto entry: entries) {
+		if (!entry->isOutdated()) {
+			continue;
+		} else if (entry == m_all) {
+			// request everything that is missing in a single batch
+			fetch.all = true;
+			fetch.attrs = fetch.attrs || m_geometry->isOutdated() || m_mapped->isOutdated();
+			fetch.parent = fetch.parent || m_parent->isOutdated();
+
+			for (const auto &spec: m_specs) {
+				auto spec_entry = static_cast<WindowFileEntry*>(getFileEntry(spec.name));
+
+				if (spec_entry && spec_entry->isOutdated()) {
+					fetch.specs.push_back({&spec, spec_entry});
+				}
+			}
+		} else if (entry == m_geometry || entry == m_mapped) {
+			fetch.attrs = true;
+		} else if (entry == m_parent) {
+			fetch.parent = true;
+		} else {
+			for (const auto &spec: m_specs) {
+				if (entry->name() == spec.name) {
+					fetch.specs.push_back({&spec, entry});
+					break;
+				}
+			}
+		}
+	}
+
+	// entries can be requested twice via the `all` file
+	std::sort(fetch.specs.begin(), fetch.specs.end());
+	fetch.specs.erase(std::unique(fetch.specs.begin(), fetch.specs.end()), fetch.specs.end());
+
+	for (const auto &[spec, entry]: fetch.specs) {
+		requestSpec(fetcher, m_win.id(), *spec);
+	}
+
+	if (fetch.attrs)
+		fetcher.requestAttrs(m_win.id());
+	if (fetch.parent)
+		fetcher.requestParent(m_win.id());
+
+	return fetch.all || fetch.attrs || fetch.parent || !fetch.specs.empty();
+}
+
+void WindowDirEntry::applyFetched(const LazyFetch &fetch, const PropertyFetcher &fetched) {
+	// if a change has been committed in the meantime then the fetched
+	// data might predate it, keep the entries outdated then.
+	const bool current = fetch.update_seq == m_update_seq;
+
+	if (fetch.attrs) {
+		fetchAttrs(fetched, current);
+	}
+
+	if (fetch.parent && m_parent->isOutdated()) {
+		if (auto parent = fetched.findParent(m_win.id()); parent) {
+			m_win.setParent(*parent);
+		} // else window disappeared again?
+
+		updateParent();
+		m_parent->setOutdated(!current);
+	}
+
+	for (auto [spec, entry]: fetch.specs) {
+		if (!entry->isOutdated()) {
+			// an event provided newer content meanwhile
+			continue;
+		}
+
+		// if the property is not (yet) set on the window, then this
+		// simply results in an empty file
+		entry->setContent(render(*spec, fetched).value_or(""));
+		entry->setOutdated(!current);
+	}
+
+	if (fetch.all && m_all->isOutdated()) {
+		updateAll();
+		m_all->setOutdated(!current);
+	}
+}
+
+void WindowDirEntry::updateAll() {
+	EpochGuard guard;
+	std::string content;
+
+	for (const auto name: attributeNames()) {
+		if (auto value = attribute(name); value) {
+			content += name;
+			content += '=';
+			append_escaped(content, *value);
+			content += '\n';
+		}
+	}
+
+	m_all->setContent(content, m_modify_time);
+	m_all->setOutdated(false);
+}
+
+void WindowDirEntry::allChanged() {
+	m_update_seq++;
+
+	if (m_lazy) {
+		m_all->setOutdated();
+		m_all->setModifyTime(m_modify_time);
+	} else {
+		updateAll();
+	}
 }
 
 void WindowDirEntry::newMappedState(const bool mapped) {
-	m_mapped->str("");
-	*m_mapped << (mapped ? "1" : "0") << "\n";
+	{
+		cosmos::MutexGuard g{m_lock};
+		updateMapped(mapped);
+		allChanged();
+	}
 
-	m_events->addEvent("mapped");
+	reportEvent(MAPPED_EVENT, *m_mapped);
+}
+
+void WindowDirEntry::updateMapped(const bool mapped) {
+	m_mapped->setContent(mapped ? "1\n" : "0\n");
+	m_mapped->setOutdated(false);
 }
 
 void WindowDirEntry::newGeometry(const xpp::ConfigureEvent &event) {
-	xpp::XWindowAttrs attrs;
+	PropertyFetcher::Attrs attrs;
 	const auto spec = event.spec();
 	attrs.x = spec.x;
 	attrs.y = spec.y;
 	attrs.width = spec.width;
 	attrs.height = spec.height;
-	updateGeometry(attrs);
-	m_events->addEvent("geometry");
+
+	{
+		cosmos::MutexGuard g{m_lock};
+		updateGeometry(attrs);
+		allChanged();
+	}
+
+	reportEvent(GEOMETRY_EVENT, *m_geometry);
 }
 
-void WindowDirEntry::forwardEvent(const EntrySpec &changed_entry) {
-	m_events->addEvent(changed_entry.name);
+void WindowDirEntry::forwardEvent(const EntrySpec &changed_entry, const std::optional<std::string_view> value) {
+	reportEvent(changed_entry.event, value);
 }
 
-void WindowDirEntry::updateWindowName(FileEntry &entry) {
-	entry << m_win.getName();
+void WindowDirEntry::reportEvent(const EventKind kind, const std::optional<std::string_view> value) {
+	EpochGuard guard;
+	auto &fs = Xwmfs::getInstance();
+	auto info = eventInfo();
+	m_events->addEvent(kind, info);
+	// the global files need to tell the windows apart
+	info.show_window = true;
+	fs.getEvents().addEvent(kind, info);
+	info.value = value;
+	fs.getChanges().addEvent(kind, info);
 }
 
-void WindowDirEntry::updateDesktop(FileEntry &entry) {
-	entry << m_win.getDesktop();
+void WindowDirEntry::reportEvent(const EventKind kind, const FileEntry &changed) {
+	// the content view needs to stay valid until it has been copied
+	EpochGuard guard;
+	reportEvent(kind, changed.contentView());
 }
 
-void WindowDirEntry::updateId(FileEntry &entry) {
-	entry << xpp::to_string(m_win.id());
+EventInfo WindowDirEntry::eventInfo() const {
+	return EventInfo{
+		static_cast<uint32_t>(m_win.id()),
+		false,
+		windowClasses(),
+		Xwmfs::getEventOrigin(), {}
+	};
 }
 
-void WindowDirEntry::updatePID(FileEntry &entry) {
-	entry << cosmos::to_integral(m_win.getPID());
+std::string_view WindowDirEntry::windowClasses() const {
+	if (auto entry = getEntry("class", Entry::Type::REG_FILE); entry) {
+		return static_cast<const FileEntry*>(entry)->contentView();
+	}
+
+	return {};
 }
 
-void WindowDirEntry::updateCommand(FileEntry &entry) {
-	entry << m_win.getCommand();
+const std::vector<std::string_view>& WindowDirEntry::attributeNames() {
+	static const auto names = []() {
+		std::vector<std::string_view> ret;
+
+		for (const auto &spec: getSpecVector()) {
+			// this is a command interface, not window information
+			if (std::string_view{spec.name} != "control") {
+				ret.push_back(spec.name);
+			}
+		}
+
+		for (const auto name: {"mapped", "geometry", "parent"}) {
+			ret.push_back(name);
+		}
+
+		return ret;
+	}();
+
+	return names;
 }
 
-void WindowDirEntry::updateLocale(FileEntry &entry) {
-	entry << m_win.getLocale();
+bool WindowDirEntry::isAttribute(const std::string_view name) {
+	const auto &names = attributeNames();
+	return std::find(names.begin(), names.end(), name) != names.end();
 }
 
-void WindowDirEntry::updateProtocols(FileEntry &entry) {
-	xpp::AtomIDVector prots;
+std::optional<std::string_view> WindowDirEntry::attribute(const std::string_view name) const {
+	if (!isAttribute(name)) {
+		return std::nullopt;
+	}
+
+	auto entry = getEntry(name, Entry::Type::REG_FILE);
 
-	m_win.getProtocols(prots);
+	if (!entry) {
+		return std::nullopt;
+	}
+
+	auto content = static_cast<const FileEntry*>(entry)->contentView();
+
+	if (content.ends_with('\n')) {
+		content.remove_suffix(1);
+	}
+
+	return content;
+}
+
+void WindowDirEntry::updateWindowName(std::ostream &out, const PropertyFetcher &fetched) {
+	// prefer the UTF8 name, if available
+	if (auto name = fetched.findProperty(m_win.id(), xpp::atoms::ewmh_window_name); name) {
+		out << name->asString();
+		return;
+	}
+
+	out << fetched.getProperty(m_win.id(), xpp::atoms::icccm_window_name).asString();
+}
+
+void WindowDirEntry::updateDesktop(std::ostream &out, const PropertyFetcher &fetched) {
+	const auto &value = fetched.getProperty(m_win.id(), xpp::atoms::ewmh_desktop_nr);
+	out << static_cast<int>(value.asNumber());
+}
+
+void WindowDirEntry::updateId(std::ostream &out, const PropertyFetcher&) {
+	out << xpp::to_string(m_win.id());
+}
 
+void WindowDirEntry::updatePID(std::ostream &out, const PropertyFetcher &fetched) {
+	const auto &value = fetched.getProperty(m_win.id(), xpp::atoms::ewmh_wm_pid);
+	out << static_cast<int>(value.asNumber());
+}
+
+void WindowDirEntry::updateCommand(std::ostream &out, const PropertyFetcher &fetched) {
+	const auto &value = fetched.getProperty(m_win.id(), xpp::atoms::icccm_wm_command);
 	bool first = true;
 
-	for (const auto &atom: prots) {
-		entry << (first ? "" : "\n") << xpp::atom_mapper.mapName(atom);
+	// the command line arguments are stored as a list of strings
+	for (const auto &arg: value.asStringList()) {
+		out << (first ? "" : " ") << arg;
 		first = false;
 	}
 }
 
-void WindowDirEntry::updateClientLeader(FileEntry &entry) {
-	auto leader = m_win.getClientLeader();
+void WindowDirEntry::updateLocale(std::ostream &out, const PropertyFetcher &fetched) {
+	out << fetched.getProperty(m_win.id(), xpp::atoms::icccm_wm_locale).asString();
+}
 
-	entry << xpp::to_string(leader);
+void WindowDirEntry::updateProtocols(std::ostream &out, const PropertyFetcher &fetched) {
+	const auto &value = fetched.getProperty(m_win.id(), xpp::atoms::icccm_wm_protocols);
+
+	bool first = true;
+
+	for (const auto atom: value.asNumbers()) {
+		out << (first ? "" : "\n") << fetched.atomName(xpp::AtomID{atom});
+		first = false;
+	}
 }
 
-void WindowDirEntry::updateWindowType(FileEntry &entry) {
-	const auto _type = m_win.getWindowType();
+void WindowDirEntry::updateClientLeader(std::ostream &out, const PropertyFetcher &fetched) {
+	const auto &value = fetched.getProperty(m_win.id(), xpp::atoms::icccm_wm_client_leader);
 
-	entry << xpp::atom_mapper.mapName(_type);
+	out << xpp::to_string(xpp::WinID{value.asNumber()});
 }
 
-void WindowDirEntry::updateGeometry(const xpp::XWindowAttrs &attrs) {
-	m_geometry->str("");
-	*m_geometry << attrs.x << "," << attrs.y
+void WindowDirEntry::updateWindowType(std::ostream &out, const PropertyFetcher &fetched) {
+	const auto &value = fetched.getProperty(m_win.id(), xpp::atoms::ewmh_wm_window_type);
+
+	out << fetched.atomName(xpp::AtomID{value.asNumber()});
+}
+
+void WindowDirEntry::updateGeometry(const PropertyFetcher::Attrs &attrs) {
+	std::stringstream ss;
+	ss << attrs.x << "," << attrs.y
 		<< ":" << attrs.width << "x" << attrs.height << "\n";
+	m_geometry->setContent(ss.str());
+	m_geometry->setOutdated(false);
 }
 
-void WindowDirEntry::updateCommandControl(FileEntry &entry) {
-	entry << getCommandInfo();
+void WindowDirEntry::updateCommandControl(std::ostream &out, const PropertyFetcher&) {
+	out << getCommandInfo();
 }
 
-void WindowDirEntry::updateClientMachine(FileEntry &entry) {
-	entry << m_win.getClientMachine();
+void WindowDirEntry::updateClientMachine(std::ostream &out, const PropertyFetcher &fetched) {
+	out << fetched.getProperty(m_win.id(), xpp::AtomID{XA_WM_CLIENT_MACHINE}).asString();
 }
 
 namespace {
 
-void getPropertyValue(const xpp::XWindow &win, const xpp::AtomID prop_atom,
-		const xpp::XWindow::PropertyInfo &info,
+void getPropertyValue(const PropertyFetcher &fetched,
+		const PropertyFetcher::Value &prop,
 		std::stringstream &value) {
-	/*
-	 * this code could be more compact via templates but would then also
-	 * be more complex ...
-	 */
 	using Atom = xpp::AtomID;
 
-	switch (info.type) {
+	switch (prop.type()) {
 	case Atom::ATOM: {
-		xpp::Property<std::vector<xpp::AtomID>> prop;
-		win.getProperty(prop_atom, prop, &info);
 		int i = 0;
-		for (const auto &val: prop.get()) {
-			const auto &name = xpp::atom_mapper.mapName(val);
+		for (const auto val: prop.asNumbers()) {
+			const auto &name = fetched.atomName(xpp::AtomID{val});
 			if (i++)
 				value << " ";
 			value << name;
@@ -313,36 +796,26 @@ void getPropertyValue(const xpp::XWindow &win, const xpp::AtomID prop_atom,
 		break;
 	}
 	case Atom::CARDINAL: {
-		if (info.items == 1) {
-			xpp::Property<int> prop;
-			win.getProperty(prop_atom, prop, &info);
-			value << prop.get();
+		if (prop.items() == 1) {
+			value << static_cast<int>(prop.asNumber());
 		} else {
-			xpp::Property<std::vector<int>> prop;
-			win.getProperty(prop_atom, prop, &info);
-			for (const auto &val: prop.get()) {
-				value << val << " ";
+			for (const auto val: prop.asNumbers()) {
+				value << static_cast<int>(val) << " ";
 			}
 		}
 		break;
 	}
 	case Atom::STRING: {
-		xpp::Property<const char*> prop;
-		win.getProperty(prop_atom, prop, &info);
-		value << prop.get();
+		value << prop.asString();
 		break;
 	}
 	case Atom::WINDOW: {
-		xpp::Property<xpp::WinID> prop;
-		win.getProperty(prop_atom, prop, &info);
-		value << xpp::to_string(prop.get());
+		value << xpp::to_string(xpp::WinID{prop.asNumber()});
 		break;
 	}
 	default: {
-		if (info.type == xpp::atoms::ewmh_utf8_string) {
-			xpp::Property<xpp::utf8_string> prop;
-			win.getProperty(prop_atom, prop, &info);
-			value << prop.get().str;
+		if (prop.type() == xpp::atoms::ewmh_utf8_string) {
+			value << prop.asString();
 		} else {
 			// some unknown property type, display as hex
 			// TODO
@@ -355,76 +828,184 @@ void getPropertyValue(const xpp::XWindow &win, const xpp::AtomID prop_atom,
 
 } // end anon ns
 
-void WindowDirEntry::updateProperties(FileEntry &entry) {
-	xpp::AtomIDVector atoms;
-	m_win.getPropertyList(atoms);
-
-	xpp::XWindow::PropertyInfo info;
-
-	for (const auto atom: atoms) {
-		m_win.getPropertyInfo(atom, info);
-		const auto &prop_name = xpp::atom_mapper.mapName(atom);
-		const auto &prop_type = xpp::atom_mapper.mapName(info.type);
-
-		logger->debug()
-			<< "Querying property " << cosmos::to_integral(atom)
-			<< " on window " << xpp::to_string(m_win) << "\n";
-		logger->debug()
-			<< "type = " << cosmos::to_integral(info.type)
-			<< ", items = " << info.items
-			<< ", format = " << info.format << "\n";
-
-		entry << prop_name << "(" << prop_type << ") = ";
-
-		try {
-			getPropertyValue(m_win, atom, info, entry);
-		} catch (const std::exception &ex) {
-			logger->error()
-				<< "Error getting property value for "
-				<< xpp::to_string(m_win.id()) << "/"
-				<< cosmos::to_integral(atom)
-				<< ": " << ex.what() << std::endl;
-			entry << "<error>";
+void WindowDirEntry::updateProperties(std::ostream &out, const PropertyFetcher &fetched) {
+	cosmos::MutexGuard g{m_prop_cache_lock};
+	// only used if `fetched` lacks data we need
+	std::optional<PropertyFetcher> extra;
+
+	auto getExtraFetcher = [&extra]() -> PropertyFetcher& {
+		if (!extra) {
+			extra.emplace(Xwmfs::getInstance().getDisplay());
 		}
+		return *extra;
+	};
 
-		entry << "\n";
+	if (!m_prop_cache_valid) {
+		auto atoms = fetched.findPropertyList(m_win.id());
+
+		if (!atoms) {
+			auto &fetcher = getExtraFetcher();
+			fetcher.requestPropertyList(m_win.id(),
+					PropertyFetcher::WithValues{true});
+			fetcher.collect();
+			atoms = fetcher.findPropertyList(m_win.id());
+
+			if (!atoms) {
+				throw Exception{"failed to get window property list"};
+			}
+		}
+
+		m_prop_cache.clear();
+
+		for (const auto atom: *atoms) {
+			// will be rendered below
+			m_prop_cache[atom].reset();
+		}
+
+		m_prop_cache_valid = true;
 	}
-}
 
-void WindowDirEntry::updateClass(FileEntry &entry) {
-	const auto &class_pair = m_win.getClass();
-	entry << class_pair.first << "\n" << class_pair.second;
+	// request any property values not already obtained in one go
+	for (const auto &[atom, line]: m_prop_cache) {
+		if (!line && !fetched.hasProperty(m_win.id(), atom) &&
+				!(extra && extra->hasProperty(m_win.id(), atom))) {
+			getExtraFetcher().requestProperty(m_win.id(), atom);
+		}
+	}
+
+	if (extra) {
+		extra->collect();
+	}
+
+	auto it = m_prop_cache.begin();
+
+	while (it != m_prop_cache.end()) {
+		auto &[atom, line] = *it;
+
+		if (!line) {
+			auto value = fetched.hasProperty(m_win.id(), atom) ?
+				fetched.findProperty(m_win.id(), atom) :
+				extra->findProperty(m_win.id(), atom);
+
+			if (!value) {
+				// the property vanished in the meantime
+				logger->debug()
+					<< "Property " << cosmos::to_integral(atom)
+					<< " on window " << xpp::to_string(m_win)
+					<< " is no longer available\n";
+				it = m_prop_cache.erase(it);
+				continue;
+			}
+
+			line = renderPropertyLine(atom, *value, fetched);
+		}
+
+		out << *line;
+		it++;
+	}
 }
 
-void WindowDirEntry::queryAttrs() {
-	xpp::XWindowAttrs attrs;
-	try {
-		m_win.getAttrs(attrs);
+std::string WindowDirEntry::renderPropertyLine(const xpp::AtomID atom,
+		const PropertyFetcher::Value &value,
+		const PropertyFetcher &fetched) {
+	std::stringstream line;
 
-		newMappedState(attrs.isMapped());
+	logger->debug()
+		<< "Rendering property " << cosmos::to_integral(atom)
+		<< " on window " << xpp::to_string(m_win) << "\n";
+	logger->debug()
+		<< "type = " << cosmos::to_integral(value.type())
+		<< ", items = " << value.items()
+		<< ", format = " << value.format() << "\n";
+
+	try {
+		line << fetched.atomName(atom) << "("
+			<< fetched.atomName(value.type()) << ") = ";
+		getPropertyValue(fetched, value, line);
 	} catch (const std::exception &ex) {
+		logger->error()
+			<< "Error getting property value for "
+			<< xpp::to_string(m_win.id()) << "/"
+			<< cosmos::to_integral(atom)
+			<< ": " << ex.what() << std::endl;
+		line << "<error>";
+	}
+
+	line << "\n";
+
+	return line.str();
+}
+
+void WindowDirEntry::updateClass(std::ostream &out, const PropertyFetcher &fetched) {
+	const auto &value = fetched.getProperty(m_win.id(), xpp::atoms::icccm_wm_class);
+	const auto parts = value.asStringList();
+
+	if (parts.size() != 2) {
+		throw Exception{"invalid WM_CLASS property"};
+	}
+
+	out << parts[0] << "\n" << parts[1];
+}
+
+void WindowDirEntry::queryAttrs(const PropertyFetcher &fetched) {
+	if (auto attrs = fetched.findAttrs(m_win.id()); attrs) {
+		newMappedState(attrs->mapped);
+	} else {
 		xwmfs::logger->error()
 			<< "Error getting window attrs for "
-			<< xpp::to_string(m_win.id()) << ": " << ex.what()
-			<< "\n";
+			<< xpp::to_string(m_win.id()) << "\n";
 		setDefaultAttrs();
 	}
 }
 
+void WindowDirEntry::fetchAttrs(const PropertyFetcher &fetched, const bool current) {
+	auto attrs = fetched.findAttrs(m_win.id());
+
+	if (!attrs) {
+		xwmfs::logger->error()
+			<< "Error getting window attrs for "
+			<< xpp::to_string(m_win.id()) << "\n";
+		// don't retry on every access, the next change
+		// notification will mark them outdated again
+		m_geometry->setOutdated(false);
+
+		if (m_mapped->isOutdated()) {
+			setDefaultAttrs();
+		}
+		return;
+	}
+
+	// entries updated by events meanwhile carry newer information
+	if (m_geometry->isOutdated()) {
+		updateGeometry(*attrs);
+		m_geometry->setOutdated(!current);
+	}
+
+	if (m_mapped->isOutdated()) {
+		updateMapped(attrs->mapped);
+		m_mapped->setOutdated(!current);
+	}
+}
+
 void WindowDirEntry::setDefaultAttrs() {
-	*m_mapped << "0\n";
+	updateMapped(false);
 }
 
 void WindowDirEntry::updateParent() {
-	m_parent->str("");
-	*m_parent << xpp::to_string(m_win.getParent()) << "\n";
+	m_parent->setContent(xpp::to_string(m_win.getParent()) + "\n");
+	m_parent->setOutdated(false);
 }
 
 void WindowDirEntry::newParent(const xpp::XWindow &win) {
-	m_events->addEvent("parent");
-	m_win.setParent(win);
+	{
+		cosmos::MutexGuard g{m_lock};
+		m_win.setParent(win);
 
-	updateParent();
+		updateParent();
+		allChanged();
+	}
+
+	reportEvent(PARENT_EVENT, *m_parent);
 }
 
 } // end ns
@@ -1,15 +1,28 @@
 #pragma once
 
+// C++
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 // libxpp
 #include <xpp/fwd.hxx>
 #include <xpp/XWindow.hxx>
 
+// cosmos
+#include <cosmos/thread/Mutex.hxx>
+
 // xwmfs
+#include "fuse/EventFile.hxx"
 #include "main/UpdatableDir.hxx"
+#include "x11/PropertyFetcher.hxx"
 
 namespace xwmfs {
 
-class EventFile;
 class WindowFileEntry;
 
 /// A specialized DirEntry for window directories.
@@ -23,25 +36,70 @@ public: // functions
 
 	/// Create a new window dir entry.
 	/**
+	 * The window's data is taken from `fetched`, which needs to be
+	 * prepared via requestInitialData(). If lazy attribute handling is
+	 * enabled in Options::lazyAttrs() then only the specs for which
+	 * isEagerSpec() returns true are requested and all other attribute
+	 * files will be fetched upon first access instead, see
+	 * materialize().
+	 *
 	 * \param[in] query_attrs
 	 * 	Query some window parameters actively during construction
 	 * 	instead of waiting for update events
 	 **/
-	explicit WindowDirEntry(const xpp::XWindow &win,
+	WindowDirEntry(const xpp::XWindow &win,
+			const PropertyFetcher &fetched,
 			const bool query_attrs = false);
 
-	/// Update window data denoted by `changed_atom`.
-	void update(const xpp::AtomID changed_atom) {
-		propertyChanged(changed_atom, false);
-	}
+	/// Requests all data needed for constructing a WindowDirEntry for `win`.
+	/**
+	 * This can be called for any number of windows on the same
+	 * `fetcher`, to obtain their data in a single batch.
+	 **/
+	static void requestInitialData(PropertyFetcher &fetcher, const xpp::WinID win);
 
-	void update(const EntrySpec &spec);
+	/// Returns the window represented by this directory.
+	const xpp::XWindow& window() const { return m_win; }
 
-	void delProp(const xpp::AtomID deleted_atom) {
-		propertyChanged(deleted_atom, true);
-	}
+	/// Returns the newline separated instance and class name of the window.
+	/**
+	 * This is the content of the "class" file, or an empty view if it
+	 * isn't available. The view is only valid while the caller holds an
+	 * EpochGuard.
+	 **/
+	std::string_view windowClasses() const;
+
+	/// Returns the names of all attribute files of window directories.
+	/**
+	 * Attributes are the regular files carrying window information,
+	 * control files, the events file and the aggregated `all` file don't
+	 * count.
+	 **/
+	static const std::vector<std::string_view>& attributeNames();
+
+	/// Returns whether `name` denotes an attribute file of window directories.
+	static bool isAttribute(const std::string_view name);
 
-	void delProp(const EntrySpec &spec);
+	/// Returns the content of the attribute file `name` without the trailing newline.
+	/**
+	 * If `name` is no attribute or the window doesn't carry it then
+	 * std::nullopt is returned. The view is only valid while the caller
+	 * holds an EpochGuard.
+	 **/
+	std::optional<std::string_view> attribute(const std::string_view name) const;
+
+	/// Prepares an update of the window data denoted by `changed_atom`.
+	/**
+	 * This is the fetch phase of a property change, it performs any
+	 * X requests necessary to obtain the new data. It needs to be called
+	 * without holding any directory locks. The returned function puts
+	 * the new data into place.
+	 *
+	 * \param[in] is_delete
+	 * 	Whether the property has been deleted from the window.
+	 **/
+	CommitFunction prepareUpdate(const xpp::AtomID changed_atom,
+			const bool is_delete = false);
 
 	/// The window has been (un)mapped.
 	void newMappedState(const bool mapped);
@@ -52,81 +110,229 @@ public: // functions
 	/// The window's parent changed.
 	void newParent(const xpp::XWindow &win);
 
-	/// Updates all information stored in the window directory.
+	/// Prepares an update of all information stored in the window directory.
 	/**
 	 * This is effectively a poll of all information from the X server.
+	 * The same rules as for prepareUpdate() apply.
 	 **/
-	void updateAll();
+	CommitFunction prepareUpdateAll();
+
+	/// Fetches the current content of the outdated `entry` from the X server.
+	/**
+	 * This is called by WindowFileEntry in lazy attribute mode when an
+	 * outdated file is accessed. It is called from FUSE context
+	 * without the directory lock held. Since the data is obtained via
+	 * PropertyFetcher the event lock is not needed for this. The
+	 * directory lock is only held while preparing the request and while
+	 * applying the result, not during the round trip to the X server.
+	 **/
+	void materialize(WindowFileEntry &entry);
+
+	/// Fetches the outdated attribute files `names` of all `windows` in a single batch.
+	/**
+	 * This is for FUSE operations that evaluate attributes of many
+	 * windows at once. It does nothing unless lazy attribute handling
+	 * is enabled. Names that are no attributes are ignored. The caller
+	 * needs to hold an EpochGuard, but no directory or commit locks.
+	 **/
+	static void materialize(const std::vector<const WindowDirEntry*> &windows,
+			const std::vector<std::string_view> &names);
+
+protected: // types
+
+	/// The outdated entries of a window requested in one go, see requestOutdated().
+	struct LazyFetch {
+		/// The value of m_update_seq when the data was requested.
+		uint64_t update_seq = 0;
+		/// Whether geometry and mapped state have been requested.
+		bool attrs = false;
+		/// Whether the parent window has been requested.
+		bool parent = false;
+		/// Whether the `all` file is to be rendered afterwards.
+		bool all = false;
+		/// The requested attribute files and their specs.
+		std::vector<std::pair<const EntrySpec*, WindowFileEntry*>> specs;
+	};
 
 protected: // functions
 
-	void propertyChanged(const xpp::AtomID changed_atom,
-			const bool is_delete);
+	/// Commit phase for the result of prepareUpdate().
+	void commitUpdates(const PendingUpdates &updates);
 
 	/// adds all directory file entries for the represented window
-	void addEntries();
+	void addEntries(const PropertyFetcher &fetched);
 
 	bool markDeleted() override;
 
-	SpecVector getSpecVector() const;
+	static SpecVector getSpecVector();
 
-	void addSpecEntry(const EntrySpec &spec);
+	/// Returns whether `spec` is fetched right away even in lazy mode.
+	/**
+	 * Event filters select windows by their class, thus the `class` file
+	 * needs to be current when events are reported.
+	 **/
+	static bool isEagerSpec(const EntrySpec &spec) {
+		return std::string_view{spec.name} == "class";
+	}
 
-	void forwardEvent(const EntrySpec &changed_entry);
+	/// Returns whether the content for `spec` is only fetched upon access.
+	bool isLazy(const EntrySpec &spec) const {
+		return m_lazy && !isEagerSpec(spec);
+	}
+
+	/// Adds a new file entry for the given spec.
+	/**
+	 * If `content` is not set then the entry is marked outdated, to be
+	 * fetched upon first access. Must not be called with m_lock held.
+	 **/
+	WindowFileEntry* addSpecEntry(const EntrySpec &spec,
+			const std::optional<std::string> &content);
+
+	/// Reports the change of `changed_entry` to `value`.
+	void forwardEvent(const EntrySpec &changed_entry, const std::optional<std::string_view> value);
+
+	/// Reports the change of the attribute `kind` to `value`.
+	/**
+	 * The event goes to our own events file and the global one, the new
+	 * `value` additionally goes to the global changes file. If `value`
+	 * isn't known then it's left out there.
+	 **/
+	void reportEvent(const EventKind kind, const std::optional<std::string_view> value);
+
+	/// Reports the change of the attribute `kind` using the current content of `changed`.
+	void reportEvent(const EventKind kind, const FileEntry &changed);
+
+	/// Returns the information for events concerning this window.
+	/**
+	 * The result refers to windowClasses(), thus the caller needs to
+	 * hold an EpochGuard while using it.
+	 **/
+	EventInfo eventInfo() const;
 
 	std::string getCommandInfo();
 
 	/// Adds/updates the window name of the window.
-	void updateWindowName(FileEntry &entry);
+	void updateWindowName(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Adds/updates an entry for the desktop nr. the window is on.
-	void updateDesktop(FileEntry &entry);
+	void updateDesktop(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Adds/updates an entry for the ID for the window.
-	void updateId(FileEntry &entry);
+	void updateId(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Adds/updates an entry for the PID of the window owner.
-	void updatePID(FileEntry &entry);
+	void updatePID(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Updates an entry for the command line of a window.
-	void updateCommand(FileEntry &entry);
+	void updateCommand(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Updates an entry for the window's locale name.
-	void updateLocale(FileEntry &entry);
+	void updateLocale(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Updates an entry for the window's supported protocols.
-	void updateProtocols(FileEntry &entry);
+	void updateProtocols(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Updates an entry for the window's client leader window.
-	void updateClientLeader(FileEntry &entry);
+	void updateClientLeader(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Updates an entry for the window's type.
-	void updateWindowType(FileEntry &entry);
+	void updateWindowType(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Adds/updates an entry for the command control file of a window.
-	void updateCommandControl(FileEntry &entry);
+	void updateCommandControl(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Adds/updates an entry for the client machine a window is running on.
-	void updateClientMachine(FileEntry &entry);
+	void updateClientMachine(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Adds/updates a list of all properties of the window.
-	void updateProperties(FileEntry &entry);
+	/**
+	 * This renders the content from m_prop_cache. Only property values
+	 * that have changed since the last call are rendered again. Values
+	 * missing from `fetched` are obtained via an additional
+	 * PropertyFetcher batch.
+	 **/
+	void updateProperties(std::ostream &out, const PropertyFetcher &fetched);
+
+	/// Renders the `properties` file line for the given property value.
+	std::string renderPropertyLine(const xpp::AtomID atom,
+			const PropertyFetcher::Value &value,
+			const PropertyFetcher &fetched);
 
 	/// Adds/updates the window instance and class name.
-	void updateClass(FileEntry &entry);
+	void updateClass(std::ostream &out, const PropertyFetcher &fetched);
 
 	/// Adds an entry for the ID of the parent window.
+	/**
+	 * This and the other update functions for the special entries below
+	 * need to be called with m_lock held, unless the directory is not
+	 * yet part of the file system.
+	 **/
 	void updateParent();
 
 	/// Updates the geometry entry according to \c attrs.
-	void updateGeometry(const xpp::XWindowAttrs &attrs);
+	void updateGeometry(const PropertyFetcher::Attrs &attrs);
+
+	/// Updates the mapped entry according to `mapped`.
+	void updateMapped(const bool mapped);
+
+	/// Updates outdated geometry and mapped state from `fetched`.
+	/**
+	 * If `current` is not set then the entries stay outdated, see
+	 * applyFetched().
+	 **/
+	void fetchAttrs(const PropertyFetcher &fetched, const bool current);
+
+	/// Requests the data for the outdated entries among `entries` from `fetcher`.
+	/**
+	 * For the `all` file the data for all outdated attribute files is
+	 * requested. The result is to be passed to applyFetched() once the
+	 * data has been collected. Must be called with m_lock held.
+	 *
+	 * \return
+	 * 	`false` if none of `entries` is outdated.
+	 **/
+	bool requestOutdated(const std::vector<WindowFileEntry*> &entries,
+			PropertyFetcher &fetcher, LazyFetch &fetch);
+
+	/// Puts the data collected for `fetch` into place.
+	/**
+	 * Entries that have been brought up to date in the meantime are left
+	 * alone. If a change has been committed since the data was requested
+	 * then the data might predate it, the entries are updated but stay
+	 * outdated then. Must be called with m_lock held.
+	 **/
+	void applyFetched(const LazyFetch &fetch, const PropertyFetcher &fetched);
 
 	/// Actively query some attributes.
-	void queryAttrs();
+	void queryAttrs(const PropertyFetcher &fetched);
 
 	/// Set some default attributes.
 	void setDefaultAttrs();
 
+	/// Renders the `all` file from the current content of the attribute files.
+	/**
+	 * Must be called with m_lock held, unless the directory is not yet
+	 * part of the file system.
+	 **/
+	void updateAll();
+
+	/// Brings the `all` file up to date after attribute files changed.
+	/**
+	 * In lazy mode the file is only marked outdated, since attribute
+	 * files may be outdated themselves. The same locking rules as for
+	 * updateAll() apply.
+	 **/
+	void allChanged();
+
+protected: // types
+
+	/// A mapping of property atoms to their rendered `properties` file lines.
+	/**
+	 * An empty optional value means that the property's value needs to
+	 * be fetched again.
+	 **/
+	using PropertyCache = std::map<xpp::AtomID, std::optional<std::string>>;
+
 protected: // data
 
 	/// The window we're representing with this directory.
@@ -140,6 +346,26 @@ protected: // data
 	WindowFileEntry *m_parent = nullptr;
 	/// Contains the geometry of this window.
 	WindowFileEntry *m_geometry = nullptr;
+	/// Contains all attributes of this window in `key=value` lines.
+	WindowFileEntry *m_all = nullptr;
+	/// Whether attributes are only fetched upon access, see Options::lazyAttrs().
+	const bool m_lazy;
+	/// Incremented with m_lock held whenever the event thread changes attribute files.
+	/**
+	 * This allows to detect changes committed while lazily fetched data
+	 * was in flight, see applyFetched().
+	 **/
+	uint64_t m_update_seq = 0;
+	/// Cached content of the `properties` file.
+	PropertyCache m_prop_cache;
+	/// Whether m_prop_cache has been populated with the window's property list.
+	bool m_prop_cache_valid = false;
+	/// Protects m_prop_cache and m_prop_cache_valid.
+	/**
+	 * The cache is invalidated from the event thread and rendered from
+	 * the event thread or from FUSE context in lazy mode.
+	 **/
+	cosmos::Mutex m_prop_cache_lock;
 };
 
 } // end ns
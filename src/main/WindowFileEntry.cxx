@@ -14,6 +14,7 @@
 // xwmfs
 #include "main/Exception.hxx"
 #include "main/logger.hxx"
+#include "main/WindowDirEntry.hxx"
 #include "main/WindowFileEntry.hxx"
 #include "main/Xwmfs.hxx"
 
@@ -182,6 +183,27 @@ Entry::Bytes WindowFileEntry::write(OpenContext *ctx,
 	return Bytes{static_cast<int>(bytes)};
 }
 
+void WindowFileEntry::materialize() const {
+	if (!m_outdated) {
+		return;
+	}
+
+	// window files are always children of a WindowDirEntry
+	auto &win_dir = *static_cast<WindowDirEntry*>(m_parent);
+	win_dir.materialize(const_cast<WindowFileEntry&>(*this));
+}
+
+Entry::Bytes WindowFileEntry::read(OpenContext *ctx,
+		char *buf, size_t size, off_t offset) {
+	materialize();
+	return FileEntry::read(ctx, buf, size, offset);
+}
+
+void WindowFileEntry::getStat(struct stat *s) const {
+	materialize();
+	FileEntry::getStat(s);
+}
+
 void WindowFileEntry::writeDesktop(const char *data, const size_t bytes) {
 	int the_num;
 	try {
@@ -1,5 +1,8 @@
 #pragma once
 
+// C++
+#include <atomic>
+
 // libxpp
 #include <xpp/XWindow.hxx>
 
@@ -30,6 +33,21 @@ public:
 	Bytes write(OpenContext *ctx, const char *data,
 			const size_t bytes, off_t offset) override;
 
+	Bytes read(OpenContext *ctx, char *buf, size_t size, off_t offset) override;
+
+	void getStat(struct stat *s) const override;
+
+	/// Marks the file content as outdated or up to date.
+	/**
+	 * An outdated file will query its content from the X server upon the
+	 * next getStat() or read(). This is used for lazy attribute
+	 * handling, see Options::lazyAttrs().
+	 **/
+	void setOutdated(const bool outdated = true) { m_outdated = outdated; }
+
+	/// Returns whether the file content needs to be fetched before access.
+	bool isOutdated() const { return m_outdated; }
+
 	void writeName(const char *data, const size_t bytes) {
 		std::string name(data, bytes);
 		m_win.setName(name);
@@ -58,10 +76,22 @@ public:
 	/// Casts the object to its associated XWindow type.
 	operator xpp::XWindow&() { return m_win; }
 
+protected: // functions
+
+	/// Fetches the file content via the parent WindowDirEntry, if outdated.
+	void materialize() const;
+
 protected: // data
 
 	/// XWindow associated with this FileEntry
 	xpp::XWindow m_win;
+
+	/// Whether the content is stale and needs to be fetched before access.
+	/**
+	 * This is atomic to allow a cheap check without holding the parent's
+	 * lock in the common case of up to date content.
+	 **/
+	std::atomic_bool m_outdated = false;
 };
 
 } // end ns
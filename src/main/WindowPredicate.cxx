@@ -0,0 +1,135 @@
+// C++
+#include <algorithm>
+
+// xwmfs
+#include "main/AttrIndexDir.hxx"
+#include "main/WindowDirEntry.hxx"
+#include "main/WindowPredicate.hxx"
+#include "main/WindowsRootDir.hxx"
+
+namespace xwmfs {
+
+bool WindowPredicate::addTerm(const std::string_view word) {
+	const auto sep = word.find_first_of("=~");
+
+	if (sep == word.npos) {
+		return false;
+	}
+
+	const auto attr = word.substr(0, sep);
+
+	if (!WindowDirEntry::isAttribute(attr)) {
+		return false;
+	}
+
+	m_terms.emplace_back(Term{
+		std::string{attr},
+		std::string{word.substr(sep + 1)},
+		word[sep] == '~'
+	});
+
+	return true;
+}
+
+std::vector<std::string_view> WindowPredicate::parse(const std::string_view spec) {
+	constexpr std::string_view SPACE{" \t\r\n"};
+	std::vector<std::string_view> unknown;
+	size_t pos = 0;
+
+	while ((pos = spec.find_first_not_of(SPACE, pos)) != spec.npos) {
+		const auto end = spec.find_first_of(SPACE, pos);
+		const auto word = spec.substr(pos, end == spec.npos ? end : end - pos);
+		pos = end;
+
+		if (!addTerm(word)) {
+			unknown.push_back(word);
+		}
+	}
+
+	return unknown;
+}
+
+std::vector<std::string_view> WindowPredicate::attributes() const {
+	std::vector<std::string_view> ret;
+
+	for (const auto &term: m_terms) {
+		ret.push_back(term.attr);
+	}
+
+	return ret;
+}
+
+bool WindowPredicate::matches(const Term &term, const std::string_view value) {
+	if (term.contains) {
+		return value.find(term.value) != value.npos;
+	}
+
+	auto rest = value;
+
+	while (true) {
+		const auto end = rest.find('\n');
+
+		if (rest.substr(0, end) == term.value) {
+			return true;
+		} else if (end == rest.npos) {
+			return false;
+		}
+
+		rest.remove_prefix(end + 1);
+	}
+}
+
+bool WindowPredicate::matches(const WindowDirEntry &win) const {
+	for (const auto &term: m_terms) {
+		const auto value = win.attribute(term.attr);
+
+		if (!value || !matches(term, *value)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::vector<const WindowDirEntry*> WindowPredicate::select(const WindowsRootDir &windows) const {
+	std::vector<const WindowDirEntry*> candidates;
+	bool indexed = false;
+
+	for (const auto &term: m_terms) {
+		if (term.contains)
+			continue;
+
+		const auto index = windows.valueIndex(term.attr);
+
+		if (!index)
+			continue;
+
+		std::vector<std::string_view> names;
+		index->lookup(term.value, names);
+
+		for (const auto name: names) {
+			if (auto win = windows.getEntry(name, Entry::Type::DIRECTORY); win) {
+				candidates.push_back(static_cast<const WindowDirEntry*>(win));
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](auto a, auto b) {
+			return a->window().id() < b->window().id();
+		});
+
+		indexed = true;
+		break;
+	}
+
+	if (!indexed) {
+		candidates = windows.collectWindows();
+	}
+
+	std::erase_if(candidates, [this](auto win) {
+		return !matches(*win);
+	});
+
+	return candidates;
+}
+
+} // end ns
@@ -0,0 +1,84 @@
+#pragma once
+
+// C++
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xwmfs {
+
+class WindowDirEntry;
+class WindowsRootDir;
+
+/// A conjunction of conditions on window attributes.
+/**
+ * Each term has the form "attr=value" or "attr~value". The former matches
+ * if a line of the attribute file content equals `value`, the latter if the
+ * content contains `value` anywhere. For single line attributes like "pid"
+ * or "desktop" "=" thus means plain equality, while "class=xterm" matches
+ * either the instance or the class name of a window. Windows not carrying
+ * the attribute never match. An empty predicate matches all windows.
+ **/
+class WindowPredicate {
+public: // types
+
+	struct Term {
+		std::string attr;
+		std::string value;
+		/// Whether this is a substring match ("~").
+		bool contains = false;
+	};
+
+public: // functions
+
+	/// Adds the term `word` to the predicate.
+	/**
+	 * \return
+	 * 	`false` if `word` is no valid term, in which case the predicate
+	 * 	is left unchanged.
+	 **/
+	bool addTerm(const std::string_view word);
+
+	/// Adds all whitespace separated terms found in `spec` to the predicate.
+	/**
+	 * Words that are no valid terms are not added but returned to the
+	 * caller, which can interpret them on its own or reject them.
+	 **/
+	std::vector<std::string_view> parse(const std::string_view spec);
+
+	bool empty() const { return m_terms.empty(); }
+
+	const std::vector<Term>& terms() const { return m_terms; }
+
+	/// Returns the names of the attributes the terms refer to.
+	/**
+	 * The views refer to the terms and are valid as long as the
+	 * predicate isn't changed.
+	 **/
+	std::vector<std::string_view> attributes() const;
+
+	/// Returns whether `win` satisfies all terms.
+	/**
+	 * The caller needs to hold an EpochGuard for accessing the window.
+	 **/
+	bool matches(const WindowDirEntry &win) const;
+
+	/// Returns all windows below `windows` satisfying the predicate, sorted by window ID.
+	/**
+	 * If an equality term refers to an attribute with a value index, see
+	 * WindowsRootDir::valueIndex(), then only the windows found in the
+	 * index are considered as candidates. The caller needs to hold an
+	 * EpochGuard.
+	 **/
+	std::vector<const WindowDirEntry*> select(const WindowsRootDir &windows) const;
+
+protected: // functions
+
+	static bool matches(const Term &term, const std::string_view value);
+
+protected: // data
+
+	std::vector<Term> m_terms;
+};
+
+} // end ns
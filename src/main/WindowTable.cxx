@@ -0,0 +1,144 @@
+// C++
+#include <cstdio>
+#include <utility>
+
+// xwmfs
+#include "main/WindowDirEntry.hxx"
+#include "main/WindowTable.hxx"
+
+namespace xwmfs {
+
+namespace {
+
+void append_tsv_value(std::string &out, const std::string_view value) {
+	for (const auto ch: value) {
+		switch (ch) {
+		case '\t': out += "\\t"; break;
+		case '\n': out += "\\n"; break;
+		case '\\': out += "\\\\"; break;
+		default: out += ch; break;
+		}
+	}
+}
+
+void append_json_string(std::string &out, const std::string_view value) {
+	out += '"';
+
+	for (const auto ch: value) {
+		switch (ch) {
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\t': out += "\\t"; break;
+		case '\n': out += "\\n"; break;
+		default:
+			if (static_cast<unsigned char>(ch) < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+				out += escaped;
+			} else {
+				out += ch;
+			}
+			break;
+		}
+	}
+
+	out += '"';
+}
+
+} // end anon ns
+
+bool WindowTable::parse(const std::string_view table_spec, WindowTable &table) {
+	auto spec = table_spec;
+	Format format = Format::TSV;
+
+	for (const auto &[suffix, suffix_format]: {
+			std::pair{std::string_view{".tsv"}, Format::TSV},
+			std::pair{std::string_view{".json"}, Format::JSON}}) {
+		if (spec.ends_with(suffix)) {
+			spec.remove_suffix(suffix.size());
+			format = suffix_format;
+			break;
+		}
+	}
+
+	std::vector<std::string> columns;
+
+	while (true) {
+		const auto end = spec.find(',');
+		const auto column = spec.substr(0, end);
+
+		if (!WindowDirEntry::isAttribute(column)) {
+			return false;
+		}
+
+		columns.emplace_back(column);
+
+		if (end == spec.npos) {
+			break;
+		}
+
+		spec.remove_prefix(end + 1);
+	}
+
+	table.m_columns = std::move(columns);
+	table.m_format = format;
+	return true;
+}
+
+void WindowTable::render(const std::vector<const WindowDirEntry*> &windows, std::string &out) const {
+	switch (m_format) {
+	case Format::TSV: renderTSV(windows, out); break;
+	case Format::JSON: renderJSON(windows, out); break;
+	}
+}
+
+void WindowTable::renderTSV(const std::vector<const WindowDirEntry*> &windows, std::string &out) const {
+	for (size_t col = 0; col < m_columns.size(); col++) {
+		if (col != 0)
+			out += '\t';
+		out += m_columns[col];
+	}
+
+	out += '\n';
+
+	for (const auto win: windows) {
+		for (size_t col = 0; col < m_columns.size(); col++) {
+			if (col != 0)
+				out += '\t';
+
+			if (auto value = win->attribute(m_columns[col]); value) {
+				append_tsv_value(out, *value);
+			}
+		}
+
+		out += '\n';
+	}
+}
+
+void WindowTable::renderJSON(const std::vector<const WindowDirEntry*> &windows, std::string &out) const {
+	out += '[';
+
+	for (size_t row = 0; row < windows.size(); row++) {
+		out += row == 0 ? "\n{" : ",\n{";
+
+		for (size_t col = 0; col < m_columns.size(); col++) {
+			if (col != 0)
+				out += ',';
+
+			append_json_string(out, m_columns[col]);
+			out += ':';
+
+			if (auto value = windows[row]->attribute(m_columns[col]); value) {
+				append_json_string(out, *value);
+			} else {
+				out += "null";
+			}
+		}
+
+		out += '}';
+	}
+
+	out += "\n]\n";
+}
+
+} // end ns
@@ -0,0 +1,68 @@
+#pragma once
+
+// C++
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace xwmfs {
+
+class WindowDirEntry;
+
+/// Renders selected attributes of a set of windows as a table.
+/**
+ * The columns are names of window attribute files, see
+ * WindowDirEntry::isAttribute(). The table is rendered either as tab
+ * separated values with a header line, or as a JSON array containing one
+ * object per window.
+ *
+ * In TSV format tabs, newlines and backslashes contained in attribute values
+ * are escaped as "\t", "\n" and "\\". Attributes a window doesn't carry are
+ * rendered as empty fields in TSV and as `null` in JSON.
+ **/
+class WindowTable {
+public: // types
+
+	enum class Format {
+		TSV,
+		JSON
+	};
+
+public: // functions
+
+	/// Parses a table specification like "id,class,geometry.json".
+	/**
+	 * The specification consists of comma separated column names,
+	 * optionally followed by a ".tsv" or ".json" suffix selecting the
+	 * format. Without suffix TSV is used.
+	 *
+	 * \return
+	 * 	`false` if the specification is invalid, in which case
+	 * 	`table` is left unchanged.
+	 **/
+	static bool parse(const std::string_view spec, WindowTable &table);
+
+	const std::vector<std::string>& columns() const { return m_columns; }
+
+	Format format() const { return m_format; }
+
+	/// Appends the complete table for `windows` to `out`.
+	/**
+	 * The caller needs to hold an EpochGuard for accessing the windows.
+	 **/
+	void render(const std::vector<const WindowDirEntry*> &windows, std::string &out) const;
+
+protected: // functions
+
+	void renderTSV(const std::vector<const WindowDirEntry*> &windows, std::string &out) const;
+
+	void renderJSON(const std::vector<const WindowDirEntry*> &windows, std::string &out) const;
+
+protected: // data
+
+	/// The attribute names to render for each window.
+	std::vector<std::string> m_columns;
+	Format m_format = Format::TSV;
+};
+
+} // end ns
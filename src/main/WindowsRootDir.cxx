@@ -1,12 +1,17 @@
+// C++
+#include <algorithm>
+
 // libxpp
 #include <xpp/formatting.hxx>
 #include <xpp/XWindow.hxx>
 
 // xwmfs
+#include "main/AttrIndexDir.hxx"
 #include "main/logger.hxx"
 #include "main/WindowDirEntry.hxx"
 #include "main/WindowsRootDir.hxx"
 #include "main/Xwmfs.hxx"
+#include "x11/PropertyFetcher.hxx"
 
 namespace xwmfs {
 
@@ -15,29 +20,92 @@ WindowsRootDir::WindowsRootDir() :
 }
 
 void WindowsRootDir::removeWindow(const xpp::XWindow &win) {
+	for (auto index: m_indexes) {
+		index->removeWindow(win.id());
+	}
+
+	m_window_dirs.erase(win.id());
 	removeEntry(xpp::to_string(win.id()));
 }
 
 WindowDirEntry* WindowsRootDir::getWindowDir(const xpp::XWindow &win) {
-	auto win_dir = dynamic_cast<WindowDirEntry*>(
-		getDirEntry(xpp::to_string(win.id()))
-	);
+	auto it = m_window_dirs.find(win.id());
+
+	return it == m_window_dirs.end() ? nullptr : it->second;
+}
+
+std::vector<const WindowDirEntry*> WindowsRootDir::collectWindows() const {
+	std::vector<const WindowDirEntry*> ret;
+	const auto &objs = getEntries();
+	ret.reserve(objs.size());
+
+	// we only ever contain window directories
+	for (auto entry: objs) {
+		ret.push_back(static_cast<const WindowDirEntry*>(entry));
+	}
+
+	std::sort(ret.begin(), ret.end(), [](auto a, auto b) {
+		return a->window().id() < b->window().id();
+	});
+
+	return ret;
+}
+
+void WindowsRootDir::addIndex(AttrIndexDir *index) {
+	m_indexes.push_back(index);
+}
+
+const AttrIndexDir* WindowsRootDir::valueIndex(const std::string_view attr) const {
+	for (const auto index: m_indexes) {
+		if (index->hasValueKeys() && index->attribute() == attr) {
+			return index;
+		}
+	}
+
+	return nullptr;
+}
 
-	return win_dir;
+void WindowsRootDir::attributeChanged(const WindowDirEntry &win_dir, const std::string_view attr) {
+	for (auto index: m_indexes) {
+		if (index->attribute() == attr) {
+			index->updateWindow(win_dir);
+		}
+	}
 }
 
-void WindowsRootDir::addWindow(const xpp::XWindow &win,
+void WindowsRootDir::reindex(const std::string_view attr) {
+	for (const auto &[id, win_dir]: m_window_dirs) {
+		attributeChanged(*win_dir, attr);
+	}
+}
+
+CommitFunction WindowsRootDir::prepareAddWindow(const xpp::XWindow &win,
 		const InitialPopulation initial, const IsRootWin is_root_win) {
-	if (!is_root_win) {
-		// we want to get any structure change events
-		//
-		// but don't register these for the root window, Xwmfs class
-		// already registered events for that one. Otherwise we'd
-		// overwrite settings like getting create events.
-		win.selectDestroyEvent();
-		win.selectPropertyNotifyEvent();
+	/*
+	 * This situation happens sometimes e.g. on i3 window manager. a
+	 * window is destroyed but some kind of zombie entry remains in the
+	 * client list. If xwmfs starts up in this situation then it will
+	 * populate this zombie window in the file system, however all
+	 * operations on it will fail, thus many directory nodes will be
+	 * missing.
+	 *
+	 * When a new window is created then i3 seems to recycle the zombie
+	 * window id and a create event for this new window is coming in. In
+	 * this situation we have a double add from our point of view. We try
+	 * to recover from it and be robust about it, by updating the existing
+	 * entry.
+	 *
+	 * Looking up the entry without any locking is fine, since only the
+	 * event thread modifies the structure.
+	 */
+	if (auto orig_entry = getWindowDir(win); orig_entry) {
+		logger->warn() << "double-add of window "
+			<< orig_entry->name() << ": updating existing entry\n";
+		return orig_entry->prepareUpdateAll();
 	}
 
+	selectEvents(win, is_root_win);
+
 	// make sure the XServer knows we want to get those events, otherwise
 	// race conditions can occur so that for example:
 	// - we see that the new window has no "name" yet
@@ -46,65 +114,113 @@ void WindowsRootDir::addWindow(const xpp::XWindow &win,
 	// - so in the end we'd never get to know about the window name
 	Xwmfs::getInstance().getDisplay().sync();
 
-	auto win_dir = new xwmfs::WindowDirEntry{win, initial ? true : false};
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+	WindowDirEntry::requestInitialData(fetcher, win.id());
+	fetcher.collect();
+
+	auto win_dir = createWindowDir(win, fetcher, initial);
+
+	return [this, win_dir]() {
+		addWindowDir(win_dir);
+	};
+}
+
+void WindowsRootDir::addWindows(const std::vector<xpp::WinID> &windows,
+		const xpp::WinID root_win, const InitialPopulation initial) {
+	std::vector<xpp::XWindow> new_windows;
+
+	for (const auto winid: windows) {
+		xpp::XWindow win{winid};
+
+		// see prepareAddWindow() about double-adds
+		if (auto orig_entry = getWindowDir(win); orig_entry) {
+			logger->warn() << "double-add of window "
+				<< orig_entry->name() << ": updating existing entry\n";
+			orig_entry->prepareUpdateAll()();
+			continue;
+		}
 
+		selectEvents(win, IsRootWin{winid == root_win});
+		new_windows.push_back(win);
+	}
+
+	// a single sync covers the event selection for all windows, see
+	// prepareAddWindow() about why this is needed
+	Xwmfs::getInstance().getDisplay().sync();
+
+	PropertyFetcher fetcher{Xwmfs::getInstance().getDisplay()};
+
+	for (const auto &win: new_windows) {
+		WindowDirEntry::requestInitialData(fetcher, win.id());
+	}
+
+	fetcher.collect();
+
+	std::vector<WindowDirEntry*> win_dirs;
+
+	for (const auto &win: new_windows) {
+		win_dirs.push_back(createWindowDir(win, fetcher, initial));
+	}
+
+	addWindowDirs(win_dirs);
+}
+
+void WindowsRootDir::selectEvents(const xpp::XWindow &win, const IsRootWin is_root_win) {
+	if (is_root_win) {
+		// don't register these for the root window, Xwmfs class
+		// already registered events for that one. Otherwise we'd
+		// overwrite settings like getting create events.
+		return;
+	}
+
+	// we want to get any structure change events
+	win.selectDestroyEvent();
+	win.selectPropertyNotifyEvent();
+}
+
+WindowDirEntry* WindowsRootDir::createWindowDir(const xpp::XWindow &win,
+		const PropertyFetcher &fetched, const InitialPopulation initial) {
+	// the directory isn't part of the file system yet, so populating it
+	// doesn't require any locking
+	return new xwmfs::WindowDirEntry{win, fetched, initial ? true : false};
+}
+
+void WindowsRootDir::addWindowDir(WindowDirEntry *win_dir) {
+	addWindowDirs({win_dir});
+}
+
+void WindowsRootDir::addWindowDirs(const std::vector<WindowDirEntry*> &win_dirs) {
 	try {
 		// the window directories are named after their IDs
-		addEntry(win_dir, DirEntry::InheritTime{false});
-		logger->debug() << "Added window "
-			<< xpp::to_string(win.id()) << "\n";
-	} catch (const DirEntry::DoubleAddError &) {
-		/*
-		 * This situation happens sometimes e.g. on i3 window manager.
-		 * a window is destroyed but some kind of zombie entry remains
-		 * in the client list. If xwmfs starts up in this situation
-		 * then it will populate this zombie window in the file
-		 * system, however all operations on it will fail, thus many
-		 * directory nodes will be missing.
-		 *
-		 * When a new window is created then i3 seems to recycle the
-		 * zombie window id and a create event for this new window is
-		 * coming in. In this situation we have a double add from our
-		 * point of view. We try to recover from it and be robust
-		 * about it, by updating the existing entry
-		 */
-		logger->warn() << "double-add of window "
-			<< win_dir->name() << ": updating existing entry\n";
-		auto orig_entry = dynamic_cast<WindowDirEntry*>(
-			getDirEntry(win_dir->name())
-		);
-
-		if (orig_entry) {
-			orig_entry->updateAll();
-		} else {
-			logger->error() << "double-add of window, but existing entry is not a WindowDirEntry?!\n";
-		}
-		// delete the duplicate
-		delete win_dir;
+		addEntries({win_dirs.begin(), win_dirs.end()}, DirEntry::InheritTime{false});
 	} catch (...) {
-		delete win_dir;
+		for (auto win_dir: win_dirs) {
+			delete win_dir;
+		}
 		throw;
 	}
-}
 
-void WindowsRootDir::updateProperty(const xpp::XWindow &win, const xpp::AtomID changed_atom) {
-	auto win_dir = getWindowDir(win);
+	for (auto win_dir: win_dirs) {
+		m_window_dirs[win_dir->window().id()] = win_dir;
+		logger->debug() << "Added window "
+			<< win_dir->name() << "\n";
 
-	if (!win_dir) {
-		return missingWindow(win, "property update");
+		for (auto index: m_indexes) {
+			index->updateWindow(*win_dir);
+		}
 	}
-
-	win_dir->update(changed_atom);
 }
 
-void WindowsRootDir::deleteProperty(const xpp::XWindow &win, const xpp::AtomID deleted_atom) {
+CommitFunction WindowsRootDir::prepareUpdateProperty(const xpp::XWindow &win,
+		const xpp::AtomID changed_atom, const bool is_delete) {
 	auto win_dir = getWindowDir(win);
 
 	if (!win_dir) {
-		return missingWindow(win, "property delete");
+		missingWindow(win, is_delete ? "property delete" : "property update");
+		return {};
 	}
 
-	win_dir->delProp(deleted_atom);
+	return win_dir->prepareUpdate(changed_atom, is_delete);
 }
 
 void WindowsRootDir::updateGeometry(const xpp::XWindow &win, const xpp::ConfigureEvent &event) {
@@ -1,5 +1,9 @@
 #pragma once
 
+// C++
+#include <unordered_map>
+#include <vector>
+
 // libcosmos
 #include "cosmos/utils.hxx"
 
@@ -7,10 +11,13 @@
 #include <xpp/fwd.hxx>
 
 // xwmfs
+#include "common/types.hxx"
 #include "fuse/DirEntry.hxx"
 
 namespace xwmfs {
 
+class AttrIndexDir;
+class PropertyFetcher;
 class WindowDirEntry;
 
 /// Represents the "windows" root directory.
@@ -38,9 +45,33 @@ public: // functions
 	 **/
 	void removeWindow(const xpp::XWindow &win);
 
-	/// Adds the given window into the correct place in the hierarchy.
+	/// Adds all of the given windows into the hierarchy in one go.
+	/**
+	 * This is the bulk variant of prepareAddWindow() used for the initial
+	 * population of the file system. Events are selected for all
+	 * windows first, followed by a single display sync, before the data
+	 * of all windows is fetched in a single batch. This way the number
+	 * of round trips to the X server doesn't grow with the number of
+	 * windows.
+	 *
+	 * It needs to be called from the event thread or before the event
+	 * thread is running.
+	 *
+	 * \param[in] root_win
+	 * 	The ID of the root window, which is treated specially, see
+	 * 	prepareAddWindow().
+	 **/
+	void addWindows(const std::vector<xpp::WinID> &windows,
+			const xpp::WinID root_win,
+			const InitialPopulation initial = InitialPopulation{false});
+
+	/// Prepares adding the given window into the correct place in the hierarchy.
 	/**
-	 * This function is called upon window create events.
+	 * This function is called upon window create events. It registers
+	 * for the window's events and creates the window's directory
+	 * without touching the file system yet. It needs to be called with
+	 * the event lock held. The returned function adds the directory to
+	 * the file system.
 	 *
 	 * \param[in] initial
 	 * 	If set then this is the initial population of windows and thus
@@ -49,37 +80,70 @@ public: // functions
 	 * 	If set then `win` refers to the root window. For the root
 	 * 	window no property updates are processed.
 	 **/
-	void addWindow(const xpp::XWindow &win,
+	CommitFunction prepareAddWindow(const xpp::XWindow &win,
 			const InitialPopulation initial = InitialPopulation{false},
 			const IsRootWin is_root_win = IsRootWin{false}
 	);
 
 	/// Returns a pointer to the file system entry corresponding to `win`.
 	/**
+	 * This only consults m_window_dirs and thus must only be called
+	 * from the event thread.
+	 *
 	 * \return
 	 * 	The matching pointer or nullptr if not found.
 	 **/
 	WindowDirEntry* getWindowDir(const xpp::XWindow &win);
 
-	/// Called if a window's property in the file system is to be updated.
+	/// Returns all currently existing window directories ordered by window ID.
 	/**
-	 * \param[in] win
-	 * 	The window that changed.
-	 * \param[in] changed_atom
-	 *	The atom at the window that changed.
+	 * In contrast to getWindowDir() this can be called from any thread.
+	 * The returned pointers are only valid as long as the caller holds
+	 * an EpochGuard.
 	 **/
-	void updateProperty(const xpp::XWindow &win,
-			const xpp::AtomID changed_atom);
+	std::vector<const WindowDirEntry*> collectWindows() const;
 
-	/// Called if a window's property in the file system is to be deleted.
+	/// Registers `index` to be kept up to date for all windows added from now on.
 	/**
+	 * Indexes need to be registered before FUSE threads are running,
+	 * they can access the list of indexes without locking.
+	 **/
+	void addIndex(AttrIndexDir *index);
+
+	/// Returns an index allowing to look up windows by the value of `attr`, if any.
+	/**
+	 * See AttrIndexDir::lookup().
+	 **/
+	const AttrIndexDir* valueIndex(const std::string_view attr) const;
+
+	/// Updates the indexes depending on the attribute `attr` of `win_dir`.
+	/**
+	 * This is called by WindowDirEntry in the commit phase of attribute
+	 * changes.
+	 **/
+	void attributeChanged(const WindowDirEntry &win_dir, const std::string_view attr);
+
+	/// Updates the indexes depending on the attribute `attr` for all windows.
+	/**
+	 * This is necessary if the keys derived from the attribute changed
+	 * for reasons outside of the window, like renamed desktops.
+	 **/
+	void reindex(const std::string_view attr);
+
+	/// Prepares updating a window's property in the file system.
+	/**
+	 * See WindowDirEntry::prepareUpdate().
+	 *
 	 * \param[in] win
-	 * 	The window that lost a property.
-	 * \param[in] deleted_atom
-	 * 	The atom at the window that was deleted.
+	 * 	The window that changed.
+	 * \param[in] changed_atom
+	 *	The atom at the window that changed.
+	 * \param[in] is_delete
+	 * 	Whether the property was deleted from the window.
 	 **/
-	void deleteProperty(const xpp::XWindow &win,
-			const xpp::AtomID deleted_atom);
+	CommitFunction prepareUpdateProperty(const xpp::XWindow &win,
+			const xpp::AtomID changed_atom,
+			const bool is_delete);
 
 	/// Called if a window's geometry has changed.
 	/**
@@ -109,8 +173,37 @@ public: // functions
 
 protected: // functions
 
+	/// Selects the events we're interested in for `win`.
+	void selectEvents(const xpp::XWindow &win, const IsRootWin is_root_win);
+
+	/// Creates a new (detached) directory for `win` from the data in `fetched`.
+	WindowDirEntry* createWindowDir(const xpp::XWindow &win,
+			const PropertyFetcher &fetched,
+			const InitialPopulation initial);
+
+	/// Adds a directory previously returned from createWindowDir().
+	void addWindowDir(WindowDirEntry *win_dir);
+
+	/// Adds multiple directories previously returned from createWindowDir().
+	/**
+	 * The directory content is only published once for all of them.
+	 **/
+	void addWindowDirs(const std::vector<WindowDirEntry*> &win_dirs);
+
 	void missingWindow(const xpp::XWindow &win,
 			const std::string &action);
+
+protected: // data
+
+	/// Direct mapping of window IDs to their directories.
+	/**
+	 * This saves formatting the window ID and a name lookup for each X
+	 * event that refers to a window. It is only accessed by the event
+	 * thread, which is also the only one adding and removing windows.
+	 **/
+	std::unordered_map<xpp::WinID, WindowDirEntry*> m_window_dirs;
+	/// Indexes maintained for the windows, see addIndex().
+	std::vector<AttrIndexDir*> m_indexes;
 };
 
 } // end ns
@@ -1,7 +1,14 @@
 // C++
+#include <charconv>
 #include <functional>
+#include <optional>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+// FUSE
+#include <fuse_lowlevel.h>
+
 // cosmos
 #include <cosmos/error/ApiError.hxx>
 #include <cosmos/formatting.hxx>
@@ -30,18 +37,63 @@
 
 // xwmfs
 #include "fuse/Entry.hxx"
-#include "fuse/xwmfs_fuse.hxx"
+#include "fuse/EpochReclaimer.hxx"
+#include "fuse/EventFile.hxx"
+#include "fuse/EventKindsFile.hxx"
+#include "fuse/KernelCache.hxx"
+#include "main/AttrIndexDir.hxx"
 #include "main/DesktopsRootDir.hxx"
 #include "main/Exception.hxx"
 #include "main/logger.hxx"
+#include "main/QueryFile.hxx"
 #include "main/SelectionDirEntry.hxx"
+#include "main/SnapshotDir.hxx"
+#include "main/WaitFile.hxx"
+#include "main/WindowDirEntry.hxx"
 #include "main/WindowsRootDir.hxx"
 #include "main/WinManagerDirEntry.hxx"
 #include "main/Xwmfs.hxx"
 
 namespace xwmfs {
 
+namespace {
+
+/// The maximum number of X events processed as a single batch.
+constexpr size_t MAX_EVENT_BATCH = 256;
+
+} // end anon ns
+
 cosmos::FileMode Xwmfs::m_umask = cosmos::FileMode{cosmos::ModeT{0777}};
+thread_local EventOrigin Xwmfs::m_event_origin;
+thread_local uint64_t Xwmfs::m_current_request = 0;
+
+namespace {
+
+/// Returns the information about `ev` to be recorded in file system events.
+EventOrigin event_origin(const xpp::Event &ev) {
+	EventOrigin ret;
+
+	switch (ev.type()) {
+	case xpp::EventType::PROPERTY_NOTIFY: {
+		const auto prop_ev = xpp::PropertyEvent{ev};
+		ret.server_time = static_cast<uint32_t>(prop_ev.time());
+		ret.atom = static_cast<uint32_t>(prop_ev.property());
+		break;
+	}
+	case xpp::EventType::SELECTION_REQUEST: {
+		const auto req_ev = xpp::SelectionRequestEvent{ev};
+		ret.server_time = static_cast<uint32_t>(req_ev.time());
+		ret.atom = static_cast<uint32_t>(req_ev.selection());
+		break;
+	}
+	default:
+		break;
+	}
+
+	return ret;
+}
+
+} // end anon ns
 
 Xwmfs::Xwmfs() :
 		m_display{xpp::display},
@@ -57,6 +109,9 @@ Xwmfs::~Xwmfs() {
 	}
 	m_wm_dir = nullptr;
 	m_win_dir = nullptr;
+	m_events = nullptr;
+	m_changes = nullptr;
+	m_wait = nullptr;
 }
 
 void Xwmfs::early_init() {
@@ -114,6 +169,12 @@ cosmos::ExitStatus Xwmfs::init() noexcept {
 
 			createSelectionWindow();
 
+			auto housekeeping = [this]() {
+				m_housekeeping_event.signal();
+			};
+			KernelCache::getInstance().setWakeup(housekeeping);
+			EpochReclaimer::getInstance().setWakeup(housekeeping);
+
 			m_ev_thread = std::move(cosmos::PosixThread{
 				{std::bind(&Xwmfs::eventThread, this)},
 				"event thread"});
@@ -142,7 +203,16 @@ void Xwmfs::exit() noexcept {
 			m_ev_thread.join();
 		}
 
+		KernelCache::getInstance().setWakeup(nullptr);
+		EpochReclaimer::getInstance().setWakeup(nullptr);
+
 		m_fs_root.clear();
+
+		// there are no more FUSE readers at this point, freeing
+		// objects may retire further ones, though (parents).
+		while (EpochReclaimer::getInstance().reclaim() != 0) {
+			;
+		}
 	} catch (const std::exception &ex) {
 		logger->error() << "failed to join event thread / clear file system: "
 			<< ex.what() << "\n";
@@ -159,6 +229,19 @@ void Xwmfs::createFS() {
 	m_fs_root.setModifyTime(m_current_time);
 	m_fs_root.setStatusTime(m_current_time);
 
+	// aggregated events of all windows, the WM and selections, this
+	// needs to exist before any of the directories reporting to it.
+	m_events = new EventFile{"events"};
+	m_fs_root.addEntry(m_events);
+	m_changes = new EventFile{"changes", cosmos::RealTime{},
+		m_opts.eventBacklog(), EventFile::WithValues{true}};
+	m_fs_root.addEntry(m_changes);
+	// the names of the kind IDs used in binary event records
+	m_fs_root.addEntry(new EventKindsFile{"event_kinds"});
+	// event filters only accept registered kinds, thus register the
+	// kinds of all window attributes even if no window exists yet
+	WindowDirEntry::attributeNames();
+
 	// window manager (WM) directory that contains files with global WM information
 	m_wm_dir = new xwmfs::WinManagerDirEntry{m_root_win};
 	m_fs_root.addEntry(m_wm_dir);
@@ -167,6 +250,19 @@ void Xwmfs::createFS() {
 	m_win_dir = new WindowsRootDir{};
 	m_fs_root.addEntry(m_win_dir);
 
+	// tables of all windows rendered in a single read
+	m_fs_root.addEntry(new SnapshotDir{*m_win_dir});
+	// ad-hoc window queries evaluated in a single write + read
+	m_fs_root.addEntry(new QueryFile{*m_win_dir});
+	// blocking until windows satisfy a query
+	m_wait = new WaitFile{*m_win_dir};
+	m_fs_root.addEntry(m_wait);
+
+	if (!m_opts.lazyAttrs()) {
+		// the indexes need the attribute values of all windows
+		createIndexes();
+	}
+
 	// desktop / workspace specific information
 	m_desktop_dir = new DesktopsRootDir{m_root_win};
 	m_fs_root.addEntry(m_desktop_dir);
@@ -198,21 +294,62 @@ void Xwmfs::createFS() {
 		windows = &(m_root_win.windowList());
 	}
 
-	// add each window found to the file system
+	// add all windows found to the file system in one batch
+	m_win_dir->addWindows(*windows, m_root_win.id(),
+			WindowsRootDir::InitialPopulation{true});
 
-	{
-		FileSysWriteGuard write_guard{m_fs_root};
-
-		for (const auto &win: *windows) {
-			m_win_dir->addWindow(
-					xpp::XWindow{win},
-					WindowsRootDir::InitialPopulation{true},
-					WindowsRootDir::IsRootWin{win == m_root_win}
-			);
+	m_desktop_dir->handleDesktopsChanged();
+}
+
+void Xwmfs::createIndexes() {
+	// windows by their instance and class names
+	auto by_class = new AttrIndexDir{"by-class", "class",
+		[](const WindowDirEntry &win, std::vector<std::string> &keys) {
+			auto classes = win.attribute("class").value_or("");
+
+			while (!classes.empty()) {
+				const auto end = classes.find('\n');
+				keys.emplace_back(classes.substr(0, end));
+
+				if (end == classes.npos)
+					break;
+
+				classes.remove_prefix(end + 1);
+			}
+		},
+		AttrIndexDir::ValueKeys{true}
+	};
+
+	// windows by the PID of their owner
+	auto by_pid = new AttrIndexDir{"by-pid", "pid",
+		[](const WindowDirEntry &win, std::vector<std::string> &keys) {
+			if (auto pid = win.attribute("pid"); pid) {
+				keys.emplace_back(*pid);
+			}
+		},
+		AttrIndexDir::ValueKeys{true}
+	};
+
+	// windows by the name of the desktop they're on
+	auto by_desktop_name = new AttrIndexDir{"by-desktop-name", "desktop",
+		[this](const WindowDirEntry &win, std::vector<std::string> &keys) {
+			const auto desktop = win.attribute("desktop");
+			const auto &names = m_root_win.getDesktopNames();
+			size_t nr = 0;
+
+			if (!desktop || std::from_chars(desktop->data(), desktop->data() + desktop->size(), nr).ec != std::errc{}) {
+				// not assigned or sticky (-1)
+				return;
+			} else if (nr < names.size()) {
+				keys.emplace_back(names[nr]);
+			}
 		}
-	}
+	};
 
-	m_desktop_dir->handleDesktopsChanged();
+	for (auto index: {by_class, by_pid, by_desktop_name}) {
+		m_fs_root.addEntry(index);
+		m_win_dir->addIndex(index);
+	}
 }
 
 void Xwmfs::createSelectionWindow() {
@@ -247,11 +384,13 @@ void Xwmfs::eventThread() {
 
 	/*
 	 * listen on the low level XDisplay file descriptor as well as on the
-	 * wakeup event (for shutdown) and the abort pipe (for aborting
-	 * blocking calls).
+	 * wakeup event (for shutdown), the abort pipe (for aborting
+	 * blocking calls) and the housekeeping event (for changes made by
+	 * FUSE threads).
 	 */
 
-	for (auto fd: {m_display.connectionNumber(), m_wakeup_event.fd(), m_abort_pipe.readEnd()}) {
+	for (auto fd: {m_display.connectionNumber(), m_wakeup_event.fd(),
+			m_abort_pipe.readEnd(), m_housekeeping_event.fd()}) {
 		m_event_poller.addFD(fd, cosmos::Poller::MonitorFlag::INPUT);
 	}
 
@@ -266,11 +405,23 @@ void Xwmfs::eventThread() {
 				} else if (fd == m_abort_pipe.readEnd()) {
 					readAbortPipe();
 					continue;
+				} else if (fd == m_housekeeping_event.fd()) {
+					(void)m_housekeeping_event.wait();
 				} else {
 					// now we should be able to read at
 					// least one X11 event without blocking
 					handlePendingEvents();
 				}
+
+				// let the kernel drop outdated cache entries for
+				// whatever changed. This needs to happen before
+				// reclaiming: inode numbers are entry addresses,
+				// which could otherwise already be reused.
+				KernelCache::getInstance().flush();
+				// free file system objects that have been
+				// removed meanwhile and are no longer visible
+				// to FUSE readers.
+				EpochReclaimer::getInstance().reclaim();
 			}
 		} catch (const std::exception &ex) {
 			logger->error() << "unable to poll for events: " << ex.what() << "\n";
@@ -281,7 +432,7 @@ void Xwmfs::eventThread() {
 
 void Xwmfs::handlePendingEvents() {
 	cosmos::MutexGuard g{m_event_lock};
-	xpp::Event m_ev;
+	EventBatch batch;
 
 	/*
 	 * It is important to read all pending events to avoid blocking while
@@ -293,24 +444,173 @@ void Xwmfs::handlePendingEvents() {
 	 * wouldn't process.
 	 */
 	while (m_display.hasPendingEvents()) {
-		m_display.nextEvent(m_ev);
+		batch.clear();
+
+		// drain the queue to be able to coalesce redundant events,
+		// but limit the batch size to keep latency bounded during
+		// event storms.
+		while (batch.size() < MAX_EVENT_BATCH && m_display.hasPendingEvents()) {
+			m_display.nextEvent(batch.emplace_back());
+		}
+
+		coalesceEvents(batch);
+		processEvents(batch);
+	}
+}
+
+void Xwmfs::coalesceEvents(EventBatch &batch) const {
+	using Type = xpp::EventType;
+	// identifies events that supersede each other
+	using EventKey = std::tuple<xpp::WinID, Type, xpp::AtomID>;
+
+	// the latest position of each coalescable event seen so far
+	std::map<EventKey, size_t> latest;
+	std::vector<bool> superseded(batch.size(), false);
+
+	auto forgetWindow = [&latest](const xpp::WinID win) {
+		auto it = latest.lower_bound(
+				EventKey{win, Type{}, xpp::AtomID::INVALID});
+		while (it != latest.end() && std::get<0>(it->first) == win) {
+			it = latest.erase(it);
+		}
+	};
+
+	for (size_t pos = 0; pos < batch.size(); pos++) {
+		const auto &ev = batch[pos];
+		std::optional<EventKey> key;
+
+		switch (ev.type()) {
+		case Type::CREATE_NOTIFY: {
+			forgetWindow(xpp::CreateEvent{ev}.window());
+			break;
+		}
+		case Type::DESTROY_NOTIFY: {
+			forgetWindow(xpp::DestroyEvent{ev}.window());
+			break;
+		}
+		case Type::PROPERTY_NOTIFY: {
+			const auto prop_ev = xpp::PropertyEvent{ev};
+			if (auto win = prop_ev.window(); win) {
+				key = EventKey{*win, ev.type(), prop_ev.property()};
+			}
+			break;
+		}
+		case Type::CONFIGURE_NOTIFY: {
+			const auto config_ev = xpp::ConfigureEvent{ev};
+			key = EventKey{config_ev.window(), ev.type(), xpp::AtomID::INVALID};
+			break;
+		}
+		default:
+			break;
+		}
+
+		if (!key)
+			continue;
+
+		auto [it, inserted] = latest.insert({*key, pos});
+
+		if (!inserted) {
+			superseded[it->second] = true;
+			it->second = pos;
+		}
+	}
+
+	size_t kept = 0;
+
+	for (size_t pos = 0; pos < batch.size(); pos++) {
+		if (!superseded[pos]) {
+			if (kept != pos)
+				batch[kept] = batch[pos];
+			kept++;
+		}
+	}
+
+	if (kept != batch.size()) {
+		logger->debug() << "Coalesced " << batch.size() << " X11 events into "
+			<< kept << "\n";
+		batch.resize(kept);
+	}
+}
+
+void Xwmfs::processEvents(const EventBatch &batch) {
+	struct PendingCommit {
+		xpp::EventType type;
+		EventOrigin origin;
+		CommitFunction commit;
+	};
+
+	std::vector<PendingCommit> commits;
+
+	auto commitAll = [this, &commits]() {
+		if (commits.empty())
+			return;
+
+		// the commit phase: don't keep the event lock for this,
+		// because otherwise we might run into cross-locking issues,
+		// because other threads may hold a directory lock and want
+		// our event lock, while we have the event lock but desire the
+		// directory lock. The commit functions lock the directories
+		// they modify themselves.
+		cosmos::MutexReverseGuard rg{m_event_lock};
+		// readers of multiple directories mustn't see a partial batch
+		cosmos::MutexGuard commit_guard{m_commit_lock};
+
+		for (auto &[type, origin, commit]: commits) {
+			m_event_origin = origin;
+
+			try {
+				commit();
+			} catch (const std::exception &ex) {
+				logger->error() << "Failed to commit X11 event of type "
+					<< cosmos::to_integral(type) << ": " << ex.what() << "\n";
+			}
+		}
+
+		m_event_origin = EventOrigin{};
+		commits.clear();
+
+		// still holding the commit lock, thus waiters see this state
+		m_wait->windowsChanged();
+	};
+
+	for (const auto &ev: batch) {
+		const auto type = ev.type();
+		const bool is_barrier = type == xpp::EventType::CREATE_NOTIFY ||
+			type == xpp::EventType::DESTROY_NOTIFY;
+
+		if (is_barrier) {
+			// preparing these looks at the current file system
+			// structure, thus apply everything up to here first
+			commitAll();
+		}
 
 		try {
-			// don't keep this lock for the duration of the
-			// handling, because otherwise we might run into
-			// cross-locking issues, because other threads may
-			// hold the FS lock and want our event lock, while he
-			// have the event lock but desire the FS lock.
-			cosmos::MutexReverseGuard rg{m_event_lock};
-			handleEvent(m_ev);
+			// the fetch phase: all X requests necessary for
+			// processing the event are performed here with the
+			// event lock held, but without locking the file
+			// system. This way FUSE readers don't have to wait
+			// for the X server.
+			m_event_origin = event_origin(ev);
+			auto commit = prepareEvent(ev);
+
+			if (commit)
+				commits.push_back(PendingCommit{type, m_event_origin, std::move(commit)});
 		} catch (const std::exception &ex) {
 			logger->error() << "Failed to handle X11 event of type "
-				<< cosmos::to_integral(m_ev.type()) << ": " << ex.what() << "\n";
+				<< cosmos::to_integral(type) << ": " << ex.what() << "\n";
+		}
+
+		m_event_origin = EventOrigin{};
+
+		if (is_barrier) {
+			commitAll();
 		}
 	}
+
+	commitAll();
 }
 
-void Xwmfs::handleEvent(const xpp::Event &ev) {
+CommitFunction Xwmfs::prepareEvent(const xpp::Event &ev) {
 #if 0
 	logger->debug() << "Received event #" << ev.xany.serial << " of type "
 		<< std::dec << ev.type << std::endl;
@@ -320,24 +620,11 @@ void Xwmfs::handleEvent(const xpp::Event &ev) {
 	switch (ev.type()) {
 	// a new window came into existence
 	case Type::CREATE_NOTIFY: {
-		const auto create_ev = xpp::CreateEvent{ev};
-		if (!handleCreateEvent(create_ev)) {
-			m_ignored_windows.insert(create_ev.window());
-		}
-		break;
+		return prepareCreateEvent(xpp::CreateEvent{ev});
 	}
 	// a window was destroyed
 	case Type::DESTROY_NOTIFY: {
-		const auto destroy_ev = xpp::DestroyEvent{ev};
-		handleDestroyEvent(destroy_ev);
-		auto it = m_ignored_windows.find(destroy_ev.window());
-		if (it != m_ignored_windows.end()) {
-			// don't need to process a window we've ignored
-			// before
-			m_ignored_windows.erase(it);
-			break;
-		}
-		break;
+		return prepareDestroyEvent(xpp::DestroyEvent{ev});
 	}
 	case Type::PROPERTY_NOTIFY: {
 		auto prop_ev = xpp::PropertyEvent{ev};
@@ -356,27 +643,47 @@ void Xwmfs::handleEvent(const xpp::Event &ev) {
 			xpp::XWindow win{*prop_ev.window()};
 			updateTime();
 
-			FileSysWriteGuard write_guard{m_fs_root};
-
 			const auto prop = prop_ev.property();
 
 			if (win == m_root_win) {
-				if (is_delete)
-					m_wm_dir->delProp(prop);
-				else
-					m_wm_dir->update(prop);
-			} else {
 				if (is_delete) {
-					m_win_dir->deleteProperty(win, prop);
-				} else {
-					m_win_dir->updateProperty(win, prop);
+					return [this, prop]() {
+						m_wm_dir->delProp(prop);
+					};
+				}
+
+				auto wm_commit = m_wm_dir->prepareUpdate(prop);
 
-					if (prop == xpp::atoms::ewmh_window_desktop) {
-						m_desktop_dir->handleWindowDesktopChanged(win);
-					}
+				if (prop != xpp::atoms::ewmh_wm_desktop_names) {
+					return wm_commit;
 				}
+
+				// update the sibling desktops directory structure
+				auto desktop_commit = m_desktop_dir->prepareDesktopsChanged();
+
+				return [this, wm_commit, desktop_commit]() {
+					if (wm_commit)
+						wm_commit();
+					desktop_commit();
+					// windows are indexed by desktop name
+					m_win_dir->reindex("desktop");
+				};
 			}
-			break;
+
+			auto win_commit = m_win_dir->prepareUpdateProperty(win, prop, is_delete);
+
+			if (is_delete || prop != xpp::atoms::ewmh_window_desktop) {
+				return win_commit;
+			}
+
+			auto desktop_commit = m_desktop_dir->prepareWindowDesktopChanged(win);
+
+			return [win_commit, desktop_commit]() {
+				if (win_commit)
+					win_commit();
+				if (desktop_commit)
+					desktop_commit();
+			};
 		}
 		default:
 			break;
@@ -387,13 +694,11 @@ void Xwmfs::handleEvent(const xpp::Event &ev) {
 	// called upon window size/appearance changes
 	case Type::CONFIGURE_NOTIFY: {
 		xpp::ConfigureEvent config_ev{ev};
-		xpp::XWindow w{config_ev.window()};
 		updateTime();
 
-		FileSysWriteGuard write_guard{m_fs_root};
-
-		m_win_dir->updateGeometry(w, config_ev);
-		break;
+		return [this, config_ev]() {
+			m_win_dir->updateGeometry(xpp::XWindow{config_ev.window()}, config_ev);
+		};
 	}
 	case Type::CIRCULATE_NOTIFY: {
 		break;
@@ -416,9 +721,10 @@ void Xwmfs::handleEvent(const xpp::Event &ev) {
 		}
 
 		updateTime();
-		FileSysWriteGuard write_guard{m_fs_root};
-		m_win_dir->updateMappedState(map_window, ev.type() == Type::MAP_NOTIFY);
-		break;
+
+		return [this, map_window, mapped = ev.type() == Type::MAP_NOTIFY]() {
+			m_win_dir->updateMappedState(map_window, mapped);
+		};
 	}
 	case Type::GRAVITY_NOTIFY: {
 		break;
@@ -427,13 +733,16 @@ void Xwmfs::handleEvent(const xpp::Event &ev) {
 		const auto reparent_ev = xpp::ReparentEvent{ev};
 		xpp::XWindow w{reparent_ev.reparentedWindow()};
 		w.setParent(reparent_ev.newParent());
-		FileSysWriteGuard write_guard{m_fs_root};
-		m_win_dir->updateParent(w);
-		break;
+
+		return [this, w]() {
+			m_win_dir->updateParent(w);
+		};
 	}
 	case Type::SELECTION_NOTIFY:
 	case Type::SELECTION_CLEAR:
 	case Type::SELECTION_REQUEST: {
+		// these don't touch the file system structure, they're
+		// completely dealt with in the fetch phase
 		handleSelectionEvent(ev);
 		break;
 	}
@@ -443,6 +752,8 @@ void Xwmfs::handleEvent(const xpp::Event &ev) {
 			<< xpp::XWindow{xpp::WinID{ev.toAnyEvent().window}} << " received" << "\n";
 		break;
 	}
+
+	return {};
 }
 
 bool Xwmfs::isPseudoWindow(const xpp::CreateEvent &ev) const {
@@ -464,9 +775,10 @@ bool Xwmfs::isPseudoWindow(const xpp::CreateEvent &ev) const {
 	return false;
 }
 
-bool Xwmfs::handleCreateEvent(const xpp::CreateEvent &ev) {
+CommitFunction Xwmfs::prepareCreateEvent(const xpp::CreateEvent &ev) {
 	if (!m_opts.handlePseudoWindows() && isPseudoWindow(ev)) {
-		return false;
+		m_ignored_windows.insert(ev.window());
+		return {};
 	}
 
 	xpp::XWindow w{ev.window()};
@@ -482,28 +794,54 @@ bool Xwmfs::handleCreateEvent(const xpp::CreateEvent &ev) {
 		logger->debug() << "<failed to get name>" << "\n";
 	}
 
+	CommitFunction win_commit, desktop_commit;
+
 	try {
 		updateTime();
-		FileSysWriteGuard write_guard{m_fs_root};
-		m_win_dir->addWindow(w);
-		m_wm_dir->windowLifecycleEvent(w, true);
-		m_desktop_dir->handleWindowCreated(w);
+		win_commit = m_win_dir->prepareAddWindow(w);
+		desktop_commit = m_desktop_dir->prepareWindowCreated(w);
 	} catch (const std::exception &ex) {
 		logger->debug() << "\terror adding window: " << ex.what() << "\n";
+		return {};
 	}
 
-	return true;
+	return [this, w, win_commit, desktop_commit]() {
+		try {
+			win_commit();
+			reportLifecycle(w, true);
+			if (desktop_commit)
+				desktop_commit();
+		} catch (const std::exception &ex) {
+			logger->debug() << "\terror adding window: " << ex.what() << "\n";
+		}
+	};
 }
 
-void Xwmfs::handleDestroyEvent(const xpp::DestroyEvent &ev) {
+CommitFunction Xwmfs::prepareDestroyEvent(const xpp::DestroyEvent &ev) {
 	xpp::XWindow w{ev.window()};
 
+	if (auto it = m_ignored_windows.find(w.id()); it != m_ignored_windows.end()) {
+		// don't need to process a window we've ignored before
+		m_ignored_windows.erase(it);
+		return {};
+	}
+
 	logger->debug() << "Window " << w << " was destroyed!" << "\n";
 
-	FileSysWriteGuard write_guard{m_fs_root};
-	m_win_dir->removeWindow(w);
-	m_wm_dir->windowLifecycleEvent(w, false);
-	m_desktop_dir->handleWindowDestroyed(w);
+	return [this, w]() {
+		// report this while the window's directory is still around
+		reportLifecycle(w, false);
+		m_win_dir->removeWindow(w);
+		m_desktop_dir->handleWindowDestroyed(w);
+	};
+}
+
+void Xwmfs::reportLifecycle(const xpp::XWindow &win, const bool created_else_destroyed) {
+	EpochGuard guard;
+	auto win_dir = m_win_dir->getWindowDir(win);
+
+	m_wm_dir->windowLifecycleEvent(win, created_else_destroyed,
+		win_dir ? win_dir->windowClasses() : std::string_view{});
 }
 
 void Xwmfs::handleSelectionEvent(const xpp::Event &ev) {
@@ -532,13 +870,9 @@ void Xwmfs::handleSelectionEvent(const xpp::Event &ev) {
 	}
 }
 
-/// Global sync signal handler for the FUSE abort signal.
-void fuse_abort_signal(const cosmos::Signal sig) {
-	auto &xwmfs = Xwmfs::getInstance();
-
-	const bool shutdown = sig != cosmos::signal::USR1;
-
-	xwmfs.abortBlockingCall(shutdown);
+/// Global sync signal handler for the shutdown signals.
+void fuse_abort_signal(const cosmos::Signal) {
+	Xwmfs::getInstance().requestShutdown();
 }
 
 void Xwmfs::setupAbortSignals(const bool on_off) {
@@ -547,25 +881,17 @@ void Xwmfs::setupAbortSignals(const bool on_off) {
 	 * EventFile here:
 	 *
 	 * 1) when a blocking call is pending and the userspace process that
-	 * blocks on it wants to interrupt the call then this situation is
-	 * only made available to us via SIGUSR1. This signal will be sent by
-	 * FUSE in a thread directed manner i.e. we need to setup an
-	 * asynchronous signal handler and the thread this signal handler
-	 * runs in is the one that needs to abort its blocking request.
+	 * blocks on it wants to interrupt the call then the low level FUSE
+	 * API invokes an interrupt callback in some other FUSE thread, see
+	 * interruptRequest().
 	 *
 	 * Our EventFile implementation uses a Condition variable for
-	 * efficiently waiting for data, and the Condition variable has no way
-	 * to unblock due to an asynchronously received signal (contrary to
-	 * what man 7 signal says about EINTR return if SA_RESTART is not
-	 * set).
-	 *
-	 * Thus we need to somehow keep track of which blocking calls are
-	 * going on in which objects by which threads. Then the asynchronous
-	 * signal handler forwards the interrupt information to a global event
-	 * thread which sorts the information out and unblocks the right
-	 * thread. Pretty f***ed up but that's just the way it is.
-	 *
-	 * https://sourceforge.net/p/fuse/mailman/message/28816288/
+	 * efficiently waiting for data, thus we need to keep track of which
+	 * blocking calls are going on in which objects by which threads. The
+	 * interrupt information is forwarded to the global event thread which
+	 * sorts the information out and unblocks the right thread. This
+	 * needs no signal handling anymore, unlike with the high level FUSE
+	 * API, which interrupts the blocked thread via SIGUSR1.
 	 *
 	 * 2) When a blocking call is pending and the FUSE userspace process
 	 * gets a SIGINT or SIGTERM for shutdown then FUSE will internally
@@ -584,10 +910,8 @@ void Xwmfs::setupAbortSignals(const bool on_off) {
 	 * part is to forward the interrupt request to the internal FUSE
 	 * routines, however.
 	 *
-	 * a) For this we need to know the struct fuse which is a low level
-	 * data structure normally not available when we use the high level
-	 * API of FUSE. We need this structure for explicitly shutting down
-	 * FUSE when we intercept a SIGINT or SIGTERM.
+	 * a) For this we need to explicitly exit the FUSE session when we
+	 * intercept a SIGINT or SIGTERM.
 	 *
 	 * b) Another alternative is to catch the SIGINT, unblock our blocking
 	 * threads and then reinstate the original SIGINT handler for FUSE to
@@ -600,10 +924,6 @@ void Xwmfs::setupAbortSignals(const bool on_off) {
 	 * blocked threads or so. Or a shutdown flag which we now have in
 	 * m_shutdown.
 	 *
-	 * Actually the fuse_get_context() is only valid for the duration of
-	 * a request call, but I hope the FUSE pointer is an exception, as
-	 * this shouldn't change for the lifetime of the FUSE instance.
-	 *
 	 * After some testing I'm going for solution b). This works now.
 	 * Solution a) had strange problems when the FUSE main thread didn't
 	 * react to the fuse_exit() call on the first attempt. It seems the
@@ -614,7 +934,6 @@ void Xwmfs::setupAbortSignals(const bool on_off) {
 	action.setHandler(&fuse_abort_signal);
 
 	for (const auto signal: {
-			cosmos::signal::USR1,
 			cosmos::signal::INTERRUPT,
 			cosmos::signal::TERMINATE}) {
 
@@ -632,17 +951,24 @@ void Xwmfs::setupAbortSignals(const bool on_off) {
 	}
 }
 
-void Xwmfs::abortBlockingCall(const bool all) {
+void Xwmfs::requestShutdown() {
 	/*
-	 * Send the ID of the thread that got the signal over the abort pipe
-	 * so that the event thread can deal with the situation without
+	 * Let the event thread deal with the situation without the
 	 * restrictions of async signal handling
 	 */
+	AbortMsg msg;
+	msg.type = AbortType::SHUTDOWN;
+	writeAbortMsg(msg);
+}
 
+void Xwmfs::interruptRequest(const uint64_t id) {
 	AbortMsg msg;
-	msg.type = all ? AbortType::SHUTDOWN : AbortType::CALL;
-	msg.thread = cosmos::pthread::get_id().raw();
+	msg.type = AbortType::CALL;
+	msg.request = id;
+	writeAbortMsg(msg);
+}
 
+void Xwmfs::writeAbortMsg(const AbortMsg &msg) {
 	auto pipe_fd = m_abort_pipe.writeEnd();
 	cosmos::StreamIO pipe_io{pipe_fd};
 
@@ -656,40 +982,71 @@ void Xwmfs::abortBlockingCall(const bool all) {
 	}
 }
 
-void Xwmfs::abortBlockingCall(const cosmos::pthread::ID thread) {
-	cosmos::MutexGuard g{m_blocking_call_lock};
+void Xwmfs::abortRequest(const uint64_t id) {
+	Entry *entry = nullptr;
 
-	auto it = m_blocking_calls.find(thread);
+	{
+		cosmos::MutexGuard g{m_blocking_call_lock};
 
-	if (it == m_blocking_calls.end()) {
-		logger->error() << "Failed to find abort entry for thread" << std::endl;
-		return;
+		auto it = m_requests.find(id);
+
+		if (it == m_requests.end()) {
+			// the request has already been answered
+			logger->debug() << "Abort request for finished request" << std::endl;
+			return;
+		}
+
+		auto &state = it->second;
+		// if the request didn't block yet then it will notice this
+		// in registerBlockingCall()
+		state.interrupted = true;
+		entry = state.blocking_on;
+
+		if (!entry)
+			return;
+
+		// the request can finish as soon as we release the lock
+		entry->ref();
 	}
 
 	logger->info() << "Abort request for some blocking call" << std::endl;
 
-	auto ef = it->second;
-
-	ef->abortBlockingCall(thread);
+	/*
+	 * The blocking thread holds the entry's lock while calling
+	 * registerBlockingCall(), thus we mustn't hold m_blocking_call_lock
+	 * while waking it up.
+	 */
+	entry->abortBlockingCalls();
+	entry->release();
 }
 
 void Xwmfs::abortAllBlockingCalls() {
-	cosmos::MutexGuard g{m_blocking_call_lock};
+	std::vector<Entry*> entries;
 
-	for (auto it: m_blocking_calls) {
-		auto entry = it.second;
+	{
+		cosmos::MutexGuard g{m_blocking_call_lock};
+
+		for (auto &[id, state]: m_requests) {
+			if (auto entry = state.blocking_on; entry) {
+				entry->ref();
+				entries.push_back(entry);
+			}
+		}
 
-		entry->abortBlockingCall(it.first);
+		/*
+		 * This signaling flag is necessary to avoid race conditions: all
+		 * blocking calls may return but userspace programs often react to
+		 * EINTR by retrying the blocking calls, which would cause again a
+		 * deadlock. This flag helps us to continuously return EINTR to
+		 * successive calls.
+		 */
+		m_shutdown = true;
 	}
 
-	/*
-	 * This signaling flag is necessary to avoid race conditions: all
-	 * blocking calls may return but userspace programs often react to
-	 * EINTR by retrying the blocking calls, which would cause again a
-	 * deadlock. This flag helps us to continuously return EINTR to
-	 * successive calls.
-	 */
-	m_shutdown = true;
+	for (auto entry: entries) {
+		entry->abortBlockingCalls();
+		entry->release();
+	}
 }
 
 void Xwmfs::readAbortPipe() {
@@ -706,7 +1063,7 @@ void Xwmfs::readAbortPipe() {
 	}
 
 	if (msg.type == AbortType::CALL) {
-		abortBlockingCall(cosmos::pthread::ID{msg.thread});
+		abortRequest(msg.request);
 	} else {
 		abortAllBlockingCalls();
 		/* reinstate original signal handlers */
@@ -715,6 +1072,22 @@ void Xwmfs::readAbortPipe() {
 	}
 }
 
+uint64_t Xwmfs::beginRequest(struct fuse_req *req) {
+	cosmos::MutexGuard g{m_blocking_call_lock};
+
+	const auto id = m_next_request_id++;
+	m_requests[id] = RequestState{req, nullptr, false};
+	m_current_request = id;
+
+	return id;
+}
+
+void Xwmfs::endRequest() {
+	cosmos::MutexGuard g{m_blocking_call_lock};
+
+	m_requests.erase(std::exchange(m_current_request, 0));
+}
+
 bool Xwmfs::registerBlockingCall(Entry *entry) {
 	cosmos::MutexGuard g{m_blocking_call_lock};
 
@@ -722,7 +1095,21 @@ bool Xwmfs::registerBlockingCall(Entry *entry) {
 		return false;
 	}
 
-	m_blocking_calls.insert(std::make_pair(cosmos::pthread::get_id(), entry));
+	auto it = m_requests.find(m_current_request);
+
+	if (it == m_requests.end()) {
+		// without a tracked request we couldn't abort the call
+		return false;
+	}
+
+	auto &state = it->second;
+
+	// the interrupt message may not have been processed yet
+	if (state.interrupted || fuse_req_interrupted(state.req)) {
+		return false;
+	}
+
+	state.blocking_on = entry;
 
 	return true;
 }
@@ -730,7 +1117,27 @@ bool Xwmfs::registerBlockingCall(Entry *entry) {
 void Xwmfs::unregisterBlockingCall() {
 	cosmos::MutexGuard g(m_blocking_call_lock);
 
-	m_blocking_calls.erase(cosmos::pthread::get_id());
+	if (auto it = m_requests.find(m_current_request); it != m_requests.end()) {
+		it->second.blocking_on = nullptr;
+	}
+}
+
+bool Xwmfs::isCallAborted() {
+	cosmos::MutexGuard g(m_blocking_call_lock);
+
+	if (m_shutdown) {
+		return true;
+	}
+
+	auto it = m_requests.find(m_current_request);
+
+	if (it == m_requests.end()) {
+		return false;
+	}
+
+	const auto &state = it->second;
+
+	return state.interrupted || fuse_req_interrupted(state.req);
 }
 
 } // end ns
@@ -2,8 +2,10 @@
 
 // C++
 #include <atomic>
+#include <cstdint>
 #include <map>
 #include <set>
+#include <vector>
 
 // cosmos
 #include <cosmos/io/EventFile.hxx>
@@ -18,10 +20,15 @@
 #include <xpp/fwd.hxx>
 
 // Xwmfs
+#include "common/types.hxx"
+#include "fuse/EventFile.hxx"
 #include "fuse/RootEntry.hxx"
 #include "main/Options.hxx"
 #include "x11/WinManagerWindow.hxx"
 
+// forward declarations
+struct fuse_req;
+
 namespace xwmfs {
 
 class Entry;
@@ -29,6 +36,7 @@ class DesktopsRootDir;
 class SelectionDirEntry;
 class WindowsRootDir;
 class WinManagerDirEntry;
+class WaitFile;
 
 /// The main application class that provides XWMFS functionality.
 /**
@@ -86,11 +94,27 @@ public: // functions
 	 * XNextEvent() when no other threads are actually doing
 	 * asynchronous X calls.
 	 *
-	 * This currently mostly happens in the "properties" node where
-	 * custom atom names are handled in the context of a FUSE thread.
+	 * Reading window information is done via PropertyFetcher, which
+	 * uses XCB directly and doesn't need this lock. It is still needed
+	 * for the remaining Xlib calls from FUSE context, like writes to
+	 * windows or atom lookups via xpp::atom_mapper.
+	 *
+	 * The event thread also holds this lock during the fetch phase of
+	 * event processing (see prepareEvent()), so it serializes access to
+	 * data that is cached from X requests, like in WinManagerWindow.
 	 **/
 	cosmos::Mutex& getEventLock() { return m_event_lock; }
 
+	/// Returns the lock held by the event thread while committing updates.
+	/**
+	 * The event thread holds this lock while it puts a batch of
+	 * prepared updates into place, see processEvents(). Holding it
+	 * thus provides a consistent view of the file system content
+	 * across directories. It must not be acquired while holding a
+	 * directory lock.
+	 **/
+	cosmos::Mutex& getCommitLock() { return m_commit_lock; }
+
 	/// Returns the global window manager window representation.
 	WinManagerWindow& getRootWin() { return m_root_win; }
 
@@ -100,6 +124,16 @@ public: // functions
 	/// Returns the file system structure root entry.
 	RootEntry& getFS() { return m_fs_root; }
 
+	/// Returns the global events file aggregating events from all directories.
+	/**
+	 * Each record is tagged with the ID of the window it relates to. For
+	 * window manager wide events this is the root window.
+	 **/
+	EventFile& getEvents() { return *m_events; }
+
+	/// Returns the global changes file carrying attribute changes with their new values.
+	EventFile& getChanges() { return *m_changes; }
+
 	xpp::XWindow& getSelectionWindow() { return m_selection_window; }
 
 	/// Returns the options in effect for Xwmfs.
@@ -111,39 +145,80 @@ public: // functions
 	/// Returns the current time (updated for each new X event)
 	const cosmos::RealTime& getCurrentTime() const { return m_current_time; }
 
+	/// Returns information about the X event currently being processed by the calling thread.
+	/**
+	 * This is used for tagging file system events with their origin. In
+	 * threads other than the event thread the origin is always unknown.
+	 **/
+	static const EventOrigin& getEventOrigin() { return m_event_origin; }
+
 	/// Returns the "desktops" directory node.
 	DesktopsRootDir* getDesktopsDir() { return m_desktop_dir; }
 
+	/// Starts tracking the FUSE request `req` processed by the calling thread.
+	/**
+	 * Requests that may block need to be tracked to be able to abort
+	 * them once they're interrupted. The returned ID is to be passed to
+	 * interruptRequest() when the request is interrupted. The state is
+	 * kept until endRequest() is called by the same thread, thus an
+	 * interrupt arriving before the request blocks is not lost and an
+	 * interrupt arriving late can't affect a later request.
+	 **/
+	uint64_t beginRequest(struct fuse_req *req);
+
+	/// Stops tracking the request of the calling thread.
+	void endRequest();
+
 	/// Registers a blocking call situation.
 	/**
-	 * The calling thread will be associated with the given file object.
-	 * The callee will make sure that fuse signals to abort the blocking
-	 * request will be caught and the blocking call woken up in that
-	 * situation.
+	 * The request of the calling thread, see beginRequest(), will be
+	 * associated with the given file object. The callee will make sure
+	 * that FUSE interrupts of the request will be caught and the
+	 * blocking call woken up in that situation, see interruptRequest().
 	 *
 	 * In any case the caller must call unregisterBlockingCall() after the
 	 * blocking call is over, whether aborted or not.
 	 *
 	 * \return If `false` is returned then no blocking call can take place
-	 * right now and the operation should be aborted with an error.
+	 * right now and the operation should be aborted with an error. This
+	 * is the case during shutdown, if the request has already been
+	 * interrupted or if the calling thread has no tracked request.
 	 **/
 	bool registerBlockingCall(Entry *f);
 
 	/// Unregisters a previously registered blocking call situation.
 	void unregisterBlockingCall();
 
+	/// Returns whether the blocking call of the calling thread is to be aborted.
+	/**
+	 * See AbortHandler::wasAborted().
+	 **/
+	bool isCallAborted();
+
+	/// Aborts the request with the given ID, because it was interrupted.
+	/**
+	 * This is called from the FUSE thread that received the interrupt,
+	 * the abort is forwarded to the event thread.
+	 **/
+	void interruptRequest(const uint64_t id);
+
+protected: // types
+
+	/// A sequence of X events drained from the event queue in one go.
+	using EventBatch = std::vector<xpp::Event>;
+
 protected: // functions
 
 	friend void fuse_abort_signal(const cosmos::Signal);
 
-	/// Called from an asynchronous signal handler in case a blocking shall be aborted.
-	void abortBlockingCall(const bool all);
+	/// Called from an asynchronous signal handler to abort all blocking calls for shutdown.
+	void requestShutdown();
 
-	/// Abort a blocking call for the given thread
+	/// Marks the request with the given ID as aborted and wakes it up if it is blocking.
 	/**
 	 * This is called synchronously from the event handling thread.
 	 **/
-	void abortBlockingCall(const cosmos::pthread::ID thread);
+	void abortRequest(const uint64_t id);
 
 	/// Abort all pending blocking calls.
 	void abortAllBlockingCalls();
@@ -180,18 +255,52 @@ protected: // functions
 	/// Processes all events that can currently be read without blocking.
 	void handlePendingEvents();
 
-	/// Handles a single X11 event received by the event thread.
-	void handleEvent(const xpp::Event &ev);
+	/// Removes events from `batch` that are superseded by later ones.
+	/**
+	 * Property notifications for the same window and atom and geometry
+	 * changes of the same window only need to be processed once, since
+	 * the current state is fetched from the X server anyway. Only the
+	 * last of such events is kept in its position. Window creation and
+	 * destruction events are never removed and act as barriers: events
+	 * for a window are not merged across these.
+	 **/
+	void coalesceEvents(EventBatch &batch) const;
+
+	/// Applies the given batch of events to the file system.
+	/**
+	 * All events are prepared in a row and the resulting commit
+	 * functions are applied together, releasing the event lock only
+	 * once. Window creation and destruction events are
+	 * committed right away, since subsequent events may depend on the
+	 * resulting file system structure.
+	 **/
+	void processEvents(const EventBatch &batch);
 
-	/// Handles a window creation event.
+	/// Prepares processing of a single X11 event received by the event thread.
 	/**
+	 * This is the fetch phase of event processing, it is called with the
+	 * event lock held. Any X requests necessary to process the event are
+	 * performed here, but the file system is not touched.
+	 *
 	 * \return
-	 * 	Whether the window has been added to the file system or not
+	 * 	The function that applies the event to the file system, if
+	 * 	anything needs to be done. It needs to be called without the
+	 * 	event lock held.
 	 **/
-	bool handleCreateEvent(const xpp::CreateEvent &ev);
+	CommitFunction prepareEvent(const xpp::Event &ev);
 
-	/// Handles a window destruction event
-	void handleDestroyEvent(const xpp::DestroyEvent &ev);
+	/// Prepares processing of a window creation event.
+	CommitFunction prepareCreateEvent(const xpp::CreateEvent &ev);
+
+	/// Prepares processing of a window destruction event.
+	CommitFunction prepareDestroyEvent(const xpp::DestroyEvent &ev);
+
+	/// Reports the creation or destruction of `win` via the events files.
+	/**
+	 * This needs to be called from the event thread while the window's
+	 * directory still exists.
+	 **/
+	void reportLifecycle(const xpp::XWindow &win, const bool created_else_destroyed);
 
 	/// Handles any selection buffer related events.
 	void handleSelectionEvent(const xpp::Event &ev);
@@ -205,7 +314,16 @@ protected: // functions
 
 private: // types
 
-	using BlockingCallMap = std::map<cosmos::pthread::ID, Entry*>;
+	/// State of a tracked FUSE request, see beginRequest().
+	struct RequestState {
+		struct fuse_req *req = nullptr;
+		/// The entry the request currently blocks on, if any.
+		Entry *blocking_on = nullptr;
+		/// Whether the request has been interrupted.
+		bool interrupted = false;
+	};
+
+	using RequestMap = std::map<uint64_t, RequestState>;
 	using SignalHandlerMap = std::map<cosmos::Signal, cosmos::SigAction>;
 
 	/// Different abort signal contexts
@@ -218,11 +336,20 @@ private: // types
 
 	struct AbortMsg {
 		AbortType type;
-		pthread_t thread = 0;
+		/// For AbortType::CALL, the ID of the interrupted request.
+		uint64_t request = 0;
 	};
 
 	using WindowSet = std::set<xpp::WinID>;
 
+private: // functions
+
+	/// Passes `msg` to the event thread via m_abort_pipe.
+	/**
+	 * This is async signal safe.
+	 **/
+	void writeAbortMsg(const AbortMsg &msg);
+
 private: // data
 
 	/// The display we're operating on.
@@ -244,6 +371,8 @@ private: // data
 
 	/// Wakeup signaling file descriptor.
 	cosmos::EventFile m_wakeup_event;
+	/// Signaled by FUSE threads when cache invalidations or retired objects are pending.
+	cosmos::EventFile m_housekeeping_event;
 
 	/// File descriptor poller for the event thread.
 	cosmos::Poller m_event_poller;
@@ -259,12 +388,20 @@ private: // data
 	WinManagerDirEntry *m_wm_dir = nullptr;
 	/// Directory node containing selection buffer information.
 	SelectionDirEntry *m_selection_dir = nullptr;
-
-	/// Abort pipe to signal abort requests for a specific thread.
+	/// File in the root directory carrying all events in one stream.
+	EventFile *m_events = nullptr;
+	/// File in the root directory carrying changed attributes and their values.
+	EventFile *m_changes = nullptr;
+	/// File in the root directory for blocking until windows satisfy a query.
+	WaitFile *m_wait = nullptr;
+
+	/// Abort pipe to signal abort requests for a specific request.
 	cosmos::Pipe m_abort_pipe;
-	/// A mapping of active blocking threads and their associated files.
-	BlockingCallMap m_blocking_calls;
-	/// Synchronization for access to m_blocking_calls.
+	/// The currently tracked FUSE requests by their ID.
+	RequestMap m_requests;
+	/// The ID to assign to the next tracked request.
+	uint64_t m_next_request_id = 1;
+	/// Synchronization for access to m_requests and m_shutdown.
 	cosmos::Mutex m_blocking_call_lock;
 	/// Whether we're in a shutdown condition.
 	bool m_shutdown = false;
@@ -274,10 +411,18 @@ private: // data
 	/// The active umask of the current process.
 	static cosmos::FileMode m_umask;
 
+	/// The origin of the X event processed by the current thread, see getEventOrigin().
+	static thread_local EventOrigin m_event_origin;
+
+	/// The ID of the request tracked for the current thread, or zero.
+	static thread_local uint64_t m_current_request;
+
 	/// Currently existing windows that are ignored by us.
 	WindowSet m_ignored_windows;
 
 	cosmos::Mutex m_event_lock;
+	/// See getCommitLock().
+	cosmos::Mutex m_commit_lock;
 
 	/// An XWindow created by us for managing selection buffers.
 	xpp::XWindow m_selection_window;
@@ -293,6 +438,13 @@ private: // functions
 	/// Creates the initial file system.
 	void createFS();
 
+	/// Creates the window attribute index directories.
+	/**
+	 * This needs to be called after m_win_dir has been created but
+	 * before any windows are added to it.
+	 **/
+	void createIndexes();
+
 	void createSelectionWindow();
 
 	/// Print application state for debugging purposes.
@@ -1,5 +1,6 @@
 // C++
 #include <array>
+#include <cstdlib>
 #include <iostream>
 #include <string_view>
 
@@ -12,6 +13,7 @@
 #include <xpp/Xpp.hxx>
 
 // xwmfs
+#include "fuse/KernelCache.hxx"
 #include "fuse/xwmfs_fuse_ops.h"
 #include "main/Exception.hxx"
 #include "main/logger.hxx"
@@ -40,6 +42,43 @@ void Main::parseLoggerSettings(const std::string_view bits) {
 	);
 }
 
+size_t Main::parseCount(const std::string_view number) {
+	size_t endpos = 0;
+	unsigned long ret = 0;
+	const std::string str{number};
+
+	try {
+		ret = std::stoul(str, &endpos);
+	} catch (const std::exception &) {
+		endpos = 0;
+	}
+
+	if (endpos == 0 || endpos != str.size() || ret == 0) {
+		throw Exception{"invalid positive number: " + str};
+	}
+
+	return ret;
+}
+
+std::set<std::string> Main::parseNameList(const std::string_view list) {
+	std::set<std::string> ret;
+	size_t start = 0;
+
+	while (start <= list.size()) {
+		auto end = list.find_first_of(',', start);
+		if (end == list.npos)
+			end = list.size();
+
+		if (end != start) {
+			ret.insert(std::string{list.substr(start, end - start)});
+		}
+
+		start = end + 1;
+	}
+
+	return ret;
+}
+
 bool Main::parseOptions(const cosmos::StringViewVector &args, struct fuse_args &fuse_args) {
 	bool ret = false;
 	auto &opts = xwmfs::Options::getInstance();
@@ -52,6 +91,12 @@ bool Main::parseOptions(const cosmos::StringViewVector &args, struct fuse_args &
 			parseLoggerSettings(logger_opts);
 		} else if (arg == "--handle-pseudo-windows") {
 			opts.setHandlePseudoWindows(true);
+		} else if (arg == "--lazy-attrs") {
+			opts.setLazyAttrs(true);
+		} else if (arg.starts_with("--event-backlog=")) {
+			opts.setEventBacklog(parseCount(arg.substr(arg.find_first_of('=') + 1)));
+		} else if (arg.starts_with("--push-attrs=")) {
+			opts.setPushAttrs(parseNameList(arg.substr(arg.find_first_of('=') + 1)));
 		} else {
 			if (arg == "-h" || arg == "--help") {
 				ret = true;
@@ -64,6 +109,51 @@ bool Main::parseOptions(const cosmos::StringViewVector &args, struct fuse_args &
 	return ret;
 }
 
+cosmos::ExitStatus Main::runFuse(struct fuse_args &fuse_args, const struct fuse_cmdline_opts &opts) {
+	auto session = fuse_session_new(&fuse_args, &xwmfs_oper, sizeof(xwmfs_oper), nullptr);
+
+	if (!session) {
+		return cosmos::ExitStatus::FAILURE;
+	}
+
+	auto ret = cosmos::ExitStatus::FAILURE;
+	auto &cache = KernelCache::getInstance();
+
+	if (fuse_set_signal_handlers(session) == 0) {
+		if (fuse_session_mount(session, opts.mountpoint) == 0) {
+			fuse_daemonize(opts.foreground);
+			cache.setSession(session);
+
+			int res;
+
+			// the actual initialization is done via init and
+			// destroy functions called from FUSE
+			if (opts.singlethread) {
+				res = fuse_session_loop(session);
+			} else {
+				struct fuse_loop_config config;
+				config.clone_fd = opts.clone_fd;
+				config.max_idle_threads = opts.max_idle_threads;
+				res = fuse_session_loop_mt(session, &config);
+			}
+
+			if (res == 0) {
+				ret = cosmos::ExitStatus::SUCCESS;
+			}
+
+			cache.setSession(nullptr);
+
+			fuse_session_unmount(session);
+		}
+
+		fuse_remove_signal_handlers(session);
+	}
+
+	fuse_session_destroy(session);
+
+	return ret;
+}
+
 void Main::printHelp() {
 	std::cerr << "\n\nxwmfs specific options:\n\n"
 		"\t--xsync\n"
@@ -73,7 +163,17 @@ void Main::printHelp() {
 		"\t\tand debug (D) to on ('1') or off ('0'), i.e. a row of four bits\n"
 		"\t--handle-pseudo-windows\n"
 		"\t\talso include hidden and helper windows like popup menus\n"
-		"\t\tand window decorations"
+		"\t\tand window decorations\n"
+		"\t--lazy-attrs\n"
+		"\t\tonly query window attributes from the X server when they\n"
+		"\t\tare accessed for the first time\n"
+		"\t--event-backlog=N\n"
+		"\t\tthe number of events kept for slow readers of events\n"
+		"\t\tfiles, before they lose the oldest ones (default: 64)\n"
+		"\t--push-attrs=NAME[,NAME...]\n"
+		"\t\tpush changed content of the given window and wm files\n"
+		"\t\tdirectly into the kernel cache, e.g.\n"
+		"\t\tname,geometry,mapped,active_window,active_desktop"
 		"\n";
 }
 
@@ -106,21 +206,46 @@ cosmos::ExitStatus Main::main(const std::string_view argv0, const cosmos::String
 		return cosmos::ExitStatus::FAILURE;
 	}
 
-	try {
-		xpp::Init xpp_init;
+	struct fuse_cmdline_opts fuse_opts;
 
-		// the actual initialization is currently done via init and
-		// destroy functions called from FUSE
-		const int fuse_res = fuse_main(fuse_args.argc, fuse_args.argv, &xwmfs_oper, NULL);
+	if (fuse_parse_cmdline(&fuse_args, &fuse_opts) != 0) {
+		fuse_opt_free_args(&fuse_args);
+		return cosmos::ExitStatus::FAILURE;
+	}
 
-		if (print_xwmfs_help) {
-			printHelp();
-		}
+	auto cleanup = [&fuse_args, &fuse_opts]() {
+		free(fuse_opts.mountpoint);
+		fuse_opt_free_args(&fuse_args);
+	};
+
+	if (print_xwmfs_help || fuse_opts.show_help) {
+		std::cout << "usage: " << argv0 << " [options] <mountpoint>\n\n";
+		fuse_cmdline_help();
+		fuse_lowlevel_help();
+		printHelp();
+		cleanup();
+		return cosmos::ExitStatus::SUCCESS;
+	} else if (fuse_opts.show_version) {
+		std::cout << "FUSE library version " << fuse_pkgversion() << "\n";
+		fuse_lowlevel_version();
+		cleanup();
+		return cosmos::ExitStatus::SUCCESS;
+	} else if (!fuse_opts.mountpoint) {
+		std::cerr << "usage: " << argv0 << " [options] <mountpoint>\n";
+		cleanup();
+		return cosmos::ExitStatus::FAILURE;
+	}
+
+	try {
+		xpp::Init xpp_init;
 
-		return cosmos::ExitStatus{fuse_res};
+		const auto res = runFuse(fuse_args, fuse_opts);
+		cleanup();
+		return res;
 	} catch (const xpp::XDisplay::DisplayOpenError &error) {
 		std::cerr << "Failed to open X11 display: " << error.what() << "\n";
 		std::cerr << "Is X running? Is the DISPLAY environment variable set correctly?\n";
+		cleanup();
 		return cosmos::ExitStatus::FAILURE;
 	}
 }
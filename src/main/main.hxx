@@ -1,16 +1,22 @@
 #pragma once
 
+// C++
+#include <set>
+#include <string>
+#include <string_view>
+
 // cosmos
 #include <cosmos/main.hxx>
 
 struct fuse_args;
+struct fuse_cmdline_opts;
 
 namespace xwmfs {
 
 /// Main application class.
 /**
  * This class contains the main entry point, initializes libfuse and runs
- * `fuse_main()`.
+ * a low level FUSE session.
  **/
 class Main :
 	public cosmos::MainContainerArgs {
@@ -25,7 +31,16 @@ protected:
 
 	void parseLoggerSettings(const std::string_view bits);
 
+	/// Parses a positive decimal number, throws an Exception on error.
+	size_t parseCount(const std::string_view number);
+
+	/// Parses a comma separated list of names.
+	std::set<std::string> parseNameList(const std::string_view list);
+
 	void printHelp();
+
+	/// Mounts the file system and processes FUSE requests until it is unmounted.
+	cosmos::ExitStatus runFuse(struct fuse_args &fuse_args, const struct fuse_cmdline_opts &opts);
 };
 
 } // end ns
@@ -0,0 +1,320 @@
+// C++
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+// X11
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+
+// cosmos
+#include <cosmos/formatting.hxx>
+#include <cosmos/thread/Mutex.hxx>
+
+// libxpp
+#include <xpp/XDisplay.hxx>
+
+// xwmfs
+#include "main/Exception.hxx"
+#include "x11/PropertyFetcher.hxx"
+
+namespace xwmfs {
+
+namespace {
+
+/// Cache for PropertyFetcher::atomName().
+std::map<xpp::AtomID, std::string> atom_names;
+cosmos::Mutex atom_names_lock;
+
+/// The maximum property length to request, in 32-bit units.
+constexpr uint32_t MAX_PROP_LEN = std::numeric_limits<uint32_t>::max() / 4;
+
+} // end anon ns
+
+std::string PropertyFetcher::Value::asString() const {
+	// the data may contain a list of strings, only use the first one
+	return std::string{m_data.c_str()};
+}
+
+std::vector<std::string> PropertyFetcher::Value::asStringList() const {
+	std::vector<std::string> ret;
+	size_t pos = 0;
+
+	while (pos < m_data.size()) {
+		auto end = m_data.find('\0', pos);
+		if (end == m_data.npos)
+			end = m_data.size();
+
+		ret.emplace_back(m_data.substr(pos, end - pos));
+		pos = end + 1;
+	}
+
+	return ret;
+}
+
+std::vector<uint32_t> PropertyFetcher::Value::asNumbers() const {
+	if (m_format != 32) {
+		throw Exception{"property value is not of 32-bit format"};
+	}
+
+	std::vector<uint32_t> ret(items());
+	std::memcpy(ret.data(), m_data.data(), ret.size() * sizeof(uint32_t));
+	return ret;
+}
+
+uint32_t PropertyFetcher::Value::asNumber() const {
+	const auto numbers = asNumbers();
+
+	if (numbers.empty()) {
+		throw Exception{"empty property value"};
+	}
+
+	return numbers[0];
+}
+
+PropertyFetcher::PropertyFetcher(xpp::XDisplay &display) :
+		m_conn{::XGetXCBConnection(display)} {
+}
+
+PropertyFetcher::~PropertyFetcher() {
+	for (const auto &pending: m_pending_props) {
+		::xcb_discard_reply(m_conn, pending.sequence);
+	}
+	for (const auto &pending: m_pending_lists) {
+		::xcb_discard_reply(m_conn, pending.sequence);
+	}
+	for (const auto &pending: m_pending_attrs) {
+		::xcb_discard_reply(m_conn, pending.attrs_sequence);
+		::xcb_discard_reply(m_conn, pending.geometry_sequence);
+	}
+	for (const auto &pending: m_pending_parents) {
+		::xcb_discard_reply(m_conn, pending.sequence);
+	}
+}
+
+void PropertyFetcher::requestProperty(const xpp::WinID win, const xpp::AtomID atom) {
+	const PropertyKey key{win, atom};
+
+	if (hasProperty(win, atom) || !m_pending_keys.insert(key).second) {
+		// already requested
+		return;
+	}
+
+	const auto cookie = ::xcb_get_property(m_conn, 0,
+		cosmos::to_integral(win), cosmos::to_integral(atom),
+		XCB_GET_PROPERTY_TYPE_ANY, 0, MAX_PROP_LEN);
+
+	m_pending_props.push_back(PendingProperty{key, cookie.sequence});
+}
+
+void PropertyFetcher::requestPropertyList(const xpp::WinID win, const WithValues with_values) {
+	const auto cookie = ::xcb_list_properties(m_conn, cosmos::to_integral(win));
+
+	m_pending_lists.push_back(PendingList{win, cookie.sequence, with_values});
+}
+
+void PropertyFetcher::requestAttrs(const xpp::WinID win) {
+	const auto attrs_cookie = ::xcb_get_window_attributes(m_conn, cosmos::to_integral(win));
+	const auto geometry_cookie = ::xcb_get_geometry(m_conn, cosmos::to_integral(win));
+
+	m_pending_attrs.push_back(PendingAttrs{
+			win, attrs_cookie.sequence, geometry_cookie.sequence});
+}
+
+void PropertyFetcher::requestParent(const xpp::WinID win) {
+	const auto cookie = ::xcb_query_tree(m_conn, cosmos::to_integral(win));
+
+	m_pending_parents.push_back(PendingParent{win, cookie.sequence});
+}
+
+void PropertyFetcher::collect() {
+	// property lists first, this may add further property requests
+	collectPropertyLists();
+	collectAttrs();
+	collectParents();
+	collectProperties();
+}
+
+void PropertyFetcher::collectPropertyLists() {
+	auto pending_lists = std::move(m_pending_lists);
+	m_pending_lists.clear();
+
+	for (const auto &pending: pending_lists) {
+		xcb_generic_error_t *error = nullptr;
+		auto reply = ::xcb_list_properties_reply(m_conn,
+				xcb_list_properties_cookie_t{pending.sequence}, &error);
+
+		if (!reply) {
+			// window vanished in the meantime
+			std::free(error);
+			continue;
+		}
+
+		const auto atoms = ::xcb_list_properties_atoms(reply);
+		const auto num_atoms = ::xcb_list_properties_atoms_length(reply);
+		auto &list = m_prop_lists[pending.win];
+		list.clear();
+
+		for (int i = 0; i < num_atoms; i++) {
+			list.push_back(xpp::AtomID{atoms[i]});
+
+			if (pending.with_values) {
+				requestProperty(pending.win, list.back());
+			}
+		}
+
+		std::free(reply);
+	}
+}
+
+void PropertyFetcher::collectProperties() {
+	auto pending_props = std::move(m_pending_props);
+	m_pending_props.clear();
+	m_pending_keys.clear();
+
+	for (const auto &pending: pending_props) {
+		auto &result = m_properties[pending.key];
+		xcb_generic_error_t *error = nullptr;
+		auto reply = ::xcb_get_property_reply(m_conn,
+				xcb_get_property_cookie_t{pending.sequence}, &error);
+
+		if (!reply) {
+			// window vanished in the meantime
+			std::free(error);
+			result.reset();
+			continue;
+		} else if (reply->type == XCB_NONE) {
+			// property is not set
+			std::free(reply);
+			result.reset();
+			continue;
+		}
+
+		Value value;
+		value.m_type = xpp::AtomID{reply->type};
+		value.m_format = reply->format;
+		value.m_data.assign(
+			static_cast<const char*>(::xcb_get_property_value(reply)),
+			::xcb_get_property_value_length(reply));
+		result = std::move(value);
+
+		std::free(reply);
+	}
+}
+
+void PropertyFetcher::collectAttrs() {
+	auto pending_attrs = std::move(m_pending_attrs);
+	m_pending_attrs.clear();
+
+	for (const auto &pending: pending_attrs) {
+		xcb_generic_error_t *error = nullptr;
+		auto attrs_reply = ::xcb_get_window_attributes_reply(m_conn,
+				xcb_get_window_attributes_cookie_t{pending.attrs_sequence}, &error);
+		std::free(error);
+		error = nullptr;
+		auto geometry_reply = ::xcb_get_geometry_reply(m_conn,
+				xcb_get_geometry_cookie_t{pending.geometry_sequence}, &error);
+		std::free(error);
+
+		if (attrs_reply && geometry_reply) {
+			auto &attrs = m_attrs[pending.win];
+			attrs.x = geometry_reply->x;
+			attrs.y = geometry_reply->y;
+			attrs.width = geometry_reply->width;
+			attrs.height = geometry_reply->height;
+			attrs.mapped = attrs_reply->map_state != XCB_MAP_STATE_UNMAPPED;
+		}
+
+		std::free(attrs_reply);
+		std::free(geometry_reply);
+	}
+}
+
+void PropertyFetcher::collectParents() {
+	auto pending_parents = std::move(m_pending_parents);
+	m_pending_parents.clear();
+
+	for (const auto &pending: pending_parents) {
+		xcb_generic_error_t *error = nullptr;
+		auto reply = ::xcb_query_tree_reply(m_conn,
+				xcb_query_tree_cookie_t{pending.sequence}, &error);
+
+		if (!reply) {
+			std::free(error);
+			continue;
+		}
+
+		m_parents[pending.win] = xpp::WinID{reply->parent};
+		std::free(reply);
+	}
+}
+
+const PropertyFetcher::Value* PropertyFetcher::findProperty(
+		const xpp::WinID win, const xpp::AtomID atom) const {
+	auto it = m_properties.find({win, atom});
+
+	if (it == m_properties.end() || !it->second) {
+		return nullptr;
+	}
+
+	return &(*it->second);
+}
+
+const PropertyFetcher::Value& PropertyFetcher::getProperty(
+		const xpp::WinID win, const xpp::AtomID atom) const {
+	auto value = findProperty(win, atom);
+
+	if (!value) {
+		throw Exception{cosmos::sprintf("property %lu not existing",
+				cosmos::to_integral(atom))};
+	}
+
+	return *value;
+}
+
+const xpp::AtomIDVector* PropertyFetcher::findPropertyList(const xpp::WinID win) const {
+	auto it = m_prop_lists.find(win);
+
+	return it == m_prop_lists.end() ? nullptr : &it->second;
+}
+
+const PropertyFetcher::Attrs* PropertyFetcher::findAttrs(const xpp::WinID win) const {
+	auto it = m_attrs.find(win);
+
+	return it == m_attrs.end() ? nullptr : &it->second;
+}
+
+std::optional<xpp::WinID> PropertyFetcher::findParent(const xpp::WinID win) const {
+	auto it = m_parents.find(win);
+
+	if (it == m_parents.end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+const std::string& PropertyFetcher::atomName(const xpp::AtomID atom) const {
+	cosmos::MutexGuard g{atom_names_lock};
+
+	if (auto it = atom_names.find(atom); it != atom_names.end()) {
+		return it->second;
+	}
+
+	xcb_generic_error_t *error = nullptr;
+	const auto cookie = ::xcb_get_atom_name(m_conn, cosmos::to_integral(atom));
+	auto reply = ::xcb_get_atom_name_reply(m_conn, cookie, &error);
+
+	if (!reply) {
+		std::free(error);
+		throw Exception{cosmos::sprintf("failed to get name of atom %lu",
+				cosmos::to_integral(atom))};
+	}
+
+	std::string name{::xcb_get_atom_name_name(reply),
+		static_cast<size_t>(::xcb_get_atom_name_name_length(reply))};
+	std::free(reply);
+
+	return atom_names.emplace(atom, std::move(name)).first->second;
+}
+
+} // end ns
@@ -0,0 +1,206 @@
+#pragma once
+
+// C++
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// libcosmos
+#include <cosmos/utils.hxx>
+
+// libxpp
+#include <xpp/fwd.hxx>
+#include <xpp/types.hxx>
+
+struct xcb_connection_t;
+
+namespace xwmfs {
+
+/// Batched retrieval of window information via XCB.
+/**
+ * Xlib only offers a synchronous request/reply model, thus obtaining N
+ * properties costs N round trips to the X server. This class uses the XCB
+ * connection underlying the Xlib display instead. All requests are sent
+ * out right away when calling one of the request*() functions, but the
+ * replies are only waited for in collect(). This way obtaining information
+ * about an arbitrary number of windows costs close to a single round trip.
+ *
+ * XCB is thread safe and doesn't suffer from the libX11 issue described in
+ * Xwmfs::getEventLock(), thus this class can be used from any thread
+ * without holding the event lock. A single PropertyFetcher instance must
+ * only be used by one thread at a time, though.
+ **/
+class PropertyFetcher {
+public: // types
+
+	using WithValues = cosmos::NamedBool<struct with_values_t, false>;
+
+	/// The raw value of a single window property.
+	class Value {
+		friend class PropertyFetcher;
+	public: // functions
+
+		/// The type of the property.
+		xpp::AtomID type() const { return m_type; }
+
+		/// The size of the items in bits (8, 16 or 32).
+		int format() const { return m_format; }
+
+		/// The number of items in the property.
+		size_t items() const {
+			return m_format ? m_data.size() / (m_format / 8) : 0;
+		}
+
+		/// Returns the value as a single string (STRING or UTF8_STRING).
+		std::string asString() const;
+
+		/// Returns the value as a list of null terminated strings.
+		std::vector<std::string> asStringList() const;
+
+		/// Returns the value as a list of 32-bit items (CARDINAL, ATOM, WINDOW, ...).
+		std::vector<uint32_t> asNumbers() const;
+
+		/// Returns the first 32-bit item of the value.
+		uint32_t asNumber() const;
+
+	protected: // data
+
+		xpp::AtomID m_type = xpp::AtomID::INVALID;
+		int m_format = 0;
+		/// The raw property data.
+		std::string m_data;
+	};
+
+	/// Basic window attributes.
+	struct Attrs {
+		int x = 0;
+		int y = 0;
+		unsigned int width = 0;
+		unsigned int height = 0;
+		bool mapped = false;
+	};
+
+public: // functions
+
+	explicit PropertyFetcher(xpp::XDisplay &display);
+
+	/// Discards any replies that haven't been collected.
+	~PropertyFetcher();
+
+	PropertyFetcher(const PropertyFetcher&) = delete;
+	PropertyFetcher& operator=(const PropertyFetcher&) = delete;
+
+	/// Requests the value of the property `atom` of `win`.
+	void requestProperty(const xpp::WinID win, const xpp::AtomID atom);
+
+	/// Requests the list of properties present on `win`.
+	/**
+	 * \param[in] with_values
+	 * 	If set then the values of all listed properties are requested
+	 * 	as well, as soon as the list arrives during collect().
+	 **/
+	void requestPropertyList(const xpp::WinID win,
+			const WithValues with_values = WithValues{false});
+
+	/// Requests the geometry and mapped state of `win`.
+	void requestAttrs(const xpp::WinID win);
+
+	/// Requests the parent of `win`.
+	void requestParent(const xpp::WinID win);
+
+	/// Waits for the replies of all outstanding requests.
+	/**
+	 * Afterwards the results can be obtained via the accessor functions
+	 * below. Further requests can be made after calling this, which
+	 * need another collect() call then.
+	 **/
+	void collect();
+
+	/// Returns whether a reply for the given property has been collected.
+	bool hasProperty(const xpp::WinID win, const xpp::AtomID atom) const {
+		return m_properties.find({win, atom}) != m_properties.end();
+	}
+
+	/// Returns the value of the given property or nullptr if it isn't existing.
+	const Value* findProperty(const xpp::WinID win, const xpp::AtomID atom) const;
+
+	/// Returns the value of the given property.
+	/**
+	 * If the property isn't existing or hasn't been requested then an
+	 * Exception is thrown.
+	 **/
+	const Value& getProperty(const xpp::WinID win, const xpp::AtomID atom) const;
+
+	/// Returns the property list of `win` or nullptr if it couldn't be obtained.
+	const xpp::AtomIDVector* findPropertyList(const xpp::WinID win) const;
+
+	/// Returns the attributes of `win` or nullptr if they couldn't be obtained.
+	const Attrs* findAttrs(const xpp::WinID win) const;
+
+	/// Returns the parent of `win`, if it could be obtained.
+	std::optional<xpp::WinID> findParent(const xpp::WinID win) const;
+
+	/// Returns the name of the given atom.
+	/**
+	 * Atom names are cached globally. For uncached atoms a synchronous
+	 * request is made. Other than xpp::atom_mapper this doesn't require
+	 * the event lock.
+	 **/
+	const std::string& atomName(const xpp::AtomID atom) const;
+
+protected: // types
+
+	using PropertyKey = std::pair<xpp::WinID, xpp::AtomID>;
+
+	struct PendingProperty {
+		PropertyKey key;
+		unsigned int sequence;
+	};
+
+	struct PendingList {
+		xpp::WinID win;
+		unsigned int sequence;
+		WithValues with_values;
+	};
+
+	struct PendingAttrs {
+		xpp::WinID win;
+		unsigned int attrs_sequence;
+		unsigned int geometry_sequence;
+	};
+
+	struct PendingParent {
+		xpp::WinID win;
+		unsigned int sequence;
+	};
+
+protected: // functions
+
+	void collectPropertyLists();
+	void collectProperties();
+	void collectAttrs();
+	void collectParents();
+
+protected: // data
+
+	xcb_connection_t *m_conn = nullptr;
+
+	std::vector<PendingProperty> m_pending_props;
+	/// The keys of m_pending_props to avoid duplicate requests.
+	std::set<PropertyKey> m_pending_keys;
+	std::vector<PendingList> m_pending_lists;
+	std::vector<PendingAttrs> m_pending_attrs;
+	std::vector<PendingParent> m_pending_parents;
+
+	/// Collected property values, std::nullopt for non-existing ones.
+	std::map<PropertyKey, std::optional<Value>> m_properties;
+	std::map<xpp::WinID, xpp::AtomIDVector> m_prop_lists;
+	std::map<xpp::WinID, Attrs> m_attrs;
+	std::map<xpp::WinID, xpp::WinID> m_parents;
+};
+
+} // end ns
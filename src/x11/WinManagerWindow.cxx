@@ -11,44 +11,28 @@
 // xwmfs
 #include "main/logger.hxx"
 #include "main/Xwmfs.hxx"
+#include "x11/PropertyFetcher.hxx"
 #include "x11/WinManagerWindow.hxx"
 
 namespace {
 
+/// Updates `property` from the value of `atom` of `win` collected in `fetched`.
 template <typename TYPE>
-bool update_property(
+void update_property(
 		const xpp::XWindow &win,
-		const xpp::AtomID atom, TYPE &property,
-		xpp::Property<TYPE> *caller_prop = nullptr) {
+		const xwmfs::PropertyFetcher &fetched,
+		const xpp::AtomID atom,
+		std::optional<TYPE> &property) {
 	try {
-		if (caller_prop) {
-			/* for the need of this, see fetchDesktopNames() */
-			win.getProperty(atom, *caller_prop);
-			property = caller_prop->get();
-		} else {
-			xpp::Property<TYPE> tmp;
-			win.getProperty(atom, tmp);
-			property = tmp.get();
-		}
+		const auto number = fetched.getProperty(win.id(), atom).asNumber();
+		property = static_cast<TYPE>(number);
 
 		xwmfs::logger->debug() << "Property update acquired for "
-			<< cosmos::to_integral(atom) << ": " << property << "\n";
-		return true;
+			<< cosmos::to_integral(atom) << ": " << number << "\n";
 	} catch (const std::exception &ex) {
 		xwmfs::logger->warn() << "Couldn't update property "
 			<< cosmos::to_integral(atom)
 			<< ": " << ex.what()  << std::endl;
-		return false;
-	}
-}
-
-template <typename TYPE>
-void update_property(
-		const xpp::XWindow &win,
-		const xpp::AtomID atom,
-		std::optional<TYPE> &property) {
-	property = TYPE{};
-	if (!update_property(win, atom, *property)) {
 		property.reset();
 	}
 }
@@ -58,7 +42,7 @@ void update_property(
 namespace xwmfs {
 
 WinManagerWindow::WinManagerWindow(xpp::XDisplay &display) :
-		xpp::RootWin{display} {
+		xpp::RootWin{display}, m_display{display} {
 	logger->debug() << "root window has id: " << *this << std::endl;
 	this->getInfo();
 }
@@ -237,16 +221,31 @@ void WinManagerWindow::queryBasicWMProperties() {
 		logger->warn() << "Couldn't query wm class: " << ex.what() << "\n";
 	}
 
-	fetchShowDesktopMode();
-	fetchNumDesktops();
-	fetchDesktopNames();
-	fetchActiveDesktop();
-	fetchActiveWindow();
+	PropertyFetcher fetcher{m_display};
+	requestProperties(fetcher);
+	fetcher.collect();
+
+	updateShowDesktopMode(fetcher);
+	updateNumDesktops(fetcher);
+	updateDesktopNames(fetcher);
+	updateActiveDesktop(fetcher);
+	updateActiveWindow(fetcher);
+}
+
+void WinManagerWindow::requestProperties(PropertyFetcher &fetcher) const {
+	for (const auto atom: {
+			xpp::atoms::ewmh_wm_desktop_shown,
+			xpp::atoms::ewmh_wm_nr_desktops,
+			xpp::atoms::ewmh_wm_desktop_names,
+			xpp::atoms::ewmh_wm_cur_desktop,
+			xpp::atoms::ewmh_wm_active_window}) {
+		fetcher.requestProperty(this->id(), atom);
+	}
 }
 
-void WinManagerWindow::fetchNumDesktops() {
+void WinManagerWindow::updateNumDesktops(const PropertyFetcher &fetched) {
 	update_property(
-		*this,
+		*this, fetched,
 		xpp::atoms::ewmh_wm_nr_desktops,
 		m_wm_num_desktops
 	);
@@ -268,15 +267,15 @@ void WinManagerWindow::setActiveDesktop(const int num) {
 	this->sendRequest(xpp::atoms::ewmh_wm_cur_desktop, num);
 }
 
-void WinManagerWindow::fetchActiveDesktop() {
+void WinManagerWindow::updateActiveDesktop(const PropertyFetcher &fetched) {
 	update_property(
-		*this,
+		*this, fetched,
 		xpp::atoms::ewmh_wm_cur_desktop,
 		m_wm_active_desktop
 	);
 }
 
-void WinManagerWindow::fetchShowDesktopMode() {
+void WinManagerWindow::updateShowDesktopMode(const PropertyFetcher &fetched) {
 	/*
 	 * The _NET_WM_SHOWING_DESKTOP, if supported, indicates whether
 	 * currently the "show the desktop" mode is active.
@@ -286,7 +285,7 @@ void WinManagerWindow::fetchShowDesktopMode() {
 	 * root window, not the m_ewmh_child window.
 	 */
 	update_property(
-		*this,
+		*this, fetched,
 		xpp::atoms::ewmh_wm_desktop_shown,
 		m_wm_showing_desktop
 	);
@@ -338,36 +337,23 @@ void WinManagerWindow::moveToDesktop(const xpp::XWindow &win,
 
 }
 
-void WinManagerWindow::fetchActiveWindow() {
+void WinManagerWindow::updateActiveWindow(const PropertyFetcher &fetched) {
 	update_property(
-		*this,
+		*this, fetched,
 		xpp::atoms::ewmh_wm_active_window,
 		m_wm_active_window
 	);
 }
 
-void WinManagerWindow::fetchDesktopNames() {
-	/*
-	 * this is a pretty ugly area, libxpp's utf8_string structure is only
-	 * a flat copy pointing into the xpp::Property data. After
-	 * xpp::Property is released, the utf8_string pointers are no longer
-	 * valid.
-	 *
-	 * Thus we are relying on a hack here, where the xpp::Property is hold
-	 * locally here and pased into update_property() to keep the memory
-	 * valid.
-	 */
-	std::vector<xpp::utf8_string> tmp_desktop_names;
-	xpp::Property<std::vector<xpp::utf8_string>> prop_vector;
-
+void WinManagerWindow::updateDesktopNames(const PropertyFetcher &fetched) {
 	m_wm_desktop_names.clear();
 
-	update_property(*this, xpp::atoms::ewmh_wm_desktop_names,
-			tmp_desktop_names,
-			&prop_vector);
-
-	for (auto utf8str: tmp_desktop_names) {
-		m_wm_desktop_names.push_back(std::string{utf8str.str});
+	if (auto value = fetched.findProperty(this->id(), xpp::atoms::ewmh_wm_desktop_names); value) {
+		m_wm_desktop_names = value->asStringList();
+	} else {
+		xwmfs::logger->warn() << "Couldn't update property "
+			<< cosmos::to_integral(xpp::atoms::ewmh_wm_desktop_names)
+			<< ": not existing" << std::endl;
 	}
 }
 
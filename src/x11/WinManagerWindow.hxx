@@ -14,6 +14,8 @@ namespace xpp {
 
 namespace xwmfs {
 
+class PropertyFetcher;
+
 /// Wrapper around xpp::RootWin with added window manager logic.
 class WinManagerWindow :
 		public xpp::RootWin {
@@ -54,8 +56,8 @@ public: // functions
 	/// Asks the window manager to change the active desktop.
 	void setActiveDesktop(const int num);
 
-	/// Fetches the currently active desktop from the window manager.
-	void fetchActiveDesktop();
+	/// Updates the currently active desktop from `fetched`.
+	void updateActiveDesktop(const PropertyFetcher &fetched);
 
 
 	/// Returns whether the current number of desktops was found.
@@ -67,8 +69,8 @@ public: // functions
 	/// Asks the window manager to change the number of desktops.
 	void setNumDesktops(const int num);
 
-	/// Fetches the current number of desktops from the window manager.
-	void fetchNumDesktops();
+	/// Updates the current number of desktops from `fetched`.
+	void updateNumDesktops(const PropertyFetcher &fetched);
 
 
 	/// Returns whether the currently active window was found.
@@ -80,8 +82,8 @@ public: // functions
 	/// Requests to change the focus to the given window.
 	void setActiveWindow(const xpp::XWindow &win);
 
-	/// Fetches the currently active window from the window manager.
-	void fetchActiveWindow();
+	/// Updates the currently active window from `fetched`.
+	void updateActiveWindow(const PropertyFetcher &fetched);
 
 
 	/// Returns whether a window manager "show the desktop mode" was found.
@@ -90,8 +92,8 @@ public: // functions
 	/// Returns the show the desktop mode, if found.
 	bool getShowDesktopMode() const { return *m_wm_showing_desktop == 1; }
 
-	/// Fetches the current "showing desktop mode" setting from the WM.
-	void fetchShowDesktopMode();
+	/// Updates the current "showing desktop mode" setting from `fetched`.
+	void updateShowDesktopMode(const PropertyFetcher &fetched);
 
 
 	/// Returns whether a window manager name was found.
@@ -118,8 +120,15 @@ public: // functions
 	/// Returns the vector of known desktop names in order of occurrence.
 	const auto& getDesktopNames() const { return m_wm_desktop_names; }
 
-	/// Fetches the current desktop names from the WM.
-	void fetchDesktopNames();
+	/// Updates the current desktop names from `fetched`.
+	void updateDesktopNames(const PropertyFetcher &fetched);
+
+	/// Requests all root window properties tracked by this class from `fetcher`.
+	/**
+	 * After collecting the replies the individual update*() functions
+	 * can be called to apply the new values.
+	 **/
+	void requestProperties(PropertyFetcher &fetcher) const;
 
 protected: // functions
 
@@ -148,6 +157,9 @@ protected: // functions
 
 protected: // data
 
+	/// The display the root window belongs to.
+	xpp::XDisplay &m_display;
+
 	/// Contains the child window associated with EWMH compatible WM, if applicable.
 	xpp::XWindow m_ewmh_child;
 
@@ -258,29 +258,40 @@ class TestBase(object):
         # otherwise just the first one we approach
         return Window(self.getWindowList()[0])
 
-    def createTestWindow(self, required_files=[]):
-        # creates a new window and returns its window ID
+    def findTestProgram(self):
+        # returns the path of an X11 program suitable for creating test windows
+
+        PROG_CANDS = ("xterm", "st", "xclock")
+        for prog in PROG_CANDS:
+            prog = shutil.which(prog)
+            if prog:
+                return prog
+
+        raise Exception(f"Failed to find X11 test program to create a test window. Looked for any of {PROG_CANDS}")
 
-        # this currently assumes an xterm executable is around
+    def spawnTestWindow(self, delay=0):
+        # starts the test window program after `delay` seconds without
+        # waiting for its window, the PID stays the same after the delay
 
         if self.m_test_window:
             raise Exception("Double create of test window, without closeTestWindow()")
 
-        print("Creating test window")
-        PROG_CANDS = ("xterm", "st", "xclock")
-        for prog in PROG_CANDS:
-            prog = shutil.which(prog)
-            if not prog:
-                continue
+        prog = self.findTestProgram()
+        cmdline = ["sh", "-c", 'sleep {}; exec "$0"'.format(delay), prog] if delay else [prog]
 
-            try:
-                self.m_test_window = subprocess.Popen(prog)
-                break
-            except Exception:
-                printe(f"Failed to run {prog} to create a test window", file=sys.stderr)
-                raise
-        else:
-            raise Exception(f"Failed to find X11 test program to create a test window. Looked for any of {PROG_CANDS}")
+        try:
+            self.m_test_window = subprocess.Popen(cmdline)
+        except Exception:
+            printe(f"Failed to run {prog} to create a test window")
+            raise
+
+        return self.m_test_window.pid
+
+    def createTestWindow(self, required_files=[]):
+        # creates a new window and returns its window ID
+
+        print("Creating test window")
+        self.spawnTestWindow()
 
         our_win = None
 
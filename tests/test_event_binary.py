@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+
+import errno
+import os
+import select
+import struct
+import sys
+import time
+from base.base import TestBase
+
+# tests the binary record format of events files, including the record
+# reporting lost events and the rejection of too small read buffers
+
+
+class EventBinaryTest(TestBase):
+
+    # seq, monotonic_ns, server_time, window, atom, kind
+    RECORD = struct.Struct("<QQIIII")
+    BACKLOG = 2
+
+    def __init__(self):
+
+        TestBase.__init__(self)
+
+    def extraSettings(self):
+
+        return TestBase.extraSettings(self) + ["--event-backlog={}".format(self.BACKLOG)]
+
+    def readKinds(self):
+
+        kinds = {}
+
+        with open(os.path.join(self.m_mount_dir, "event_kinds"), 'r') as fd:
+            for line in fd:
+                _id, name = line.split()
+                kinds[name] = int(_id)
+
+        return kinds
+
+    def decode(self, data):
+
+        if len(data) % self.RECORD.size != 0:
+            self.setBadResult("Read size {} is no multiple of the record size".format(len(data)))
+            return []
+
+        return [self.RECORD.unpack_from(data, off) for off in range(0, len(data), self.RECORD.size)]
+
+    def test(self):
+
+        test_window = self.createTestWindow(required_files=["name"])
+        our_id = int(str(test_window), 16)
+        namefile = test_window.getFile("name")
+
+        fd = os.open(test_window.getPath("events"), os.O_RDWR | os.O_NONBLOCK)
+        os.write(fd, b"format=binary")
+
+        # produce more events than fit into the backlog
+        for i in range(self.BACKLOG * 3):
+            namefile.write("binary-name-{}".format(i))
+
+        poller = select.poll()
+        poller.register(fd, select.POLLIN)
+
+        if not poller.poll(5000):
+            self.setBadResult("No binary events received")
+            return
+
+        # give X some time to dispatch the remaining updates
+        time.sleep(1)
+
+        try:
+            os.read(fd, self.RECORD.size - 1)
+            self.setBadResult("Read with too small buffer succeeded")
+        except OSError as e:
+            if e.errno != errno.EINVAL:
+                self.setBadResult("Unexpected error for too small buffer: {}".format(e))
+
+        records = self.decode(os.read(fd, self.RECORD.size * 64))
+        os.close(fd)
+        kinds = self.readKinds()
+
+        if not records:
+            self.setBadResult("No records returned")
+            return
+
+        seq, _, _, window, lost, kind = records[0]
+
+        if kind != kinds["lost"]:
+            self.setBadResult("Expected a lost record first, got kind {}".format(kind))
+        elif window != 0 or lost < 1:
+            self.setBadResult("Bad lost record: window = {}, count = {}".format(window, lost))
+
+        events = records[1:]
+
+        if len(events) > self.BACKLOG:
+            self.setBadResult("More records than the backlog returned: {}".format(len(events)))
+
+        for seq2, mono, _, window, _, kind in events:
+            if seq2 < seq:
+                self.setBadResult("Sequence numbers out of order")
+            if window != our_id:
+                self.setBadResult("Event for foreign window {:x}".format(window))
+            if mono == 0 or kind not in kinds.values():
+                self.setBadResult("Bad record: kind = {}, timestamp = {}".format(kind, mono))
+            seq = seq2
+
+        if kinds["name"] not in [record[5] for record in events]:
+            self.setBadResult("No name event among the records")
+
+        if self.m_res == 0:
+            self.setGoodResult("Binary records decoded correctly")
+
+        self.closeTestWindow()
+
+
+ebt = EventBinaryTest()
+res = ebt.run()
+sys.exit(res)
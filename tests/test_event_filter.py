@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+
+import errno
+import os
+import select
+import sys
+from base.base import TestBase
+
+# tests whether filters written to an events file only let matching events
+# pass. This runs in lazy mode, where the class used for filtering still
+# needs to be known when events are reported.
+
+
+class EventFilterTest(TestBase):
+
+    def __init__(self):
+
+        TestBase.__init__(self)
+
+    def extraSettings(self):
+
+        return TestBase.extraSettings(self) + ["--lazy-attrs"]
+
+    def openFiltered(self, words):
+
+        fd = os.open(os.path.join(self.m_mount_dir, "events"), os.O_RDWR | os.O_NONBLOCK)
+        os.write(fd, words.encode())
+        return fd
+
+    def readEvents(self, fd, timeout):
+
+        poller = select.poll()
+        poller.register(fd, select.POLLIN)
+
+        if not poller.poll(timeout * 1000):
+            return []
+
+        return os.read(fd, 4096).decode().splitlines()
+
+    def test(self):
+
+        test_window = self.createTestWindow(required_files=["name", "class"])
+        instance = test_window.getFile("class").read().splitlines()[0]
+        our_id = int(str(test_window), 16)
+
+        print("Filtering name events for class", instance)
+        matching = self.openFiltered("name class={}".format(instance))
+        other = self.openFiltered("name class=no-such-class")
+
+        test_window.getFile("name").write("filtered-name")
+
+        events = self.readEvents(matching, 5)
+        print("Received events:", events)
+
+        if not events:
+            self.setBadResult("No event for matching class received")
+
+        for event in events:
+            if event.split()[0] != "name":
+                self.setBadResult("Received event not in filter: " + event)
+
+        if our_id not in [int(event.split()[1], 16) for event in events]:
+            self.setBadResult("Name change of test window not reported")
+
+        unknown = os.open(os.path.join(self.m_mount_dir, "events"), os.O_RDWR)
+
+        try:
+            os.write(unknown, b"no-such-event")
+            self.setBadResult("Filter with unknown event name accepted")
+        except OSError as e:
+            if e.errno != errno.EINVAL:
+                self.setBadResult("Unexpected error for unknown event name: " + str(e))
+        finally:
+            os.close(unknown)
+
+        if self.readEvents(other, 1):
+            self.setBadResult("Received event for non-matching class")
+        elif self.m_res == 0:
+            self.setGoodResult("Filter applied correctly")
+
+        os.close(matching)
+        os.close(other)
+        self.closeTestWindow()
+
+
+eft = EventFilterTest()
+res = eft.run()
+sys.exit(res)
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+
+import errno
+import json
+import os
+import sys
+from base.base import TestBase, Window
+
+# tests ad-hoc window queries via the query file. This runs in lazy mode,
+# where the attributes used by a query need to be fetched on demand.
+
+
+class QueryTest(TestBase):
+
+    def __init__(self):
+
+        TestBase.__init__(self)
+
+    def extraSettings(self):
+
+        return TestBase.extraSettings(self) + ["--lazy-attrs"]
+
+    def query(self, words):
+
+        fd = os.open(os.path.join(self.m_mount_dir, "query"), os.O_RDWR)
+
+        try:
+            os.write(fd, words.encode())
+            result = b""
+
+            while True:
+                data = os.read(fd, 4096)
+                if not data:
+                    break
+                result += data
+
+            return result.decode()
+        finally:
+            os.close(fd)
+
+    def testMatches(self, instance, our_id):
+
+        result = self.query("class={} mapped=1".format(instance)).splitlines()
+        print("Matching windows:", result)
+
+        if our_id not in [int(win, 16) for win in result]:
+            self.setBadResult("Test window not found by query")
+
+        for win in result:
+            classes = Window(win).getFile("class").read().splitlines()
+            if instance not in classes:
+                self.setBadResult("Window {} doesn't match class {}".format(win, instance))
+
+    def testTable(self, instance, our_id, name):
+
+        result = json.loads(self.query("class={} table=id,name.json".format(instance)))
+        print("Matching table:", result)
+
+        for row in result:
+            if set(row.keys()) != {"id", "name"}:
+                self.setBadResult("Unexpected columns: {}".format(row.keys()))
+                return
+            if int(row["id"], 16) == our_id:
+                if row["name"] != name:
+                    self.setBadResult("Unexpected name in table: {}".format(row["name"]))
+                break
+        else:
+            self.setBadResult("Test window not found in table")
+
+    def testInvalid(self):
+
+        try:
+            self.query("no_such_attr=1")
+            self.setBadResult("Invalid query was accepted")
+        except OSError as e:
+            if e.errno != errno.EINVAL:
+                self.setBadResult("Unexpected error for invalid query: {}".format(e))
+
+    def test(self):
+
+        test_window = self.createTestWindow(required_files=["name", "class"])
+        instance = test_window.getFile("class").read().splitlines()[0]
+        name = test_window.getFile("name").read()
+        our_id = int(str(test_window), 16)
+
+        print("Testing query for class", instance)
+        self.testMatches(instance, our_id)
+        print("Testing table query")
+        self.testTable(instance, our_id, name)
+        print("Testing invalid query")
+        self.testInvalid()
+
+        if self.m_res == 0:
+            self.setGoodResult("Queries returned the expected results")
+
+        self.closeTestWindow()
+
+
+qt = QueryTest()
+res = qt.run()
+sys.exit(res)
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+
+import errno
+import os
+import select
+import sys
+import threading
+import time
+from base.base import TestBase
+
+# tests blocking, non-blocking and polling access to the wait file. This
+# runs in lazy mode, where the attributes of a condition need to be fetched
+# on demand.
+
+
+class WaitTest(TestBase):
+
+    def __init__(self):
+
+        TestBase.__init__(self)
+        self.m_result = None
+
+    def extraSettings(self):
+
+        return TestBase.extraSettings(self) + ["--lazy-attrs"]
+
+    def openWait(self, condition, flags=0):
+
+        fd = os.open(os.path.join(self.m_mount_dir, "wait"), os.O_RDWR | flags)
+        os.write(fd, condition.encode())
+        return fd
+
+    def blockingRead(self, fd):
+
+        try:
+            self.m_result = os.read(fd, 4096).decode().splitlines()
+        except OSError as e:
+            self.m_result = e
+
+    def testNonBlocking(self):
+
+        fd = self.openWait("class=no-such-class", os.O_NONBLOCK)
+
+        try:
+            os.read(fd, 4096)
+            self.setBadResult("Read of unsatisfied condition succeeded")
+        except OSError as e:
+            if e.errno != errno.EAGAIN:
+                self.setBadResult("Unexpected error for non-blocking read: {}".format(e))
+        finally:
+            os.close(fd)
+
+    def testWindowAppears(self):
+
+        # the window only appears after a delay, its PID is known already
+        pid = self.spawnTestWindow(delay=2)
+        condition = "pid={}".format(pid)
+        blocking = self.openWait(condition)
+        polled = self.openWait(condition, os.O_NONBLOCK)
+
+        poller = select.poll()
+        poller.register(polled, select.POLLIN)
+
+        if poller.poll(0):
+            self.setBadResult("Poll reports readiness before the window exists")
+
+        reader = threading.Thread(target=self.blockingRead, args=(blocking,))
+        reader.start()
+        time.sleep(0.5)
+
+        if not reader.is_alive():
+            self.setBadResult("Read didn't block: {}".format(self.m_result))
+
+        if not poller.poll(10000):
+            self.setBadResult("Poll didn't report readiness for the new window")
+
+        reader.join(10)
+
+        if reader.is_alive():
+            self.setBadResult("Read didn't return after the window appeared")
+            # unblock the reader, an empty condition matches any window
+            os.write(blocking, b" ")
+            reader.join()
+        elif isinstance(self.m_result, OSError) or len(self.m_result) != 1:
+            self.setBadResult("Unexpected read result: {}".format(self.m_result))
+        else:
+            print("Window", self.m_result[0], "appeared")
+            ready = os.read(polled, 4096).decode().splitlines()
+            if ready != self.m_result:
+                self.setBadResult("Polled descriptor returned {}".format(ready))
+
+        os.close(blocking)
+        os.close(polled)
+        self.closeTestWindow()
+
+    def test(self):
+
+        print("Testing non-blocking read")
+        self.testNonBlocking()
+        print("Testing blocking read and poll for a new window")
+        self.testWindowAppears()
+
+        if self.m_res == 0:
+            self.setGoodResult("Wait file behaves as expected")
+
+
+wt = WaitTest()
+res = wt.run()
+sys.exit(res)